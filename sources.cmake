@@ -1,17 +1,65 @@
 set(KOSOUND_SOURCES
+src/alcheck.cpp
+src/assetstream.cpp
+src/bufferedreader.cpp
 src/cafstream.cpp
+src/decodepool.cpp
+src/downmix.cpp
+src/kosndformat.cpp
+src/kosndstream.cpp
+src/oggseekindex.cpp
 src/oggstream.cpp
+src/openalext.cpp
+src/pcmcodec.cpp
+src/profiler.cpp
 src/sndfx.cpp
 src/sound.cpp
+src/soundasset.cpp
+src/soundbus.cpp
+src/soundemitter.cpp
+src/soundpolicy.cpp
 src/soundstream.cpp
+src/spatialparams.cpp
+src/streamlog.cpp
+src/voicepool.cpp
 )
 
 set(KOSOUND_HEADERS
+src/alcheck.h
+src/assetstream.h
+src/bufferedreader.h
 src/cafstream.h
+src/decodepool.h
+src/downmix.h
+src/kosndformat.h
+src/kosndstream.h
+src/mpscqueue.h
+src/oggseekindex.h
 src/oggstream.h
+src/openalext.h
+src/pcmcodec.h
+src/profiler.h
 src/sndfx.h
 src/sound.h
+src/soundasset.h
+src/soundbus.h
+src/soundcommand.h
+src/soundemitter.h
+src/soundpolicy.h
 src/soundstream.h
+src/spatialparams.h
+src/streamlog.h
+src/voicepool.h
 )
 
 
+
+set(KOSOUND_CONVERT_SOURCES
+src/downmix.cpp
+src/kosndformat.cpp
+tools/kosound_convert.cpp
+)
+
+set(KOSOUND_ALLOCTEST_SOURCES
+tests/alloctest.cpp
+)
@@ -0,0 +1,132 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "alcheck.h"
+#include "streamlog.h"
+
+using namespace Kosound;
+
+/*************************************************************************
+ *                                 check                                 *
+ *************************************************************************/
+void ALCheck::check(const char* where)
+{
+   ALenum error = alGetError();
+
+   if(error != AL_NO_ERROR)
+   {
+      report(error, where, NULL);
+   }
+}
+
+/*************************************************************************
+ *                                 mark                                  *
+ *************************************************************************/
+void ALCheck::mark(const char* where)
+{
+   const char* none = NULL;
+   ALenum error;
+
+   if(everyCall.load(std::memory_order_relaxed))
+   {
+      error = alGetError();
+      if(error != AL_NO_ERROR)
+      {
+         report(error, where, NULL);
+         /* Got its exact site: back to a check per flush */
+         everyCall = false;
+      }
+      return;
+   }
+
+   if(firstSite.load(std::memory_order_relaxed) == NULL)
+   {
+      firstSite.compare_exchange_strong(none, where);
+   }
+   lastSite.store(where, std::memory_order_relaxed);
+}
+
+/*************************************************************************
+ *                                 flush                                 *
+ *************************************************************************/
+void ALCheck::flush()
+{
+   ALenum error = alGetError();
+
+   if(error != AL_NO_ERROR)
+   {
+      report(error, firstSite, lastSite);
+      /* Find its exact site the next time */
+      everyCall = true;
+      cleanFlushes = 0;
+   }
+   else if( (everyCall) && 
+            (++cleanFlushes >= KOSOUND_AL_CHECK_CLEAN_FLUSHES) )
+   {
+      /* Not happening again: back to a check per flush */
+      everyCall = false;
+   }
+   firstSite = NULL;
+   lastSite = NULL;
+}
+
+/*************************************************************************
+ *                                report                                 *
+ *************************************************************************/
+void ALCheck::report(ALenum error, const char* first, const char* last)
+{
+   errors++;
+
+   /* Could be at a decode thread: just logged as a record */
+   StreamLog::add(StreamLog::ERROR_AL, 0, NULL, error, first, last);
+}
+
+/*************************************************************************
+ *                            getErrorString                             *
+ *************************************************************************/
+const char* ALCheck::getErrorString(ALenum error)
+{
+   switch(error)
+   {
+      case AL_NO_ERROR:
+         return "No error";
+      case AL_INVALID_NAME:
+         return "Invalid name parameter";
+      case AL_INVALID_ENUM:
+         return "Invalid enum parameter value";
+      case AL_INVALID_VALUE:
+         return "Invalid parameter value";
+      case AL_INVALID_OPERATION:
+         return "Illegal call";
+      case AL_OUT_OF_MEMORY:
+         return "Unable to allocate memory";
+   }
+   return "Unknown error";
+}
+
+/*************************************************************************
+ *                            static members                             *
+ *************************************************************************/
+std::atomic<const char*> ALCheck::firstSite(NULL);
+std::atomic<const char*> ALCheck::lastSite(NULL);
+std::atomic<bool> ALCheck::everyCall(false);
+int ALCheck::cleanFlushes = 0;
+std::atomic<unsigned long> ALCheck::errors(0);
+
@@ -0,0 +1,103 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kosound_al_check_h
+#define _kosound_al_check_h
+
+#include "kosoundconfig.h"
+#include <kobold/platform.h>
+
+#if KOBOLD_PLATFORM == KOBOLD_PLATFORM_IOS || \
+    KOBOLD_PLATFORM == KOBOLD_PLATFORM_MACOS
+   #include <OpenAL/al.h>
+#else
+   #include <AL/al.h>
+#endif
+
+#include <atomic>
+
+namespace Kosound
+{
+
+/*! Clean flushes after which FLUSH mode stops checking each call */
+#define KOSOUND_AL_CHECK_CLEAN_FLUSHES   64
+
+/*! OpenAL error checking, with its mode selected at build time by the
+ * KOSOUND_AL_CHECKS CMake option:
+ *    - FULL: alGetError after each checked call, reporting its site;
+ *    - FLUSH: checked calls only remember their site, and alGetError is
+ *      called once per Sound::flush. As AL errors are sticky, the first
+ *      error since the last flush is reported, with the range of sites
+ *      it happened at. From then on, each call is checked (as FULL),
+ *      till its next occurrence reports its exact site, or for
+ *      KOSOUND_AL_CHECK_CLEAN_FLUSHES flushes with no error;
+ *    - NONE: no checks at all (they compile to nothing). */
+class ALCheck
+{
+   public:
+      /*! Check now for an error
+       * \param where -> site of the checked call (a string literal) */
+      static void check(const char* where);
+
+      /*! Remember the site of a call, to be checked at the next flush
+       * (or check it now, after a previous error was reported).
+       * \param where -> site of the call (a string literal) */
+      static void mark(const char* where);
+
+      /*! Check for an error raised since the last flush (see mark) */
+      static void flush();
+
+      /*! \return total of errors reported */
+      static unsigned long getErrors() { return errors; };
+
+      /*! \return description of an OpenAL error */
+      static const char* getErrorString(ALenum error);
+
+   private:
+      /*! Report an error (see StreamLog)
+       * \param error -> its code
+       * \param first -> its site, or first possible one
+       * \param last -> last possible site, or NULL if exact */
+      static void report(ALenum error, const char* first, const char* last);
+
+      static std::atomic<const char*> firstSite; /**< First since flush */
+      static std::atomic<const char*> lastSite;  /**< Last since flush */
+      static std::atomic<bool> everyCall;   /**< If checking each call */
+      static int cleanFlushes;  /**< Flushes without error, if everyCall */
+      static std::atomic<unsigned long> errors; /**< Reported errors */
+};
+
+#if KOSOUND_AL_CHECKS == KOSOUND_AL_CHECKS_FULL
+   /*! Check the preceding AL call (site is a string literal) */
+   #define KOSOUND_AL_CHECK(where) Kosound::ALCheck::check(where)
+   /*! Check the AL calls since the last flush */
+   #define KOSOUND_AL_CHECK_FLUSH()
+#elif KOSOUND_AL_CHECKS == KOSOUND_AL_CHECKS_FLUSH
+   #define KOSOUND_AL_CHECK(where) Kosound::ALCheck::mark(where)
+   #define KOSOUND_AL_CHECK_FLUSH() Kosound::ALCheck::flush()
+#else
+   #define KOSOUND_AL_CHECK(where)
+   #define KOSOUND_AL_CHECK_FLUSH()
+#endif
+
+}
+
+#endif
+
@@ -0,0 +1,145 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "assetstream.h"
+#include "soundasset.h"
+
+#include <string.h>
+
+#define KOSOUND_ASSET_BUFFER_SIZE (4096 * 16) /**< Size of each buffer */
+
+using namespace Kosound;
+
+/*************************************************************************
+ *                             AssetStream                               *
+ *************************************************************************/
+AssetStream::AssetStream(const SoundAsset* asset)
+            :SoundStream(SoundStream::TYPE_ASSET, KOSOUND_ASSET_BUFFER_SIZE)
+{
+   this->asset = asset;
+   frameSize = 2;
+   position = 0;
+}
+
+/*************************************************************************
+ *                            ~AssetStream                               *
+ *************************************************************************/
+AssetStream::~AssetStream()
+{
+}
+
+/*************************************************************************
+ *                                 _open                                 *
+ *************************************************************************/
+bool AssetStream::_open(const Kobold::String& fName, ALenum* f, ALuint* sr)
+{
+   if(!asset->hasPcm())
+   {
+      /* Compressed, or its data wasn't kept */
+      return false;
+   }
+
+   *f = asset->getFormat();
+   *sr = (ALuint)asset->getFrequency();
+   frameSize = (*f == AL_FORMAT_STEREO16) ? 4 : 2;
+
+   return _rewind();
+}
+
+/*************************************************************************
+ *                               _release                                *
+ *************************************************************************/
+void AssetStream::_release()
+{
+}
+
+/*************************************************************************
+ *                               _rewind                                 *
+ *************************************************************************/
+bool AssetStream::_rewind()
+{
+   position = 0;
+   return true;
+}
+
+/*************************************************************************
+ *                                _seek                                  *
+ *************************************************************************/
+bool AssetStream::_seek(int64_t frame)
+{
+   if( (frame < 0) || 
+       ((uint64_t)frame * frameSize > asset->getData().size()) )
+   {
+      return false;
+   }
+
+   position = (size_t)(frame * frameSize);
+   return true;
+}
+
+/*************************************************************************
+ *                              _mapBuffer                               *
+ *************************************************************************/
+bool AssetStream::_mapBuffer(unsigned long readBytes, const char** data,
+      unsigned long* bytesReaded, bool* gotEof)
+{
+   const std::vector<char>& pcm = asset->getData();
+
+   *gotEof = false;
+   *bytesReaded = 0;
+
+   if(position >= pcm.size())
+   {
+      *gotEof = true;
+      return true;
+   }
+
+   /* Give the remaining data (at most readBytes) */
+   *bytesReaded = pcm.size() - position;
+   if(*bytesReaded > readBytes)
+   {
+      *bytesReaded = readBytes - (readBytes % frameSize);
+   }
+   *data = &pcm[position];
+   position += *bytesReaded;
+
+   return true;
+}
+
+/*************************************************************************
+ *                              _getBuffer                               *
+ *************************************************************************/
+bool AssetStream::_getBuffer(char* buffer, unsigned long readBytes,
+      unsigned long* bytesReaded, bool* gotEof)
+{
+   const char* data = NULL;
+
+   if(!_mapBuffer(readBytes, &data, bytesReaded, gotEof))
+   {
+      return false;
+   }
+   if(*bytesReaded > 0)
+   {
+      memcpy(buffer, data, *bytesReaded);
+   }
+
+   return true;
+}
+
@@ -0,0 +1,97 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kosound_asset_stream_h
+#define _kosound_asset_stream_h
+
+#include "kosoundconfig.h"
+#include <kobold/platform.h>
+#include <kobold/kstring.h>
+
+#if KOBOLD_PLATFORM == KOBOLD_PLATFORM_IOS || \
+    KOBOLD_PLATFORM == KOBOLD_PLATFORM_MACOS
+   #include <OpenAL/al.h>
+#else
+   #include <AL/al.h>
+#endif
+
+#include "soundstream.h"
+
+namespace Kosound
+{
+
+class SoundAsset;
+
+/*! Stream of a registered asset's decoded 16-bit PCM, kept in memory by
+ * the asset (see Sound::registerAsset). There's no file nor decoder: its
+ * data is given directly to alBufferData, so a SndFx of an asset could be
+ * recycled (see Sound::addSoundEffect(SoundAssetId, ...)), just rewinding
+ * its stream, without any allocation. */
+class AssetStream : public SoundStream
+{
+   public:
+      /*! Constructor
+       * \param asset -> asset to stream. Must have its PCM data kept 
+       *                 (see SoundAsset::hasPcm), and outlive the stream. */
+      AssetStream(const SoundAsset* asset);
+      /*! Destructor */
+      virtual ~AssetStream();
+
+   protected:
+      /*! Open the asset data (fName is just its file name) */
+      bool _open(const Kobold::String& fName, ALenum* f, ALuint* sr);
+
+      /*! Nothing to release: the data belongs to the asset */
+      void _release();
+
+      /*! Rewind the stream
+       * \return true on success */
+      bool _rewind();
+
+      /*! Seek the stream to a frame
+       * \return true on success */
+      bool _seek(int64_t frame);
+
+      /*! Copy data to a buffer
+       * \param buffer -> where to put the readed data
+       * \param readBytes -> total bytes to read (could read less)
+       * \param bytesReaded -> return total bytes really readed on this call
+       * \param gotEof -> return true if got EOF
+       * \return false if some error occurred */
+      bool _getBuffer(char* buffer, unsigned long readBytes,
+            unsigned long* bytesReaded, bool* gotEof);
+
+      /*! \return true: the data is always in memory */
+      bool _canMapBuffer() { return true; };
+
+      /*! Get pointer to the next asset data. */
+      bool _mapBuffer(unsigned long readBytes, const char** data,
+            unsigned long* bytesReaded, bool* gotEof);
+
+   private:
+      const SoundAsset* asset; /**< The asset streamed */
+      unsigned long frameSize; /**< Size of each frame, in bytes */
+      size_t position;         /**< Current position (bytes) at its data */
+};
+
+}
+
+#endif
+
@@ -0,0 +1,545 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bufferedreader.h"
+
+#include <algorithm>
+#include <string.h>
+
+using namespace Kosound;
+
+/*************************************************************************
+ *                             Constructor                               *
+ *************************************************************************/
+BufferedReader::BufferedReader(Kobold::FileReader* fileReader)
+{
+   int i;
+
+   this->fileReader = fileReader;
+   chunkSize = defaultChunkSize;
+   async = defaultAsync;
+
+   for(i = 0; i < 2; i++)
+   {
+      /* Buffers only got from the pool at the first read */
+      chunks[i].data = NULL;
+      chunks[i].offset = -1;
+      chunks[i].size = 0;
+      chunks[i].valid = false;
+      chunks[i].loading = false;
+   }
+   lastUsed = 0;
+   prefetchChunk = 1;
+   position = 0;
+   length = -1;
+}
+
+/*************************************************************************
+ *                              Destructor                               *
+ *************************************************************************/
+BufferedReader::~BufferedReader()
+{
+   releaseChunks();
+}
+
+/*************************************************************************
+ *                                reset                                  *
+ *************************************************************************/
+void BufferedReader::reset()
+{
+   cancelPrefetch();
+
+   chunks[0].valid = false;
+   chunks[0].offset = -1;
+   chunks[1].valid = false;
+   chunks[1].offset = -1;
+   position = 0;
+   length = -1;
+}
+
+/*************************************************************************
+ *                              getLength                                *
+ *************************************************************************/
+int64_t BufferedReader::getLength()
+{
+   if(length < 0)
+   {
+      length = probeLength();
+   }
+
+   return length;
+}
+
+/*************************************************************************
+ *                                 read                                  *
+ *************************************************************************/
+size_t BufferedReader::read(char* dest, size_t bytes)
+{
+   size_t total = 0;
+   size_t inChunk, toCopy;
+   Chunk* chunk;
+
+   while(bytes > 0)
+   {
+      if( (length >= 0) && (position >= length) )
+      {
+         break;
+      }
+
+      chunk = getChunk(position);
+      inChunk = (size_t)(position - chunk->offset);
+      if(inChunk >= chunk->size)
+      {
+         /* EOF */
+         break;
+      }
+
+      toCopy = std::min(bytes, chunk->size - inChunk);
+      memcpy(dest + total, chunk->data + inChunk, toCopy);
+      total += toCopy;
+      bytes -= toCopy;
+      position += toCopy;
+
+      if(chunk->size == chunkSize)
+      {
+         /* While consuming this one, get the next */
+         prefetch(chunk->offset + chunkSize);
+      }
+   }
+
+   return total;
+}
+
+/*************************************************************************
+ *                                 seek                                  *
+ *************************************************************************/
+bool BufferedReader::seek(int64_t offset)
+{
+   if(offset < 0)
+   {
+      return false;
+   }
+   position = offset;
+   return true;
+}
+
+/*************************************************************************
+ *                                close                                  *
+ *************************************************************************/
+void BufferedReader::close()
+{
+   releaseChunks();
+   fileReader->close();
+}
+
+/*************************************************************************
+ *                             releaseChunks                             *
+ *************************************************************************/
+void BufferedReader::releaseChunks()
+{
+   int i;
+
+   cancelPrefetch();
+
+   std::lock_guard<std::mutex> lock(mutex);
+   if(chunks[0].data == NULL)
+   {
+      /* Not got */
+      return;
+   }
+
+   std::lock_guard<std::mutex> poolLock(poolMutex);
+   for(i = 0; i < 2; i++)
+   {
+      if(chunkSize == poolChunkSize)
+      {
+         chunkPool.push_back(chunks[i].data);
+      }
+      else
+      {
+         /* From before a setDefaults() with another size */
+         delete[] chunks[i].data;
+      }
+      chunks[i].data = NULL;
+      chunks[i].offset = -1;
+      chunks[i].valid = false;
+   }
+}
+
+/*************************************************************************
+ *                             acquireChunks                             *
+ *************************************************************************/
+void BufferedReader::acquireChunks()
+{
+   int i;
+
+   if(chunks[0].data != NULL)
+   {
+      return;
+   }
+
+   std::lock_guard<std::mutex> poolLock(poolMutex);
+   for(i = 0; i < 2; i++)
+   {
+      if( (chunkSize == poolChunkSize) && (!chunkPool.empty()) )
+      {
+         chunks[i].data = chunkPool.back();
+         chunkPool.pop_back();
+      }
+      else
+      {
+         chunks[i].data = new char[chunkSize];
+      }
+   }
+}
+
+/*************************************************************************
+ *                               getChunk                                *
+ *************************************************************************/
+BufferedReader::Chunk* BufferedReader::getChunk(int64_t pos)
+{
+   int64_t aligned = pos - (pos % chunkSize);
+   std::unique_lock<std::mutex> lock(mutex);
+   int i, victim;
+
+   for(;;)
+   {
+      /* Already at the window (or being prefetched)? */
+      for(i = 0; i < 2; i++)
+      {
+         if( (chunks[i].offset == aligned) &&
+             ((chunks[i].valid) || (chunks[i].loading)) )
+         {
+            break;
+         }
+      }
+      if(i < 2)
+      {
+         if(chunks[i].loading)
+         {
+            cond.wait(lock);
+            continue;
+         }
+         lastUsed = i;
+         return &chunks[i];
+      }
+
+      /* Must load it, replacing the least recently used. */
+      acquireChunks();
+      victim = 1 - lastUsed;
+      if(chunks[victim].loading)
+      {
+         /* Wait its prefetch to finish before reusing */
+         cond.wait(lock);
+         continue;
+      }
+      chunks[victim].offset = aligned;
+      chunks[victim].valid = false;
+      chunks[victim].loading = true;
+
+      lock.unlock();
+      load(&chunks[victim]);
+      lock.lock();
+
+      chunks[victim].loading = false;
+      chunks[victim].valid = true;
+      cond.notify_all();
+      lastUsed = victim;
+      return &chunks[victim];
+   }
+}
+
+/*************************************************************************
+ *                                 load                                  *
+ *************************************************************************/
+void BufferedReader::load(Chunk* chunk)
+{
+   size_t toRead = chunkSize;
+   size_t readed;
+   std::lock_guard<std::mutex> io(ioMutex);
+
+   if( (length >= 0) && (chunk->offset + (int64_t)toRead > length) )
+   {
+      toRead = (chunk->offset < length) ? (size_t)(length - chunk->offset) : 0;
+   }
+
+   chunk->size = 0;
+   fileReader->seek(chunk->offset);
+   while( (chunk->size < toRead) && (!fileReader->eof()) )
+   {
+      readed = fileReader->read(chunk->data + chunk->size,
+            toRead - chunk->size);
+      if(readed == 0)
+      {
+         break;
+      }
+      chunk->size += readed;
+   }
+
+   if( (chunk->size > 0) && (chunk->size < chunkSize) )
+   {
+      /* Short read: got the file end, with no probe needed */
+      length = chunk->offset + (int64_t)chunk->size;
+   }
+}
+
+/*************************************************************************
+ *                              probeLength                              *
+ *************************************************************************/
+int64_t BufferedReader::probeLength()
+{
+   std::lock_guard<std::mutex> io(ioMutex);
+   int64_t low, high, mid;
+
+   if(!hasByte(0))
+   {
+      return 0;
+   }
+
+   /* Find a range [low, high] with the length, doubling from a chunk */
+   low = 1;
+   high = chunkSize;
+   while(hasByte(high))
+   {
+      low = high + 1;
+      high *= 2;
+   }
+
+   /* And the first offset without data inside it */
+   while(low < high)
+   {
+      mid = low + (high - low) / 2;
+      if(hasByte(mid))
+      {
+         low = mid + 1;
+      }
+      else
+      {
+         high = mid;
+      }
+   }
+
+   return low;
+}
+
+/*************************************************************************
+ *                                hasByte                                *
+ *************************************************************************/
+bool BufferedReader::hasByte(int64_t offset)
+{
+   char byte;
+
+   fileReader->seek((size_t)offset);
+   return (!fileReader->eof()) && (fileReader->read(&byte, 1) == 1);
+}
+
+/*************************************************************************
+ *                               prefetch                                *
+ *************************************************************************/
+void BufferedReader::prefetch(int64_t offset)
+{
+   int i;
+
+   if( (!async) || ((length >= 0) && (offset >= length)) )
+   {
+      return;
+   }
+
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      if(chunks[0].data == NULL)
+      {
+         /* Released: nothing to prefetch into */
+         return;
+      }
+      for(i = 0; i < 2; i++)
+      {
+         if( (chunks[i].offset == offset) &&
+             ((chunks[i].valid) || (chunks[i].loading)) )
+         {
+            /* Already got or getting it */
+            return;
+         }
+      }
+      prefetchChunk = 1 - lastUsed;
+      if(chunks[prefetchChunk].loading)
+      {
+         return;
+      }
+      chunks[prefetchChunk].offset = offset;
+      chunks[prefetchChunk].valid = false;
+      chunks[prefetchChunk].loading = true;
+   }
+
+   std::lock_guard<std::mutex> lock(prefetchMutex);
+   if(!prefetchThread.joinable())
+   {
+      prefetchQuit = false;
+      prefetchThread = std::thread(&BufferedReader::prefetchLoop);
+   }
+   prefetchQueue.push_back(this);
+   prefetchCond.notify_all();
+}
+
+/*************************************************************************
+ *                             runPrefetch                               *
+ *************************************************************************/
+void BufferedReader::runPrefetch()
+{
+   Chunk* chunk = &chunks[prefetchChunk];
+
+   load(chunk);
+
+   std::lock_guard<std::mutex> lock(mutex);
+   chunk->loading = false;
+   chunk->valid = true;
+   cond.notify_all();
+}
+
+/*************************************************************************
+ *                            cancelPrefetch                             *
+ *************************************************************************/
+void BufferedReader::cancelPrefetch()
+{
+   std::vector<BufferedReader*>::iterator it;
+   std::unique_lock<std::mutex> lock(prefetchMutex);
+
+   /* Remove a not yet started request */
+   it = std::find(prefetchQueue.begin(), prefetchQueue.end(), this);
+   if(it != prefetchQueue.end())
+   {
+      prefetchQueue.erase(it);
+      std::lock_guard<std::mutex> chunkLock(mutex);
+      chunks[prefetchChunk].loading = false;
+      chunks[prefetchChunk].valid = false;
+   }
+
+   /* Wait a running one */
+   while(prefetching == this)
+   {
+      prefetchCond.wait(lock);
+   }
+}
+
+/*************************************************************************
+ *                             prefetchLoop                              *
+ *************************************************************************/
+void BufferedReader::prefetchLoop()
+{
+   BufferedReader* reader;
+   std::unique_lock<std::mutex> lock(prefetchMutex);
+
+   while(!prefetchQuit)
+   {
+      if(prefetchQueue.empty())
+      {
+         prefetchCond.wait(lock);
+         continue;
+      }
+
+      reader = prefetchQueue.front();
+      prefetchQueue.erase(prefetchQueue.begin());
+      prefetching = reader;
+
+      lock.unlock();
+      reader->runPrefetch();
+      lock.lock();
+
+      prefetching = NULL;
+      prefetchCond.notify_all();
+   }
+}
+
+/*************************************************************************
+ *                            stopPrefetcher                             *
+ *************************************************************************/
+void BufferedReader::stopPrefetcher()
+{
+   size_t i;
+   std::unique_lock<std::mutex> lock(prefetchMutex);
+   if(!prefetchThread.joinable())
+   {
+      return;
+   }
+
+   /* Pending requests are done synchronously when needed */
+   for(i = 0; i < prefetchQueue.size(); i++)
+   {
+      BufferedReader* reader = prefetchQueue[i];
+      std::lock_guard<std::mutex> chunkLock(reader->mutex);
+      reader->chunks[reader->prefetchChunk].loading = false;
+      reader->chunks[reader->prefetchChunk].valid = false;
+   }
+   prefetchQueue.clear();
+   prefetchQuit = true;
+   prefetchCond.notify_all();
+   lock.unlock();
+
+   prefetchThread.join();
+}
+
+/*************************************************************************
+ *                             setDefaults                               *
+ *************************************************************************/
+void BufferedReader::setDefaults(size_t chunkSize, bool asyncPrefetch)
+{
+   defaultChunkSize = chunkSize;
+   defaultAsync = asyncPrefetch;
+
+   if(chunkSize != poolChunkSize)
+   {
+      /* Pooled buffers are of the old size: no more usable */
+      clearChunkPool();
+      std::lock_guard<std::mutex> poolLock(poolMutex);
+      poolChunkSize = chunkSize;
+   }
+}
+
+/*************************************************************************
+ *                            clearChunkPool                             *
+ *************************************************************************/
+void BufferedReader::clearChunkPool()
+{
+   size_t i;
+   std::lock_guard<std::mutex> poolLock(poolMutex);
+
+   for(i = 0; i < chunkPool.size(); i++)
+   {
+      delete[] chunkPool[i];
+   }
+   chunkPool.clear();
+   chunkPool.shrink_to_fit();
+}
+
+/*************************************************************************
+ *                            static members                             *
+ *************************************************************************/
+size_t BufferedReader::defaultChunkSize = KOSOUND_READ_AHEAD_CHUNK_SIZE;
+bool BufferedReader::defaultAsync = false;
+std::vector<char*> BufferedReader::chunkPool;
+size_t BufferedReader::poolChunkSize = KOSOUND_READ_AHEAD_CHUNK_SIZE;
+std::mutex BufferedReader::poolMutex;
+std::thread BufferedReader::prefetchThread;
+std::mutex BufferedReader::prefetchMutex;
+std::condition_variable BufferedReader::prefetchCond;
+std::vector<BufferedReader*> BufferedReader::prefetchQueue;
+BufferedReader* BufferedReader::prefetching = NULL;
+bool BufferedReader::prefetchQuit = false;
+
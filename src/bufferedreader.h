@@ -0,0 +1,183 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kosound_buffered_reader_h
+#define _kosound_buffered_reader_h
+
+#include "kosoundconfig.h"
+#include <kobold/filereader.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <vector>
+#include <mutex>
+#include <thread>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Kosound
+{
+
+/*! Default size of each read-ahead chunk */
+#define KOSOUND_READ_AHEAD_CHUNK_SIZE  (4096 * 16)
+
+/*! A read-ahead layer over a FileReader. Reads are done in large chunks,
+ * aligned to its size at the file, kept in two buffers (the current
+ * window and the next or previous one), so the many small reads of a
+ * decoder cost a single FileReader read per chunk, and seeks landing
+ * inside the window cost no I/O at all.
+ * The two buffers are only held while the file is being read: they're
+ * got from a pool shared by all readers at the first read, and given
+ * back to it by releaseChunks() (for example, once the file was fully
+ * read), so an idle or finished reader costs no chunk memory.
+ * Optionally, the next chunk is prefetched asynchronously by a thread
+ * shared by all readers, while the current one is consumed. */
+class BufferedReader
+{
+   public:
+      /*! Constructor, using the current defaults (see setDefaults).
+       * \param fileReader -> reader to read from. Not owned: it must be
+       *                      deleted by the caller, after this one. */
+      BufferedReader(Kobold::FileReader* fileReader);
+      /*! Destructor */
+      ~BufferedReader();
+
+      /*! Reset the reader to the start of an (re)opened file. Its length
+       * is only known when a read gets its end, or at getLength(). */
+      void reset();
+
+      /*! Read data at current position
+       * \param dest -> where to read to
+       * \param bytes -> bytes to read
+       * \return bytes readed (less than bytes only at EOF) */
+      size_t read(char* dest, size_t bytes);
+
+      /*! Set current position (no I/O is done here)
+       * \param offset -> new position, from the file start
+       * \return false if invalid */
+      bool seek(int64_t offset);
+
+      /*! \return current position */
+      int64_t tell() const { return position; };
+
+      /*! \return file length. If not yet known, it's probed here (see
+       * probeLength), so only call it when really needed. */
+      int64_t getLength();
+
+      /*! Close the file, cancelling any pending prefetch and releasing
+       * its chunks */
+      void close();
+
+      /*! Give the chunk buffers back to the shared pool (cancelling any
+       * pending prefetch). They are got again at the next read. */
+      void releaseChunks();
+
+      /*! Define defaults for the next created readers.
+       * \param chunkSize -> size of each chunk
+       * \param asyncPrefetch -> if will prefetch on the shared thread */
+      static void setDefaults(size_t chunkSize, bool asyncPrefetch);
+
+      /*! Stop the shared prefetch thread (started again when needed) */
+      static void stopPrefetcher();
+
+      /*! Delete the pooled chunk buffers (the ones in use by readers are
+       * pooled again on their release) */
+      static void clearChunkPool();
+
+   private:
+      /*! A read-ahead chunk */
+      class Chunk
+      {
+         public:
+            char* data;      /**< Its buffer */
+            int64_t offset;  /**< File offset of its data */
+            size_t size;     /**< Bytes readed (< chunkSize only at EOF) */
+            bool valid;      /**< If data is loaded */
+            bool loading;    /**< If data is being loaded */
+      };
+
+      /*! Get the chunk with a position, loading it if needed
+       * \return the chunk */
+      Chunk* getChunk(int64_t pos);
+
+      /*! Load a chunk (marked as loading) from the file */
+      void load(Chunk* chunk);
+
+      /*! Get both chunk buffers from the pool (or allocate them), if not
+       * already got. Called with mutex locked. */
+      void acquireChunks();
+
+      /*! Find the file length, as FileReader has no size query: an
+       * exponential then binary search for the first offset with no
+       * byte to read, so only O(log(length)) single byte reads.
+       * \return file length, in bytes */
+      int64_t probeLength();
+
+      /*! \return if there's a byte to read at offset */
+      bool hasByte(int64_t offset);
+
+      /*! Request the asynchronous prefetch of the chunk at offset */
+      void prefetch(int64_t offset);
+
+      /*! Load the chunk requested by prefetch(), at the prefetch thread */
+      void runPrefetch();
+
+      /*! Cancel (or wait) any prefetch of this reader */
+      void cancelPrefetch();
+
+      /*! Main loop of the prefetch thread */
+      static void prefetchLoop();
+
+      Kobold::FileReader* fileReader; /**< The file */
+      Chunk chunks[2];         /**< Window chunks */
+      int lastUsed;            /**< Index of the last used chunk */
+      int prefetchChunk;       /**< Index of the chunk being prefetched */
+      size_t chunkSize;        /**< Size of each chunk */
+      bool async;              /**< If prefetch is asynchronous */
+      int64_t position;        /**< Current position */
+      std::atomic<int64_t> length; /**< File length, or -1 if unknown */
+
+      std::mutex mutex;               /**< Protect chunk states */
+      std::condition_variable cond;   /**< Signal a chunk load end */
+      std::mutex ioMutex;             /**< Serialize fileReader usage */
+
+      static size_t defaultChunkSize;   /**< Chunk size for new readers */
+      static bool defaultAsync;         /**< Async for new readers */
+
+      /*! Unused chunk buffers, all of poolChunkSize bytes (a vector: no
+       * allocation once grown) */
+      static std::vector<char*> chunkPool;
+      static size_t poolChunkSize;      /**< Size of pooled buffers */
+      static std::mutex poolMutex;      /**< Protect the pool */
+
+      static std::thread prefetchThread;        /**< Shared prefetch thread */
+      static std::mutex prefetchMutex;          /**< Protect the queue */
+      static std::condition_variable prefetchCond; /**< Signal changes */
+      /*! Requests, oldest first (a vector: no allocation once grown) */
+      static std::vector<BufferedReader*> prefetchQueue;
+      static BufferedReader* prefetching;       /**< Reader being served */
+      static bool prefetchQuit;                 /**< If must quit */
+};
+
+}
+
+#endif
+
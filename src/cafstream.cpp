@@ -159,7 +159,20 @@ bool CafStream::_rewind()
    /* Rewind the file */
    if(ExtAudioFileSeek(extAudioFile, initialFrameOffset))
    {
-      Kobold::Log::add(Kobold::Log::LOG_LEVEL_ERROR, "CAF Rewind Error!");
+      logError(StreamLog::ERROR_REWIND);
+      return false;
+   }
+   return true;
+}
+
+/*************************************************************************
+ *                                _seek                                  *
+ *************************************************************************/
+bool CafStream::_seek(int64_t frame)
+{
+   if(ExtAudioFileSeek(extAudioFile, initialFrameOffset + frame))
+   {
+      Kobold::Log::add(Kobold::Log::LOG_LEVEL_ERROR, "CAF Seek Error!");
       return false;
    }
    return true;
@@ -168,7 +181,7 @@ bool CafStream::_rewind()
 /*************************************************************************
  *                               _getBuffer                              *
  *************************************************************************/
-bool CafStream::_getBuffer(unsigned long index, unsigned long readBytes, 
+bool CafStream::_getBuffer(char* buffer, unsigned long readBytes, 
                 unsigned long* bytesReaded, bool* gotEof)
 {
    UInt32 maxFrames=0; /* Max frames could read this time */
@@ -178,7 +191,7 @@ bool CafStream::_getBuffer(unsigned long index, unsigned long readBytes,
    dataBuffer.mNumberBuffers = 1;
    dataBuffer.mBuffers[0].mDataByteSize = readBytes;
    dataBuffer.mBuffers[0].mNumberChannels = outputFormat.mChannelsPerFrame;
-   dataBuffer.mBuffers[0].mData = &bufferData[index];
+   dataBuffer.mBuffers[0].mData = buffer;
    
    
    /* Calculate number of frames that fits the buffer */
@@ -189,8 +202,7 @@ bool CafStream::_getBuffer(unsigned long index, unsigned long readBytes,
    err = ExtAudioFileRead(extAudioFile, &maxFrames, &dataBuffer);
    if(err != noErr)
    {
-      Kobold::Log::add(Kobold::Log::LOG_LEVEL_ERROR, "CAF buffer error: %s",
-               errorString(err).c_str());
+      logError(StreamLog::ERROR_DECODE, (int)err);
       return false;
    }
    
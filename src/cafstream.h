@@ -57,14 +57,18 @@ namespace Kosound
       /*! Rewind the stream
        * \return true on success */
       bool _rewind();
+
+      /*! Seek the stream to a frame
+       * \return true on success */
+      bool _seek(int64_t frame);
    
-      /*! Read data to the internal buffer
-       * \param index -> first position on the buffer to fill
+      /*! Read data to a buffer
+       * \param buffer -> where to put the readed data
        * \param readBytes -> total bytes to read (could read less)
        * \param bytesReaded -> return total bytes really readed on this call
        * \param gotEof -> return true if got EOF
        * \return false if some error occurred */
-      bool _getBuffer(unsigned long index, unsigned long readBytes, 
+      bool _getBuffer(char* buffer, unsigned long readBytes, 
                       unsigned long* bytesReaded, bool* gotEof);
    
       /*! Error code
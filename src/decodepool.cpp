@@ -0,0 +1,261 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "decodepool.h"
+
+using namespace Kosound;
+
+/*************************************************************************
+ *                             Constructor                               *
+ *************************************************************************/
+DecodeBudget::DecodeBudget()
+{
+   minQueued = 0.0;
+   limited = false;
+}
+
+/*************************************************************************
+ *                                 start                                 *
+ *************************************************************************/
+void DecodeBudget::start(unsigned long microseconds, double minQueued)
+{
+   this->limited = (microseconds > 0);
+   this->minQueued = minQueued;
+   if(limited)
+   {
+      deadline = std::chrono::steady_clock::now() + 
+                 std::chrono::microseconds(microseconds);
+   }
+}
+
+/*************************************************************************
+ *                                allows                                 *
+ *************************************************************************/
+bool DecodeBudget::allows(const DecodeJob& job) const
+{
+   /* Never starve the ones about to underrun */
+   return (job.urgency < minQueued) || (!isOver());
+}
+
+/*************************************************************************
+ *                                isOver                                 *
+ *************************************************************************/
+bool DecodeBudget::isOver() const
+{
+   return (limited) && (std::chrono::steady_clock::now() >= deadline);
+}
+
+/*************************************************************************
+ *                             Constructor                               *
+ *************************************************************************/
+DecodePool::DecodePool(int threads)
+{
+   int i;
+
+   current = NULL;
+   budget = NULL;
+   batch = 0;
+   quit = false;
+   pending = 0;
+
+   /* The caller is the first worker, plus the threads */
+   for(i = 0; i <= threads; i++)
+   {
+      Worker* worker = new Worker();
+      worker->scratch = new char[KOSOUND_MAX_STREAM_BUFFER_SIZE];
+      worker->next = 0;
+      workers.push_back(worker);
+   }
+   for(i = 1; i <= threads; i++)
+   {
+      workers[i]->thread = std::thread(&DecodePool::workerLoop, this, i);
+   }
+}
+
+/*************************************************************************
+ *                              Destructor                               *
+ *************************************************************************/
+DecodePool::~DecodePool()
+{
+   size_t i;
+
+   batchMutex.lock();
+   quit = true;
+   batchMutex.unlock();
+   batchCond.notify_all();
+
+   for(i = 0; i < workers.size(); i++)
+   {
+      if(workers[i]->thread.joinable())
+      {
+         workers[i]->thread.join();
+      }
+      delete[] workers[i]->scratch;
+      delete workers[i];
+   }
+}
+
+/*************************************************************************
+ *                                 run                                   *
+ *************************************************************************/
+void DecodePool::run(std::vector<DecodeJob>& jobs, 
+      const DecodeBudget& budget)
+{
+   size_t i, job;
+
+   if(jobs.empty())
+   {
+      return;
+   }
+
+   current = &jobs;
+   this->budget = &budget;
+   pending = jobs.size();
+
+   /* Distribute in urgency order, so each worker's jobs are sorted too */
+   for(i = 0; i < workers.size(); i++)
+   {
+      workers[i]->mutex.lock();
+      workers[i]->jobs.clear();
+      workers[i]->next = 0;
+      workers[i]->mutex.unlock();
+   }
+   for(i = 0; i < jobs.size(); i++)
+   {
+      Worker* worker = workers[i % workers.size()];
+      worker->mutex.lock();
+      worker->jobs.push_back(i);
+      worker->mutex.unlock();
+   }
+
+   /* Wake up the threads */
+   batchMutex.lock();
+   batch++;
+   batchMutex.unlock();
+   batchCond.notify_all();
+
+   /* Work too, then wait for the others */
+   while(getJob(0, &job))
+   {
+      execute(0, job);
+   }
+
+   std::unique_lock<std::mutex> lock(batchMutex);
+   while(pending > 0)
+   {
+      doneCond.wait(lock);
+   }
+   current = NULL;
+   this->budget = NULL;
+}
+
+/*************************************************************************
+ *                              workerLoop                               *
+ *************************************************************************/
+void DecodePool::workerLoop(int index)
+{
+   unsigned long seen = 0;
+   size_t job;
+
+   for(;;)
+   {
+      {
+         /* Wait for a new batch */
+         std::unique_lock<std::mutex> lock(batchMutex);
+         while( (!quit) && (batch == seen) )
+         {
+            batchCond.wait(lock);
+         }
+         if(quit)
+         {
+            return;
+         }
+         seen = batch;
+      }
+
+      while(getJob(index, &job))
+      {
+         execute(index, job);
+      }
+   }
+}
+
+/*************************************************************************
+ *                                getJob                                 *
+ *************************************************************************/
+bool DecodePool::getJob(int index, size_t* job)
+{
+   size_t i;
+   Worker* worker = workers[index];
+
+   /* The most urgent of our own */
+   worker->mutex.lock();
+   if(worker->next < worker->jobs.size())
+   {
+      *job = worker->jobs[worker->next];
+      worker->next++;
+      worker->mutex.unlock();
+      return true;
+   }
+   worker->mutex.unlock();
+
+   /* Steal the least urgent of another one */
+   for(i = 1; i < workers.size(); i++)
+   {
+      Worker* victim = workers[(index + i) % workers.size()];
+      victim->mutex.lock();
+      if(victim->next < victim->jobs.size())
+      {
+         *job = victim->jobs.back();
+         victim->jobs.pop_back();
+         victim->mutex.unlock();
+         return true;
+      }
+      victim->mutex.unlock();
+   }
+
+   return false;
+}
+
+/*************************************************************************
+ *                               execute                                 *
+ *************************************************************************/
+void DecodePool::execute(int index, size_t job)
+{
+   DecodeJob& decodeJob = (*current)[job];
+
+   if(budget->allows(decodeJob))
+   {
+      decodeJob.result = decodeJob.sndFx->update(workers[index]->scratch);
+   }
+   else
+   {
+      decodeJob.deferred = true;
+   }
+
+   if(--pending == 0)
+   {
+      /* Last one: tell run() the batch is done */
+      batchMutex.lock();
+      batchMutex.unlock();
+      doneCond.notify_all();
+   }
+}
+
@@ -0,0 +1,186 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kosound_decode_pool_h
+#define _kosound_decode_pool_h
+
+#include "kosoundconfig.h"
+#include "sndfx.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Kosound
+{
+
+/*! A sound effect update to be done by the DecodePool */
+class DecodeJob
+{
+   public:
+      SndFx* sndFx;    /**< Sound effect to update */
+      double urgency;  /**< Queued audio time (lesser is more urgent) */
+      bool result;     /**< Return of SndFx::update() */
+      bool deferred;   /**< If left to the next flush, by the budget */
+
+      /*! Compare by urgency (most urgent first) */
+      bool operator<(const DecodeJob& other) const
+      {
+         return urgency < other.urgency;
+      };
+};
+
+/*! A sound effect stream by its source, to map AL events to it */
+class StreamSource
+{
+   public:
+      ALuint source;   /**< Its source */
+      SndFx* sndFx;    /**< The sound effect */
+
+      /*! Compare by source */
+      bool operator<(const StreamSource& other) const
+      {
+         return source < other.source;
+      };
+};
+
+/*! When a sound effect stream needs its next update, as kept at a heap.
+ * Entries aren't removed when their stream is rescheduled or deleted:
+ * one is only valid if its stream is still playing at its source and 
+ * is due (see Sound::updateStreams). */
+class StreamDeadline
+{
+   public:
+      unsigned long time; /**< Deadline (ms, at Sound's clock) */
+      ALuint source;      /**< Source of the stream when pushed */
+      SndFx* sndFx;       /**< The stream (only compared: could be gone) */
+
+      /*! Compare by deadline, latest first (so a heap gives the earliest)*/
+      bool operator<(const StreamDeadline& other) const
+      {
+         return time > other.time;
+      };
+};
+
+/*! Decode time limit of a batch of jobs (see Sound::setDecodeBudget).
+ * Once over, only the jobs of streams close to an underrun still run: 
+ * the others are deferred. */
+class DecodeBudget
+{
+   public:
+      /*! Constructor: no limit */
+      DecodeBudget();
+
+      /*! Start the budget of a batch
+       * \param microseconds -> its time, from now (0 for no limit)
+       * \param minQueued -> jobs with less queued time (urgency), in 
+       *                    seconds, run even when the budget is over */
+      void start(unsigned long microseconds, double minQueued);
+
+      /*! \return if a job could run now */
+      bool allows(const DecodeJob& job) const;
+
+      /*! \return if its time is over */
+      bool isOver() const;
+
+   private:
+      std::chrono::steady_clock::time_point deadline; /**< End of it */
+      double minQueued; /**< Urgency of the jobs that always run */
+      bool limited;     /**< If there's a limit */
+};
+
+/*! Statistics of the decode budget (see Sound::getDecodeBudgetStats) */
+class DecodeBudgetStats
+{
+   public:
+      unsigned long flushes;  /**< Flushes with streams to update */
+      unsigned long overruns; /**< Flushes ended after the budget, by 
+                                   the streams close to an underrun */
+      unsigned long deferrals; /**< Flushes deferring some streams */
+      unsigned long deferredJobs; /**< Total stream updates deferred */
+};
+
+/*! A small work-stealing thread pool to update (and thus decode) sound
+ * streams in parallel. Each worker has its own jobs deque, filled in
+ * urgency order, and its own scratch buffer to decode into. A worker
+ * without jobs steals the least urgent ones from the others. The thread
+ * calling run() works too, as the first worker. */
+class DecodePool
+{
+   public:
+      /*! Constructor
+       * \param threads -> number of threads to create (besides the
+       *                   caller of run()). */
+      DecodePool(int threads);
+      /*! Destructor: stop and join all threads */
+      ~DecodePool();
+
+      /*! Run all jobs, returning only after all are done.
+       * \param jobs -> jobs to run, sorted by urgency. Each result (or
+       *                if deferred) is set on return. 
+       * \param budget -> limit of the jobs decode time */
+      void run(std::vector<DecodeJob>& jobs, const DecodeBudget& budget);
+
+      /*! \return total of threads used (including the run() caller) */
+      int getTotalThreads() const { return (int)workers.size(); };
+
+   private:
+      /*! A worker thread (or the caller, at index 0) */
+      class Worker
+      {
+         public:
+            std::mutex mutex;          /**< Protect its jobs */
+            /*! Indexes of its jobs, most urgent first (a vector reused
+             * by each batch, so no allocation in steady state) */
+            std::vector<size_t> jobs;
+            size_t next;               /**< Its next job at jobs */
+            char* scratch;             /**< Its decode buffer */
+            std::thread thread;        /**< Its thread (if not caller) */
+      };
+
+      /*! Main loop of each worker thread */
+      void workerLoop(int index);
+
+      /*! Get next job to run: own most urgent, or steal from others.
+       * \return false if there's no more jobs */
+      bool getJob(int index, size_t* job);
+
+      /*! Run a job */
+      void execute(int index, size_t job);
+
+      std::vector<Worker*> workers;     /**< All workers */
+      std::vector<DecodeJob>* current;  /**< Current batch of jobs */
+      const DecodeBudget* budget;       /**< Budget of current batch */
+
+      std::mutex batchMutex;            /**< Protect batch and quit */
+      std::condition_variable batchCond;/**< Signaled at new batch */
+      std::condition_variable doneCond; /**< Signaled at batch end */
+      unsigned long batch;              /**< Current batch number */
+      bool quit;                        /**< If threads must end */
+      std::atomic<size_t> pending;      /**< Jobs not yet done */
+};
+
+}
+
+#endif
+
@@ -0,0 +1,73 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "downmix.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+   #include <emmintrin.h>
+   #define KOSOUND_DOWNMIX_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+   #include <arm_neon.h>
+   #define KOSOUND_DOWNMIX_NEON 1
+#endif
+
+using namespace Kosound;
+
+/*************************************************************************
+ *                             stereoToMono                              *
+ *************************************************************************/
+void Downmix::stereoToMono(const int16_t* stereo, int16_t* mono, 
+      size_t frames)
+{
+   size_t i = 0;
+
+#if defined(KOSOUND_DOWNMIX_SSE2)
+   const __m128i ones = _mm_set1_epi16(1);
+   __m128i a, b;
+
+   /* 8 frames each step. When in-place, each store is behind the loads */
+   for(; i + 8 <= frames; i += 8)
+   {
+      a = _mm_loadu_si128((const __m128i*)(stereo + 2 * i));
+      b = _mm_loadu_si128((const __m128i*)(stereo + 2 * i + 8));
+      /* L + R of each frame, at 32 bits */
+      a = _mm_srai_epi32(_mm_madd_epi16(a, ones), 1);
+      b = _mm_srai_epi32(_mm_madd_epi16(b, ones), 1);
+      _mm_storeu_si128((__m128i*)(mono + i), _mm_packs_epi32(a, b));
+   }
+#elif defined(KOSOUND_DOWNMIX_NEON)
+   int16x8x2_t lr;
+
+   for(; i + 8 <= frames; i += 8)
+   {
+      /* Deinterleave, then (L + R) >> 1 without overflow */
+      lr = vld2q_s16(stereo + 2 * i);
+      vst1q_s16(mono + i, vhaddq_s16(lr.val[0], lr.val[1]));
+   }
+#endif
+
+   /* The remaining ones (or all, without SIMD) */
+   for(; i < frames; i++)
+   {
+      mono[i] = (int16_t)(((int32_t)stereo[2 * i] + stereo[2 * i + 1]) >> 1);
+   }
+}
+
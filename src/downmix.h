@@ -0,0 +1,49 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kosound_downmix_h
+#define _kosound_downmix_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace Kosound
+{
+
+/*! Conversion of decoded 16-bit PCM from stereo to mono (OpenAL only 
+ * spatializes mono buffers), vectorized with SSE2 or NEON when 
+ * available. */
+class Downmix
+{
+   public:
+      /*! Downmix interleaved stereo frames to mono, averaging both 
+       * channels (rounding down, as an arithmetic shift).
+       * \param stereo -> stereo frames (L, R, L, R...)
+       * \param mono -> where to write the mono frames. Could be the same
+       *               as stereo (in-place), but not otherwise overlapping.
+       * \param frames -> number of frames */
+      static void stereoToMono(const int16_t* stereo, int16_t* mono, 
+            size_t frames);
+};
+
+}
+
+#endif
+
@@ -0,0 +1,195 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "kosndformat.h"
+
+#include <string.h>
+
+using namespace Kosound;
+
+/*! Magic bytes identifying a .kosnd file */
+static const char KOSND_MAGIC[8] = {'K','O','S','N','D','P','C','M'};
+
+/*************************************************************************
+ *                             Constructor                               *
+ *************************************************************************/
+KosndHeader::KosndHeader()
+{
+   version = KOSND_VERSION;
+   channels = 0;
+   sampleRate = 0;
+   sourceRate = 0;
+   flags = 0;
+   totalFrames = 0;
+   blockFrames = KOSND_DEFAULT_BLOCK_FRAMES;
+   blockCount = 0;
+   seekTableOffset = KOSND_HEADER_SIZE;
+   dataOffset = 0;
+}
+
+/*************************************************************************
+ *                                parse                                  *
+ *************************************************************************/
+bool KosndHeader::parse(const unsigned char* data)
+{
+   if(memcmp(data, KOSND_MAGIC, sizeof(KOSND_MAGIC)) != 0)
+   {
+      return false;
+   }
+
+   version = readU16(&data[8]);
+   channels = readU16(&data[10]);
+   sampleRate = readU32(&data[12]);
+   sourceRate = readU32(&data[16]);
+   flags = readU32(&data[20]);
+   totalFrames = readU64(&data[24]);
+   blockFrames = readU32(&data[32]);
+   blockCount = readU32(&data[36]);
+   seekTableOffset = readU64(&data[40]);
+   dataOffset = readU64(&data[48]);
+
+   /* Check if it's something we know how to play. The blocks must cover
+    * all frames, but without any block past the last frame (or the last
+    * block's size would underflow). */
+   if( (version == 0) || (version > KOSND_VERSION) ||
+       (channels < 1) || (channels > 2) ||
+       (sampleRate == 0) || (blockFrames == 0) || (blockCount == 0) ||
+       (dataOffset % KOSND_ALIGNMENT != 0) ||
+       ((uint64_t)blockCount * blockFrames < totalFrames) ||
+       ((uint64_t)(blockCount - 1) * blockFrames >= totalFrames) )
+   {
+      return false;
+   }
+
+   return true;
+}
+
+/*************************************************************************
+ *                              serialize                                *
+ *************************************************************************/
+void KosndHeader::serialize(unsigned char* data) const
+{
+   memset(data, 0, KOSND_HEADER_SIZE);
+   memcpy(data, KOSND_MAGIC, sizeof(KOSND_MAGIC));
+
+   writeU16(&data[8], version);
+   writeU16(&data[10], channels);
+   writeU32(&data[12], sampleRate);
+   writeU32(&data[16], sourceRate);
+   writeU32(&data[20], flags);
+   writeU64(&data[24], totalFrames);
+   writeU32(&data[32], blockFrames);
+   writeU32(&data[36], blockCount);
+   writeU64(&data[40], seekTableOffset);
+   writeU64(&data[48], dataOffset);
+}
+
+/*************************************************************************
+ *                             getFrameSize                              *
+ *************************************************************************/
+uint32_t KosndHeader::getFrameSize() const
+{
+   return 2 * channels;
+}
+
+/*************************************************************************
+ *                            getBlockFrames                             *
+ *************************************************************************/
+uint32_t KosndHeader::getBlockFrames(uint32_t block) const
+{
+   if(block + 1 < blockCount)
+   {
+      return blockFrames;
+   }
+   else if(block + 1 == blockCount)
+   {
+      /* Last block: only the remaining frames */
+      return (uint32_t)(totalFrames - (uint64_t)block * blockFrames);
+   }
+
+   return 0;
+}
+
+/*************************************************************************
+ *                             getBlockSize                              *
+ *************************************************************************/
+uint32_t KosndHeader::getBlockSize(uint32_t block) const
+{
+   return getBlockFrames(block) * getFrameSize();
+}
+
+/*************************************************************************
+ *                          getAlignedBlockSize                          *
+ *************************************************************************/
+uint32_t KosndHeader::getAlignedBlockSize(uint32_t block) const
+{
+   return (uint32_t) align(getBlockSize(block));
+}
+
+/*************************************************************************
+ *                                 align                                 *
+ *************************************************************************/
+uint64_t KosndHeader::align(uint64_t offset)
+{
+   return (offset + KOSND_ALIGNMENT - 1) & ~((uint64_t)KOSND_ALIGNMENT - 1);
+}
+
+/*************************************************************************
+ *                               readUXX                                 *
+ *************************************************************************/
+uint16_t KosndHeader::readU16(const unsigned char* data)
+{
+   return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+uint32_t KosndHeader::readU32(const unsigned char* data)
+{
+   return ((uint32_t)data[0]) | ((uint32_t)data[1] << 8) |
+          ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+uint64_t KosndHeader::readU64(const unsigned char* data)
+{
+   return ((uint64_t)readU32(data)) | ((uint64_t)readU32(&data[4]) << 32);
+}
+
+/*************************************************************************
+ *                              writeUXX                                 *
+ *************************************************************************/
+void KosndHeader::writeU16(unsigned char* data, uint16_t value)
+{
+   data[0] = value & 0xFF;
+   data[1] = (value >> 8) & 0xFF;
+}
+
+void KosndHeader::writeU32(unsigned char* data, uint32_t value)
+{
+   data[0] = value & 0xFF;
+   data[1] = (value >> 8) & 0xFF;
+   data[2] = (value >> 16) & 0xFF;
+   data[3] = (value >> 24) & 0xFF;
+}
+
+void KosndHeader::writeU64(unsigned char* data, uint64_t value)
+{
+   writeU32(data, (uint32_t)(value & 0xFFFFFFFF));
+   writeU32(&data[4], (uint32_t)(value >> 32));
+}
+
@@ -0,0 +1,108 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kosound_kosnd_format_h
+#define _kosound_kosnd_format_h
+
+#include <stdint.h>
+
+namespace Kosound
+{
+
+#define KOSND_VERSION          1    /**< Current .kosnd format version */
+#define KOSND_HEADER_SIZE     64    /**< Size of the serialized header */
+#define KOSND_SEEK_ENTRY_SIZE  8    /**< Size of each seek table entry */
+#define KOSND_ALIGNMENT       16    /**< Alignment of every data block */
+#define KOSND_DEFAULT_BLOCK_FRAMES 8192 /**< Default frames per block */
+
+#define KOSND_FLAG_DOWNMIXED   0x01 /**< Source was downmixed to mono */
+#define KOSND_FLAG_RESAMPLED   0x02 /**< Source was resampled */
+
+/*! Header of the .kosnd pre-decoded file format.
+ *
+ * A .kosnd file stores 16-bit signed little-endian interleaved PCM, already
+ * decoded (and optionally resampled and downmixed) by kosound_convert.
+ * Its layout is:
+ *    - the 64 bytes header;
+ *    - the seek table: blockCount entries with the absolute file offset
+ *      (uint64) of each block;
+ *    - the data blocks, each one starting at a KOSND_ALIGNMENT boundary and
+ *      holding blockFrames frames (except the last one, which may be
+ *      shorter), zero padded to the next boundary.
+ * All integers are stored little-endian. */
+class KosndHeader
+{
+   public:
+      /*! Constructor: a header with no data */
+      KosndHeader();
+
+      /*! Parse the header from its serialized form
+       * \param data -> KOSND_HEADER_SIZE bytes to parse
+       * \return false if not a valid .kosnd header */
+      bool parse(const unsigned char* data);
+
+      /*! Serialize the header
+       * \param data -> buffer with at least KOSND_HEADER_SIZE bytes */
+      void serialize(unsigned char* data) const;
+
+      /*! \return the size, in bytes, of a single frame */
+      uint32_t getFrameSize() const;
+
+      /*! \return number of frames at the block
+       * \param block -> block index [0, blockCount) */
+      uint32_t getBlockFrames(uint32_t block) const;
+
+      /*! \return size in bytes of the block data (without padding)
+       * \param block -> block index [0, blockCount) */
+      uint32_t getBlockSize(uint32_t block) const;
+
+      /*! \return size in bytes of the block with its alignment padding
+       * \param block -> block index [0, blockCount) */
+      uint32_t getAlignedBlockSize(uint32_t block) const;
+
+      /*! Align an offset to the KOSND_ALIGNMENT boundary */
+      static uint64_t align(uint64_t offset);
+
+      /*! Read a little-endian integer from a buffer */
+      static uint16_t readU16(const unsigned char* data);
+      static uint32_t readU32(const unsigned char* data);
+      static uint64_t readU64(const unsigned char* data);
+
+      /*! Write a little-endian integer to a buffer */
+      static void writeU16(unsigned char* data, uint16_t value);
+      static void writeU32(unsigned char* data, uint32_t value);
+      static void writeU64(unsigned char* data, uint64_t value);
+
+      uint16_t version;          /**< Format version */
+      uint16_t channels;         /**< Number of channels (1 or 2) */
+      uint32_t sampleRate;       /**< Sample rate of the stored PCM */
+      uint32_t sourceRate;       /**< Sample rate of the original file */
+      uint32_t flags;            /**< KOSND_FLAG_* bits */
+      uint64_t totalFrames;      /**< Total frames stored */
+      uint32_t blockFrames;      /**< Frames per (full) block */
+      uint32_t blockCount;       /**< Number of blocks */
+      uint64_t seekTableOffset;  /**< Offset of the seek table */
+      uint64_t dataOffset;       /**< Offset of the first block */
+};
+
+}
+
+#endif
+
@@ -0,0 +1,386 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "kosndstream.h"
+#include "profiler.h"
+#include <kobold/log.h>
+#include <SDL2/SDL.h>
+
+#include <string.h>
+
+/* Memory mapping is only used where files are directly accessible by its
+ * path (on others, like Android assets, we must use the FileReader). */
+#if KOBOLD_PLATFORM == KOBOLD_PLATFORM_LINUX
+   #define KOSOUND_KOSND_MMAP 1
+   #include <sys/mman.h>
+   #include <sys/stat.h>
+   #include <fcntl.h>
+   #include <unistd.h>
+#else
+   #define KOSOUND_KOSND_MMAP 0
+#endif
+
+#define KOSOUND_KOSND_BUFFER_SIZE (4096 * 16) /**< Size of the read buffer */
+
+using namespace Kosound;
+
+/*************************************************************************
+ *                             KosndStream                               *
+ *************************************************************************/
+KosndStream::KosndStream(Kobold::FileReader* fileReader)
+            :SoundStream(SoundStream::TYPE_KOSND, KOSOUND_KOSND_BUFFER_SIZE)
+{
+   this->fileReader = fileReader;
+   seekTable = NULL;
+   mapped = NULL;
+   mappedSize = 0;
+   curBlock = 0;
+   blockPos = 0;
+}
+
+/*************************************************************************
+ *                            ~KosndStream                               *
+ *************************************************************************/
+KosndStream::~KosndStream()
+{
+   if(fileReader != NULL)
+   {
+      delete fileReader;
+   }
+}
+
+/*************************************************************************
+ *                                 _open                                 *
+ *************************************************************************/
+bool KosndStream::_open(const Kobold::String& fName, ALenum* f, ALuint* sr)
+{
+   bool fileOpened;
+
+   {
+      KOSOUND_PROFILE_ZONE("FileReader::open");
+      fileOpened = (mapFile(fName)) || (fileReader->open(fName));
+   }
+   if(!fileOpened)
+   {
+      Kobold::Log::add(Kobold::LOG_LEVEL_ERROR,
+         "KosndStream: Couldn't open file from resources: '%s'",
+         fName.c_str());
+      return false;
+   }
+
+   if(!readHeader())
+   {
+      Kobold::Log::add(Kobold::LOG_LEVEL_ERROR,
+         "KosndStream: Invalid or unsupported .kosnd file: '%s'",
+         fName.c_str());
+      _release();
+      return false;
+   }
+
+   /* Set format and sample rate */
+   if(header.channels == 1)
+   {
+      *f = AL_FORMAT_MONO16;
+   }
+   else
+   {
+      *f = AL_FORMAT_STEREO16;
+   }
+   *sr = header.sampleRate;
+
+   return _rewind();
+}
+
+/*************************************************************************
+ *                               mapFile                                 *
+ *************************************************************************/
+bool KosndStream::mapFile(const Kobold::String& fName)
+{
+#if KOSOUND_KOSND_MMAP == 1
+   struct stat st;
+   void* data;
+   int fd = ::open(fName.c_str(), O_RDONLY);
+
+   if(fd < 0)
+   {
+      return false;
+   }
+   if( (fstat(fd, &st) != 0) || (st.st_size < KOSND_HEADER_SIZE) )
+   {
+      ::close(fd);
+      return false;
+   }
+
+   data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   /* The mapping remains valid after closing its descriptor */
+   ::close(fd);
+
+   if(data == MAP_FAILED)
+   {
+      return false;
+   }
+   posix_madvise(data, st.st_size, POSIX_MADV_SEQUENTIAL);
+
+   mapped = static_cast<const char*>(data);
+   mappedSize = st.st_size;
+
+   return true;
+#else
+   return false;
+#endif
+}
+
+/*************************************************************************
+ *                              readHeader                               *
+ *************************************************************************/
+bool KosndStream::readHeader()
+{
+   unsigned char data[KOSND_HEADER_SIZE];
+   unsigned char entry[KOSND_SEEK_ENTRY_SIZE];
+   uint32_t i;
+
+   /* Header */
+   if(mapped)
+   {
+      memcpy(data, mapped, KOSND_HEADER_SIZE);
+   }
+   else if(fileReader->read((char*)data, KOSND_HEADER_SIZE) !=
+           KOSND_HEADER_SIZE)
+   {
+      return false;
+   }
+   if( (!header.parse(data)) || (header.blockCount == 0) )
+   {
+      return false;
+   }
+
+   /* Seek table */
+   if(mapped)
+   {
+      if(header.seekTableOffset + (uint64_t)header.blockCount *
+            KOSND_SEEK_ENTRY_SIZE > mappedSize)
+      {
+         return false;
+      }
+   }
+   else
+   {
+      fileReader->seek(header.seekTableOffset);
+   }
+
+   seekTable = new uint64_t[header.blockCount];
+   for(i = 0; i < header.blockCount; i++)
+   {
+      if(mapped)
+      {
+         memcpy(entry, mapped + header.seekTableOffset +
+               i * KOSND_SEEK_ENTRY_SIZE, KOSND_SEEK_ENTRY_SIZE);
+      }
+      else if(fileReader->read((char*)entry, KOSND_SEEK_ENTRY_SIZE) !=
+              KOSND_SEEK_ENTRY_SIZE)
+      {
+         return false;
+      }
+      seekTable[i] = KosndHeader::readU64(entry);
+
+      /* Blocks must be aligned and, when mapped, inside the file */
+      if( (seekTable[i] % KOSND_ALIGNMENT != 0) ||
+          ( (mapped) &&
+            (seekTable[i] + header.getBlockSize(i) > mappedSize) ) )
+      {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+/*************************************************************************
+ *                              _release                                 *
+ *************************************************************************/
+void KosndStream::_release()
+{
+   if(mapped)
+   {
+#if KOSOUND_KOSND_MMAP == 1
+      munmap(const_cast<char*>(mapped), mappedSize);
+#endif
+      mapped = NULL;
+      mappedSize = 0;
+   }
+   else
+   {
+      fileReader->close();
+   }
+
+   if(seekTable)
+   {
+      delete[] seekTable;
+      seekTable = NULL;
+   }
+}
+
+/*************************************************************************
+ *                               _rewind                                 *
+ *************************************************************************/
+bool KosndStream::_rewind()
+{
+   curBlock = 0;
+   blockPos = 0;
+
+   if(!mapped)
+   {
+      fileReader->seek(seekTable[0]);
+   }
+
+   return true;
+}
+
+/*************************************************************************
+ *                                _seek                                  *
+ *************************************************************************/
+bool KosndStream::_seek(int64_t frame)
+{
+   if( (frame < 0) || ((uint64_t)frame >= header.totalFrames) )
+   {
+      return false;
+   }
+
+   curBlock = (uint32_t)(frame / header.blockFrames);
+   blockPos = (uint32_t)(frame % header.blockFrames) * header.getFrameSize();
+
+   if(!mapped)
+   {
+      fileReader->seek(seekTable[curBlock] + blockPos);
+   }
+
+   return true;
+}
+
+/*************************************************************************
+ *                            _canMapBuffer                              *
+ *************************************************************************/
+bool KosndStream::_canMapBuffer()
+{
+   /* Data is little-endian, so on big-endian must swap on a copy. */
+   return (mapped != NULL) && (SDL_BYTEORDER == SDL_LIL_ENDIAN);
+}
+
+/*************************************************************************
+ *                              _mapBuffer                               *
+ *************************************************************************/
+bool KosndStream::_mapBuffer(unsigned long readBytes, const char** data,
+      unsigned long* bytesReaded, bool* gotEof)
+{
+   unsigned long blockSize;
+
+   *gotEof = false;
+   *bytesReaded = 0;
+
+   if(curBlock >= header.blockCount)
+   {
+      *gotEof = true;
+      return true;
+   }
+
+   /* Give the remaining of the current block (at most readBytes). */
+   blockSize = header.getBlockSize(curBlock);
+   *bytesReaded = blockSize - blockPos;
+   if(*bytesReaded > readBytes)
+   {
+      *bytesReaded = readBytes - (readBytes % header.getFrameSize());
+   }
+   *data = mapped + seekTable[curBlock] + blockPos;
+
+   blockPos += *bytesReaded;
+   if(blockPos >= blockSize)
+   {
+      curBlock++;
+      blockPos = 0;
+   }
+
+   return true;
+}
+
+/*************************************************************************
+ *                              _getBuffer                               *
+ *************************************************************************/
+bool KosndStream::_getBuffer(char* buffer, unsigned long readBytes,
+      unsigned long* bytesReaded, bool* gotEof)
+{
+   unsigned long blockSize;
+   unsigned long toRead;
+   unsigned long i;
+   char* dest = buffer;
+
+   *gotEof = false;
+   *bytesReaded = 0;
+
+   if(curBlock >= header.blockCount)
+   {
+      *gotEof = true;
+      return true;
+   }
+
+   /* Read at most till the end of the current block */
+   blockSize = header.getBlockSize(curBlock);
+   toRead = blockSize - blockPos;
+   if(toRead > readBytes)
+   {
+      toRead = readBytes - (readBytes % header.getFrameSize());
+   }
+
+   if(mapped)
+   {
+      memcpy(dest, mapped + seekTable[curBlock] + blockPos, toRead);
+   }
+   else if(fileReader->read(dest, toRead) != toRead)
+   {
+      logError(StreamLog::ERROR_READ, (int)curBlock);
+      return false;
+   }
+
+   if(SDL_BYTEORDER == SDL_BIG_ENDIAN)
+   {
+      /* Stored as little-endian: swap each sample */
+      for(i = 0; i + 1 < toRead; i += 2)
+      {
+         char tmp = dest[i];
+         dest[i] = dest[i + 1];
+         dest[i + 1] = tmp;
+      }
+   }
+
+   *bytesReaded = toRead;
+   blockPos += toRead;
+   if(blockPos >= blockSize)
+   {
+      /* Go to the next block (skipping the alignment padding) */
+      curBlock++;
+      blockPos = 0;
+      if( (!mapped) && (curBlock < header.blockCount) )
+      {
+         fileReader->seek(seekTable[curBlock]);
+      }
+   }
+
+   return true;
+}
+
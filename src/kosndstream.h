@@ -0,0 +1,113 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kosound_kosnd_stream_h
+#define _kosound_kosnd_stream_h
+
+#include "kosoundconfig.h"
+#include <kobold/platform.h>
+#include <kobold/kstring.h>
+#include <kobold/filereader.h>
+
+#if KOBOLD_PLATFORM == KOBOLD_PLATFORM_IOS || \
+    KOBOLD_PLATFORM == KOBOLD_PLATFORM_MACOS
+   #include <OpenAL/al.h>
+#else
+   #include <AL/al.h>
+#endif
+
+#include "soundstream.h"
+#include "kosndformat.h"
+
+namespace Kosound
+{
+
+/*! Stream of a pre-decoded .kosnd file (see KosndHeader and the
+ * kosound_convert tool). As its data is already PCM, there's no decode
+ * at all: when the file could be memory mapped, its blocks are given
+ * directly to alBufferData; otherwise they are just read through the
+ * FileReader. */
+class KosndStream : public SoundStream
+{
+   public:
+      /*! Constructor
+       * \param fileReader -> FileReader to use to open the file, when it
+       *                      can't be memory mapped. Its pointer will be
+       *                      deleted by KosndStream. */
+      KosndStream(Kobold::FileReader* fileReader);
+      /*! Destructor */
+      virtual ~KosndStream();
+
+   protected:
+      /*! Open the .kosnd file to use */
+      bool _open(const Kobold::String& fName, ALenum* f, ALuint* sr);
+
+      /*! Release the file (or its mapping) */
+      void _release();
+
+      /*! Rewind the stream
+       * \return true on success */
+      bool _rewind();
+
+      /*! Seek the stream to a frame, through the seek table
+       * \return true on success */
+      bool _seek(int64_t frame);
+
+      /*! Read data to a buffer
+       * \param buffer -> where to put the readed data
+       * \param readBytes -> total bytes to read (could read less)
+       * \param bytesReaded -> return total bytes really readed on this call
+       * \param gotEof -> return true if got EOF
+       * \return false if some error occurred */
+      bool _getBuffer(char* buffer, unsigned long readBytes,
+            unsigned long* bytesReaded, bool* gotEof);
+
+      /*! \return true if the file is memory mapped */
+      bool _canMapBuffer();
+
+      /*! Get pointer to the next mapped data. */
+      bool _mapBuffer(unsigned long readBytes, const char** data,
+            unsigned long* bytesReaded, bool* gotEof);
+
+   private:
+      /*! Try to memory map the file
+       * \return true if mapped */
+      bool mapFile(const Kobold::String& fName);
+
+      /*! Read and check the header and seek table from the mapped file or
+       * from the file reader.
+       * \return true if valid */
+      bool readHeader();
+
+      Kobold::FileReader* fileReader; /**< Reader when not mapped */
+      KosndHeader header;    /**< The file header */
+      uint64_t* seekTable;   /**< Offset of each block */
+
+      uint32_t curBlock;     /**< Current block */
+      uint32_t blockPos;     /**< Current position (bytes) in the block */
+
+      const char* mapped;    /**< Mapped file data or NULL */
+      unsigned long mappedSize; /**< Size of the mapped data */
+};
+
+}
+
+#endif
+
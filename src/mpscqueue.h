@@ -0,0 +1,144 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kosound_mpsc_queue_h
+#define _kosound_mpsc_queue_h
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Kosound
+{
+
+/*! A bounded lock-free multiple producers, single consumer queue.
+ * Any thread could push, never blocking (push fails when full). Only a
+ * single thread at a time could pop.
+ * \note It's a ring of preallocated cells, each with a sequence number
+ * telling if it's free to write or ready to read (D. Vyukov's bounded
+ * queue), so no allocation is done after its creation. */
+template <class T> class MpscQueue
+{
+   public:
+      /*! Constructor
+       * \param capacity -> max elements. Must be a power of two. */
+      MpscQueue(size_t capacity)
+      {
+         mask = capacity - 1;
+         cells = new Cell[capacity];
+         for(size_t i = 0; i < capacity; i++)
+         {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+         }
+         enqueuePos.store(0, std::memory_order_relaxed);
+         dequeuePos = 0;
+      };
+
+      /*! Destructor */
+      ~MpscQueue()
+      {
+         delete[] cells;
+      };
+
+      /*! Push an element to the queue. Could be called by any thread.
+       * \param value -> element to push (copied)
+       * \return false if the queue is full */
+      bool push(const T& value)
+      {
+         Cell* cell;
+         size_t pos = enqueuePos.load(std::memory_order_relaxed);
+
+         for(;;)
+         {
+            cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+            if(dif == 0)
+            {
+               /* Free cell: try to claim it */
+               if(enqueuePos.compare_exchange_weak(pos, pos + 1,
+                        std::memory_order_relaxed))
+               {
+                  break;
+               }
+            }
+            else if(dif < 0)
+            {
+               /* Full */
+               return false;
+            }
+            else
+            {
+               /* Other producer got it first */
+               pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+         }
+
+         cell->data = value;
+         cell->sequence.store(pos + 1, std::memory_order_release);
+         return true;
+      };
+
+      /*! Pop the oldest element from the queue.
+       * \note only a single thread at a time could call it.
+       * \param value -> receive the popped element
+       * \return false if the queue is empty */
+      bool pop(T& value)
+      {
+         Cell* cell = &cells[dequeuePos & mask];
+         size_t seq = cell->sequence.load(std::memory_order_acquire);
+
+         if((intptr_t)seq - (intptr_t)(dequeuePos + 1) < 0)
+         {
+            /* Empty (or the producer didn't finished its write yet) */
+            return false;
+         }
+
+         value = cell->data;
+         cell->sequence.store(dequeuePos + mask + 1,
+               std::memory_order_release);
+         dequeuePos++;
+         return true;
+      };
+
+   private:
+      /* No copies */
+      MpscQueue(const MpscQueue&);
+      MpscQueue& operator=(const MpscQueue&);
+
+      /*! A queue element */
+      struct Cell
+      {
+         std::atomic<size_t> sequence; /**< Write/read turn of the cell */
+         T data;                       /**< Its element */
+      };
+
+      Cell* cells;                     /**< The ring of cells */
+      size_t mask;                     /**< capacity - 1 */
+      char pad0[64];                   /**< Avoid false sharing */
+      std::atomic<size_t> enqueuePos;  /**< Next position to push */
+      char pad1[64];                   /**< Avoid false sharing */
+      size_t dequeuePos;               /**< Next position to pop */
+};
+
+}
+
+#endif
+
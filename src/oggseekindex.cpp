@@ -0,0 +1,277 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "oggseekindex.h"
+
+#define KOSOUND_OGG_INDEX_READ    (4096 * 4) /**< Bytes per scan read */
+#define KOSOUND_OGG_INDEX_SPACING  22050     /**< Min frames per entry */
+
+using namespace Kosound;
+
+/*************************************************************************
+ *                                 get                                   *
+ *************************************************************************/
+OggSeekIndex* OggSeekIndex::get(const Kobold::String& fileName,
+      BufferedReader* reader)
+{
+   std::unique_lock<std::mutex> lock(cacheMutex);
+   std::map<Kobold::String, OggSeekIndex*>::iterator it =
+      cache.find(fileName);
+   OggSeekIndex* index;
+
+   if(it != cache.end())
+   {
+      index = it->second;
+      index->references++;
+      index->lastUse = ++useCounter;
+
+      /* Wait if another stream is still building it */
+      while(index->building)
+      {
+         builtCond.wait(lock);
+      }
+      return index;
+   }
+
+   /* Publish it as being built (so referenced, and never evicted) */
+   index = new OggSeekIndex();
+   index->fileName = fileName;
+   index->references = 1;
+   index->lastUse = ++useCounter;
+   cache[fileName] = index;
+
+   /* Scan the file without the lock held */
+   lock.unlock();
+   index->build(reader);
+   lock.lock();
+
+   index->building = false;
+   builtCond.notify_all();
+
+   return index;
+}
+
+/*************************************************************************
+ *                               release                                 *
+ *************************************************************************/
+void OggSeekIndex::release(OggSeekIndex* index)
+{
+   std::lock_guard<std::mutex> lock(cacheMutex);
+
+   index->references--;
+   if(index->references > 0)
+   {
+      return;
+   }
+
+   if(!index->cached)
+   {
+      /* Already removed from the cache by clearCache() */
+      delete index;
+      return;
+   }
+
+   evict();
+}
+
+/*************************************************************************
+ *                                evict                                  *
+ *************************************************************************/
+void OggSeekIndex::evict()
+{
+   std::map<Kobold::String, OggSeekIndex*>::iterator it, oldest;
+   int unused;
+
+   for(;;)
+   {
+      unused = 0;
+      oldest = cache.end();
+      for(it = cache.begin(); it != cache.end(); ++it)
+      {
+         if(it->second->references == 0)
+         {
+            unused++;
+            if( (oldest == cache.end()) ||
+                (it->second->lastUse < oldest->second->lastUse) )
+            {
+               oldest = it;
+            }
+         }
+      }
+
+      if(unused <= KOSOUND_OGG_INDEX_CACHE_SIZE)
+      {
+         return;
+      }
+
+      delete oldest->second;
+      cache.erase(oldest);
+   }
+}
+
+/*************************************************************************
+ *                              clearCache                               *
+ *************************************************************************/
+void OggSeekIndex::clearCache()
+{
+   std::lock_guard<std::mutex> lock(cacheMutex);
+   std::map<Kobold::String, OggSeekIndex*>::iterator it;
+
+   for(it = cache.begin(); it != cache.end(); ++it)
+   {
+      if(it->second->references == 0)
+      {
+         delete it->second;
+      }
+      else
+      {
+         /* Still in use: deleted at its last release */
+         it->second->cached = false;
+      }
+   }
+   cache.clear();
+}
+
+/*************************************************************************
+ *                             Constructor                               *
+ *************************************************************************/
+OggSeekIndex::OggSeekIndex()
+{
+   usable = true;
+   references = 0;
+   lastUse = 0;
+   cached = true;
+   building = true;
+}
+
+/*************************************************************************
+ *                                 build                                 *
+ *************************************************************************/
+void OggSeekIndex::build(BufferedReader* reader)
+{
+   ogg_sync_state oy;
+   ogg_page og;
+   ogg_int64_t pageOffset = 0;
+   ogg_int64_t lastGranule = -1;
+   ogg_int64_t granule;
+   int64_t previous = reader->tell();
+   int serial = 0;
+   bool first = true;
+   long ret;
+
+   ogg_sync_init(&oy);
+   reader->seek(0);
+
+   for(;;)
+   {
+      ret = ogg_sync_pageseek(&oy, &og);
+      if(ret < 0)
+      {
+         /* Skipped some garbage bytes */
+         pageOffset -= ret;
+      }
+      else if(ret == 0)
+      {
+         /* Need more data */
+         char* buffer = ogg_sync_buffer(&oy, KOSOUND_OGG_INDEX_READ);
+         size_t readed = reader->read(buffer, KOSOUND_OGG_INDEX_READ);
+         if(readed == 0)
+         {
+            break;
+         }
+         ogg_sync_wrote(&oy, readed);
+      }
+      else
+      {
+         /* Got a page starting at pageOffset */
+         if(first)
+         {
+            serial = ogg_page_serialno(&og);
+            first = false;
+         }
+         else if(serial != ogg_page_serialno(&og))
+         {
+            /* Chained or multiplexed: granules aren't linear. */
+            usable = false;
+         }
+
+         /* Index a page only after audio is decoded (the headers have
+          * granule 0), and keep the index sparse. */
+         if( (lastGranule > 0) && ( (entries.empty()) ||
+             (lastGranule - entries.back().granule >=
+              KOSOUND_OGG_INDEX_SPACING) ) )
+         {
+            Entry entry;
+            entry.granule = lastGranule;
+            entry.offset = pageOffset;
+            entries.push_back(entry);
+         }
+
+         granule = ogg_page_granulepos(&og);
+         if(granule >= 0)
+         {
+            lastGranule = granule;
+         }
+         pageOffset += ret;
+      }
+   }
+
+   ogg_sync_clear(&oy);
+   reader->seek(previous);
+}
+
+/*************************************************************************
+ *                                 find                                  *
+ *************************************************************************/
+bool OggSeekIndex::find(ogg_int64_t pcm, ogg_int64_t* offset) const
+{
+   size_t first = 0, last = entries.size();
+
+   if( (!usable) || (entries.empty()) || (entries[0].granule > pcm) )
+   {
+      return false;
+   }
+
+   /* Binary search the last entry with granule <= pcm */
+   while(last - first > 1)
+   {
+      size_t mid = (first + last) / 2;
+      if(entries[mid].granule <= pcm)
+      {
+         first = mid;
+      }
+      else
+      {
+         last = mid;
+      }
+   }
+
+   *offset = entries[first].offset;
+   return true;
+}
+
+/*************************************************************************
+ *                            static members                             *
+ *************************************************************************/
+std::map<Kobold::String, OggSeekIndex*> OggSeekIndex::cache;
+std::mutex OggSeekIndex::cacheMutex;
+std::condition_variable OggSeekIndex::builtCond;
+unsigned long OggSeekIndex::useCounter = 0;
+
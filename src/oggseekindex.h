@@ -0,0 +1,120 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kosound_ogg_seek_index_h
+#define _kosound_ogg_seek_index_h
+
+#include "kosoundconfig.h"
+#include <kobold/kstring.h>
+
+#include <ogg/ogg.h>
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "bufferedreader.h"
+
+namespace Kosound
+{
+
+/*! Max number of indexes kept cached while no stream uses them */
+#define KOSOUND_OGG_INDEX_CACHE_SIZE  16
+
+/*! A granule position to byte offset index of an Ogg file, built by a
+ * single scan of its pages on the first seek of the file and cached by
+ * file name, so seeking on an already known file jumps directly near the
+ * target page instead of doing libvorbisfile's bisection search (with its
+ * many reads). Indexes are reference counted by the streams using them;
+ * only the KOSOUND_OGG_INDEX_CACHE_SIZE most recently used of the unused
+ * ones are kept. */
+class OggSeekIndex
+{
+   public:
+      /*! Get the index of a file, building it if not yet cached. The
+       * build is done without locking the cache (other streams of the
+       * same file wait it; of other files, don't). Each get must be
+       * paired with a release().
+       * \param fileName -> file name (the cache key)
+       * \param reader -> opened reader of the file. Used only to build
+       *        the index, and will be at its previous position on return.
+       * \return the index. Never NULL (but could be not usable). */
+      static OggSeekIndex* get(const Kobold::String& fileName,
+            BufferedReader* reader);
+
+      /*! Release an index got by get(). When no more used, it's kept at
+       * the cache for next streams of the file, evicting the least
+       * recently used ones if over KOSOUND_OGG_INDEX_CACHE_SIZE.
+       * \param index -> index to release */
+      static void release(OggSeekIndex* index);
+
+      /*! Delete all cached indexes (the ones still in use are deleted
+       * only at their release). */
+      static void clearCache();
+
+      /*! \return if the index could be used for seeks (it's not usable
+       * for chained streams, where granules are per link). */
+      bool isUsable() const { return usable; };
+
+      /*! Find where to start decoding to reach a pcm position.
+       * \param pcm -> target pcm position (frame)
+       * \param offset -> return byte offset of the page to raw seek to
+       * \return true if found, false if must use a bisection search */
+      bool find(ogg_int64_t pcm, ogg_int64_t* offset) const;
+
+   private:
+      /*! Constructor of an empty index, still to be built */
+      OggSeekIndex();
+
+      /*! Build the index, scanning the file pages
+       * \param reader -> reader to scan */
+      void build(BufferedReader* reader);
+
+      /*! Delete least recently used unreferenced indexes, till at most
+       * KOSOUND_OGG_INDEX_CACHE_SIZE of them remain. Called with
+       * cacheMutex locked. */
+      static void evict();
+
+      /*! An index entry */
+      struct Entry
+      {
+         ogg_int64_t granule; /**< Granule of the previous pages end */
+         ogg_int64_t offset;  /**< Byte offset of the page */
+      };
+
+      std::vector<Entry> entries;  /**< Sorted entries */
+      bool usable;                 /**< If the index could be used */
+      Kobold::String fileName;     /**< Its cache key */
+      int references;              /**< Streams using it */
+      unsigned long lastUse;       /**< When last got (from useCounter) */
+      bool cached;                 /**< If still at the cache */
+      bool building;               /**< If still being built */
+
+      static std::map<Kobold::String, OggSeekIndex*> cache; /**< Indexes */
+      static std::mutex cacheMutex;   /**< Protect the cache */
+      static std::condition_variable builtCond; /**< Signal built ones */
+      static unsigned long useCounter; /**< Incremented at each get */
+};
+
+}
+
+#endif
+
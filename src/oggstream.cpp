@@ -19,6 +19,7 @@
  */
 
 #include "oggstream.h"
+#include "profiler.h"
 #include <kobold/log.h>
 #include <SDL2/SDL.h>
 
@@ -33,14 +34,8 @@ namespace Kosound
 static size_t kosound_stream_read_func(void* ptr, size_t size, size_t nmemb, 
       void* datasource)
 {
-   Kobold::FileReader* fileReader = 
-      static_cast<Kobold::FileReader*>(datasource);
-   if(!fileReader->eof())
-   {
-      return fileReader->read(static_cast<char*>(ptr), size * nmemb);
-   }
-
-   return 0;
+   BufferedReader* reader = static_cast<BufferedReader*>(datasource);
+   return reader->read(static_cast<char*>(ptr), size * nmemb);
 }
 
 /*************************************************************************
@@ -49,35 +44,28 @@ static size_t kosound_stream_read_func(void* ptr, size_t size, size_t nmemb,
 static int kosound_stream_seek_func(void* datasource, ogg_int64_t offset, 
       int whence)
 {
-   Kobold::FileReader* fileReader = 
-      static_cast<Kobold::FileReader*>(datasource);
+   BufferedReader* reader = static_cast<BufferedReader*>(datasource);
+   ogg_int64_t pos;
    
-   if(whence == SEEK_SET)
+   switch(whence)
    {
-      /* We are seeking from the start position */
-      fileReader->seek(offset);
-      return 0;
+      case SEEK_SET:
+         /* We are seeking from the start position */
+         pos = offset;
+      break;
+      case SEEK_CUR:
+         pos = reader->tell() + offset;
+      break;
+      case SEEK_END:
+         /* Only here the length is needed (probed if not yet known) */
+         pos = reader->getLength() + offset;
+      break;
+      default:
+         return -1;
    }
-   else if((whence == SEEK_CUR) && (offset == 0))
-   {
-      /* Should be a rewind. */
-      fileReader->seek(offset);
-      return 0;
-   }
-   
-   return -1;
-}
-
-/*************************************************************************
- *                       kosound_stream_close_func                          *
- *************************************************************************/
-static int kosound_stream_close_func(void* datasource)
-{
-   Kobold::FileReader* fileReader = 
-      static_cast<Kobold::FileReader*>(datasource);
-   fileReader->close();
 
-   return 0;
+   /* Only I/O if out of the read-ahead window */
+   return (reader->seek(pos)) ? 0 : -1;
 }
 
 /*************************************************************************
@@ -85,18 +73,27 @@ static int kosound_stream_close_func(void* datasource)
  *************************************************************************/
 static long int kosound_stream_tell_func(void* datasource)
 {
-   Kobold::FileReader* fileReader = 
-      static_cast<Kobold::FileReader*>(datasource);
-   return fileReader->tell();
+   return (long int) static_cast<BufferedReader*>(datasource)->tell();
 }
 
 /*************************************************************************
  *                         kosound_stream_callbacks                         *
  *************************************************************************/
+/* No close function: ov_clear() must not close the file, as a stream
+ * could be reopened seekable (see OggStream::makeSeekable). */
 static ov_callbacks KOSOUND_STREAM_CALLBACK = {
    kosound_stream_read_func,
    kosound_stream_seek_func,
-   kosound_stream_close_func,
+   NULL,
+   kosound_stream_tell_func
+};
+
+/* Without a seek function, vorbisfile opens the stream as unseekable,
+ * so it neither seeks to its end nor needs its length. */
+static ov_callbacks KOSOUND_STREAM_UNSEEKABLE_CALLBACK = {
+   kosound_stream_read_func,
+   NULL,
+   NULL,
    kosound_stream_tell_func
 };
 
@@ -107,6 +104,9 @@ OggStream::OggStream(Kobold::FileReader* fileReader)
           :SoundStream(SoundStream::TYPE_OGG, KOSOUND_OGG_BUFFER_SIZE)
 {
    this->fileReader = fileReader;
+   this->seekIndex = NULL;
+   this->seekable = false;
+   this->reader = new BufferedReader(fileReader);
 }
 
 /*************************************************************************
@@ -114,6 +114,11 @@ OggStream::OggStream(Kobold::FileReader* fileReader)
  *************************************************************************/
 OggStream::~OggStream()
 {
+   if(seekIndex != NULL)
+   {
+      OggSeekIndex::release(seekIndex);
+   }
+   delete reader;
    if(this->fileReader != NULL)
    {
       delete fileReader;
@@ -125,9 +130,14 @@ OggStream::~OggStream()
  *************************************************************************/
 bool OggStream::_open(const Kobold::String& path, ALenum* f, ALuint* sr)
 {
+   bool fileOpened;
    int result;
 
-   if(!fileReader->open(path))
+   {
+      KOSOUND_PROFILE_ZONE("FileReader::open");
+      fileOpened = fileReader->open(path);
+   }
+   if(!fileOpened)
    {
       Kobold::Log::add(Kobold::LOG_LEVEL_ERROR,
          "OggStream: Couldn't open ogg file from resources: '%s'", 
@@ -135,12 +145,21 @@ bool OggStream::_open(const Kobold::String& path, ALenum* f, ALuint* sr)
       return false;
    }
 
-   result = ov_open_callbacks((void*)fileReader, &oggStr, NULL, 0, 
-         KOSOUND_STREAM_CALLBACK);
+   /* Reset the read-ahead and open it unseekable: a stream never rewound
+    * nor seeked (as most one-shots) doesn't need the file length, nor
+    * its probe I/O. It's reopened seekable at the first need. */
+   reader->reset();
+   seekable = false;
+
+   {
+      KOSOUND_PROFILE_ZONE("ov_open_callbacks");
+      result = ov_open_callbacks((void*)reader, &oggStr, NULL, 0, 
+            KOSOUND_STREAM_UNSEEKABLE_CALLBACK);
+   }
 
    if(result < 0)
    {
-      fileReader->close();
+      reader->close();
       Kobold::Log::add(Kobold::LOG_LEVEL_ERROR,
             "OggStream::_open(): failed to open stream '%s': %s",
             path.c_str(), errorString(result).c_str());
@@ -171,8 +190,16 @@ bool OggStream::_open(const Kobold::String& path, ALenum* f, ALuint* sr)
  *************************************************************************/
 void OggStream::_release()
 {
-   /* Clear the ogg stream */
+   /* Clear the ogg stream, and close its file */
    ov_clear(&oggStr);
+   reader->close();
+
+   /* And release its seek index, if got */
+   if(seekIndex != NULL)
+   {
+      OggSeekIndex::release(seekIndex);
+      seekIndex = NULL;
+   }
 }
 
 /*************************************************************************
@@ -181,49 +208,148 @@ void OggStream::_release()
 bool OggStream::_rewind()
 {
    /* Rewind the file */
-   if(ov_raw_seek(&oggStr,0) != 0)
+   if( (!makeSeekable()) || (ov_raw_seek(&oggStr,0) != 0) )
+   {
+      logError(StreamLog::ERROR_REWIND);
+      return false;
+   }
+
+   return true;
+}
+
+
+/*************************************************************************
+ *                                 _seek                                 *
+ *************************************************************************/
+bool OggStream::_seek(int64_t frame)
+{
+   ogg_int64_t offset;
+   ogg_int64_t pos;
+
+   if(seekIndex == NULL)
+   {
+      /* First seek: get the file index, building it if not cached */
+      KOSOUND_PROFILE_ZONE("OggSeekIndex::get");
+      seekIndex = OggSeekIndex::get(fileName, reader);
+   }
+
+   /* After the index, as its scan already got the file length */
+   if(!makeSeekable())
+   {
+      return false;
+   }
+
+   /* Jump to the indexed page before the frame, then decode till it */
+   if( (seekIndex->find(frame, &offset)) &&
+       (ov_raw_seek(&oggStr, offset) == 0) )
+   {
+      pos = ov_pcm_tell(&oggStr);
+      if( (pos >= 0) && (pos <= frame) )
+      {
+         return skip(frame - pos);
+      }
+   }
+
+   /* Not indexed: let vorbisfile search for it */
+   return ov_pcm_seek(&oggStr, frame) == 0;
+}
+
+/*************************************************************************
+ *                             makeSeekable                              *
+ *************************************************************************/
+bool OggStream::makeSeekable()
+{
+   int result;
+
+   if(seekable)
    {
-      Kobold::Log::add(Kobold::String("OggStream::stream(): ")+
-            Kobold::String("Ogg Rewind Error!"));
+      return true;
+   }
+
+   /* vorbisfile can't switch an opened stream to seekable, so reopen
+    * it (its headers are probably still at the read-ahead window). */
+   ov_clear(&oggStr);
+   reader->seek(0);
+   {
+      KOSOUND_PROFILE_ZONE("ov_open_callbacks");
+      result = ov_open_callbacks((void*)reader, &oggStr, NULL, 0, 
+            KOSOUND_STREAM_CALLBACK);
+   }
+   if(result < 0)
+   {
+      logError(StreamLog::ERROR_DECODE, result);
       return false;
    }
 
+   vorbisInfo = ov_info(&oggStr, -1);
+   vorbisComment = ov_comment(&oggStr, -1);
+   seekable = true;
+
    return true;
 }
 
+/*************************************************************************
+ *                                 skip                                  *
+ *************************************************************************/
+bool OggStream::skip(ogg_int64_t frames)
+{
+   ogg_int64_t bytes = frames * 2 * vorbisInfo->channels;
+   int section;
+   long result;
+
+   while(bytes > 0)
+   {
+      result = decode(callerScratch, 
+            (bytes < (ogg_int64_t)bufferSize) ? bytes : bufferSize, &section);
+      if(result <= 0)
+      {
+         return false;
+      }
+      bytes -= result;
+   }
+
+   return true;
+}
+
+/*************************************************************************
+ *                                decode                                 *
+ *************************************************************************/
+long OggStream::decode(char* data, int bytes, int* section)
+{
+#if KOBOLD_PLATFORM != KOBOLD_PLATFORM_IOS && \
+    KOBOLD_PLATFORM != KOBOLD_PLATFORM_ANDROID
+   return ov_read(&oggStr, data, bytes, SDL_BYTEORDER == SDL_BIG_ENDIAN, 2, 1,
+         section); 
+#else
+   return ov_read(&oggStr, data, bytes, section);
+#endif
+}
 
 /*************************************************************************
  *                                stream                                 *
  *************************************************************************/
-bool OggStream::_getBuffer(unsigned long index, unsigned long readBytes, 
+bool OggStream::_getBuffer(char* buffer, unsigned long readBytes, 
       unsigned long* bytesReaded, bool* gotEof)
 {
    int  section;
-   int  result = -1;
+   long result = -1;
 
    *gotEof = false;
    *bytesReaded = 0;
    
    /* Try to read from ogg file */
-#if KOBOLD_PLATFORM != KOBOLD_PLATFORM_IOS && \
-    KOBOLD_PLATFORM != KOBOLD_PLATFORM_ANDROID
-   result = ov_read(&oggStr, bufferData+index, readBytes,
-         SDL_BYTEORDER == SDL_BIG_ENDIAN, 2, 1, &section); 
-#else
-   result = ov_read(&oggStr, (static_cast<char*>(&bufferData[index]), 
-            readBytes, &section);
-#endif
+   result = decode(buffer, readBytes, &section);
    if(result < 0)
    {
       /* Error */
-      Kobold::Log::add(Kobold::String("Ogg Buffer Error: ") +
-            errorString(result));
+      logError(StreamLog::ERROR_DECODE, (int)result);
       return false;
    }
    else if(result == 0)
    {
-      /* Got EOF */
+      /* Got EOF: the read-ahead is no more needed till a rewind or seek */
       *gotEof = true;
+      reader->releaseChunks();
    }
 
    *bytesReaded = result;
@@ -46,6 +46,8 @@
 #endif
 
 #include "soundstream.h"
+#include "oggseekindex.h"
+#include "bufferedreader.h"
 
 namespace Kosound
 {
@@ -73,13 +75,17 @@ class OggStream : public SoundStream
        * \return true on success */
       bool _rewind();
 
-      /*! Read data to the internal buffer
-       * \param index -> first position on the buffer to fill
+      /*! Seek the stream to a frame, with help of the seek index.
+       * \return true on success */
+      bool _seek(int64_t frame);
+
+      /*! Read data to a buffer
+       * \param buffer -> where to put the readed data
        * \param readBytes -> total bytes to read (could read less)
        * \param bytesReaded -> return total bytes really readed on this call
        * \param gotEof -> return true if got EOF
        * \return false if some error occurred */
-      bool _getBuffer(unsigned long index, unsigned long readBytes, 
+      bool _getBuffer(char* buffer, unsigned long readBytes, 
             unsigned long* bytesReaded, bool* gotEof);
 
       /*! Error code from ogg
@@ -88,7 +94,26 @@ class OggStream : public SoundStream
       Kobold::String errorString(int code); 
       
    private:
+      /*! Decode data from the ogg stream (at most a single packet)
+       * \param data -> where to decode to
+       * \param bytes -> max bytes to decode
+       * \param section -> return current logical bitstream
+       * \return bytes decoded, 0 on EOF or < 0 on error */
+      long decode(char* data, int bytes, int* section);
+
+      /*! Decode and discard some frames
+       * \return false on error or EOF */
+      bool skip(ogg_int64_t frames);
+
+      /*! Reopen the stream seekable, if opened unseekable (see _open),
+       * finding the file length. The stream ends at its start.
+       * \return false on error */
+      bool makeSeekable();
+
       Kobold::FileReader* fileReader;
+      BufferedReader* reader;        /**< Read-ahead for vorbisfile */
+      OggSeekIndex* seekIndex;       /**< Seek index (got at first seek) */
+      bool seekable;                 /**< If opened seekable */
       OggVorbis_File oggStr;         /**< stream handle */
       vorbis_info* vorbisInfo;       /**< some formatting data */
       vorbis_comment* vorbisComment; /**< user comments */
@@ -0,0 +1,319 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "openalext.h"
+#include <kobold/log.h>
+
+using namespace Kosound;
+
+/*************************************************************************
+ *                                 load                                  *
+ *************************************************************************/
+void OpenALExt::load(ALCdevice* device)
+{
+   unload();
+
+#ifdef AL_SOFT_events
+   if(alIsExtensionPresent("AL_SOFT_events"))
+   {
+      alEventControl = (LPALEVENTCONTROLSOFT)
+         alGetProcAddress("alEventControlSOFT");
+      alEventCallback = (LPALEVENTCALLBACKSOFT)
+         alGetProcAddress("alEventCallbackSOFT");
+   }
+#endif
+
+#ifdef ALC_SOFT_reopen_device
+   if(alcIsExtensionPresent(device, "ALC_SOFT_reopen_device"))
+   {
+      alcReopenDevice = (LPALCREOPENDEVICESOFT)
+         alcGetProcAddress(device, "alcReopenDeviceSOFT");
+   }
+#endif
+
+#ifdef ALC_SOFT_device_clock
+   if(alcIsExtensionPresent(device, "ALC_SOFT_device_clock"))
+   {
+      alcGetInteger64v = (LPALCGETINTEGER64VSOFT)
+         alcGetProcAddress(device, "alcGetInteger64vSOFT");
+   }
+#endif
+
+#ifdef AL_SOFT_source_start_delay
+   if(alIsExtensionPresent("AL_SOFT_source_start_delay"))
+   {
+      alSourcePlayAtTime = (LPALSOURCEPLAYATTIMESOFT)
+         alGetProcAddress("alSourcePlayAtTimeSOFT");
+   }
+#endif
+
+#ifdef ALC_SOFT_pause_device
+   if(alcIsExtensionPresent(device, "ALC_SOFT_pause_device"))
+   {
+      alcDevicePause = (LPALCDEVICEPAUSESOFT)
+         alcGetProcAddress(device, "alcDevicePauseSOFT");
+      alcDeviceResume = (LPALCDEVICERESUMESOFT)
+         alcGetProcAddress(device, "alcDeviceResumeSOFT");
+   }
+#endif
+
+#ifdef AL_SOFT_deferred_updates
+   if(alIsExtensionPresent("AL_SOFT_deferred_updates"))
+   {
+      alDeferUpdates = (LPALDEFERUPDATESSOFT)
+         alGetProcAddress("alDeferUpdatesSOFT");
+      alProcessUpdates = (LPALPROCESSUPDATESSOFT)
+         alGetProcAddress("alProcessUpdatesSOFT");
+   }
+#endif
+
+#ifdef ALC_EXT_disconnect
+   disconnect = (alcIsExtensionPresent(device, "ALC_EXT_disconnect") == 
+                 ALC_TRUE);
+#endif
+
+#ifdef AL_EXT_MULAW
+   mulaw = (alIsExtensionPresent("AL_EXT_MULAW") == AL_TRUE);
+#endif
+
+#ifdef AL_EXT_IMA4
+   ima4 = (alIsExtensionPresent("AL_EXT_IMA4") == AL_TRUE);
+#endif
+
+   if(hasEvents())
+   {
+      Kobold::Log::add(Kobold::LOG_LEVEL_NORMAL,
+            "OpenALExt: AL_SOFT_events available");
+   }
+   if(hasReopen())
+   {
+      Kobold::Log::add(Kobold::LOG_LEVEL_NORMAL,
+            "OpenALExt: ALC_SOFT_reopen_device available");
+   }
+}
+
+/*************************************************************************
+ *                                unload                                 *
+ *************************************************************************/
+void OpenALExt::unload()
+{
+#ifdef AL_SOFT_events
+   alEventControl = NULL;
+   alEventCallback = NULL;
+#endif
+#ifdef ALC_SOFT_reopen_device
+   alcReopenDevice = NULL;
+#endif
+#ifdef ALC_SOFT_device_clock
+   alcGetInteger64v = NULL;
+#endif
+#ifdef AL_SOFT_source_start_delay
+   alSourcePlayAtTime = NULL;
+#endif
+#ifdef ALC_SOFT_pause_device
+   alcDevicePause = NULL;
+   alcDeviceResume = NULL;
+#endif
+#ifdef AL_SOFT_deferred_updates
+   alDeferUpdates = NULL;
+   alProcessUpdates = NULL;
+#endif
+   disconnect = false;
+   mulaw = false;
+   ima4 = false;
+}
+
+/*************************************************************************
+ *                               hasEvents                               *
+ *************************************************************************/
+bool OpenALExt::hasEvents()
+{
+#ifdef AL_SOFT_events
+   return (alEventControl != NULL) && (alEventCallback != NULL);
+#else
+   return false;
+#endif
+}
+
+/*************************************************************************
+ *                               hasReopen                               *
+ *************************************************************************/
+bool OpenALExt::hasReopen()
+{
+#ifdef ALC_SOFT_reopen_device
+   return alcReopenDevice != NULL;
+#else
+   return false;
+#endif
+}
+
+/*************************************************************************
+ *                             hasDisconnect                             *
+ *************************************************************************/
+bool OpenALExt::hasDisconnect()
+{
+   return disconnect;
+}
+
+/*************************************************************************
+ *                               hasMulaw                                *
+ *************************************************************************/
+bool OpenALExt::hasMulaw()
+{
+   return mulaw;
+}
+
+/*************************************************************************
+ *                                hasIma4                                *
+ *************************************************************************/
+bool OpenALExt::hasIma4()
+{
+   return ima4;
+}
+
+/*************************************************************************
+ *                            hasDeviceClock                             *
+ *************************************************************************/
+bool OpenALExt::hasDeviceClock()
+{
+#ifdef ALC_SOFT_device_clock
+   return alcGetInteger64v != NULL;
+#else
+   return false;
+#endif
+}
+
+/*************************************************************************
+ *                            hasStartAtTime                             *
+ *************************************************************************/
+bool OpenALExt::hasStartAtTime()
+{
+#ifdef AL_SOFT_source_start_delay
+   /* The start time is at the device clock */
+   return (alSourcePlayAtTime != NULL) && (hasDeviceClock());
+#else
+   return false;
+#endif
+}
+
+/*************************************************************************
+ *                            hasDevicePause                             *
+ *************************************************************************/
+bool OpenALExt::hasDevicePause()
+{
+#ifdef ALC_SOFT_pause_device
+   return (alcDevicePause != NULL) && (alcDeviceResume != NULL);
+#else
+   return false;
+#endif
+}
+
+/*************************************************************************
+ *                              pauseDevice                              *
+ *************************************************************************/
+void OpenALExt::pauseDevice(ALCdevice* device)
+{
+#ifdef ALC_SOFT_pause_device
+   if( (device != NULL) && (hasDevicePause()) )
+   {
+      alcDevicePause(device);
+   }
+#endif
+}
+
+/*************************************************************************
+ *                             resumeDevice                              *
+ *************************************************************************/
+void OpenALExt::resumeDevice(ALCdevice* device)
+{
+#ifdef ALC_SOFT_pause_device
+   if( (device != NULL) && (hasDevicePause()) )
+   {
+      alcDeviceResume(device);
+   }
+#endif
+}
+
+/*************************************************************************
+ *                          hasDeferredUpdates                           *
+ *************************************************************************/
+bool OpenALExt::hasDeferredUpdates()
+{
+#ifdef AL_SOFT_deferred_updates
+   return (alDeferUpdates != NULL) && (alProcessUpdates != NULL);
+#else
+   return false;
+#endif
+}
+
+/*************************************************************************
+ *                             deferUpdates                              *
+ *************************************************************************/
+void OpenALExt::deferUpdates()
+{
+#ifdef AL_SOFT_deferred_updates
+   if(hasDeferredUpdates())
+   {
+      alDeferUpdates();
+   }
+#endif
+}
+
+/*************************************************************************
+ *                            processUpdates                             *
+ *************************************************************************/
+void OpenALExt::processUpdates()
+{
+#ifdef AL_SOFT_deferred_updates
+   if(hasDeferredUpdates())
+   {
+      alProcessUpdates();
+   }
+#endif
+}
+
+/*************************************************************************
+ *                            static members                             *
+ *************************************************************************/
+#ifdef AL_SOFT_events
+LPALEVENTCONTROLSOFT OpenALExt::alEventControl = NULL;
+LPALEVENTCALLBACKSOFT OpenALExt::alEventCallback = NULL;
+#endif
+#ifdef ALC_SOFT_reopen_device
+LPALCREOPENDEVICESOFT OpenALExt::alcReopenDevice = NULL;
+#endif
+#ifdef ALC_SOFT_device_clock
+LPALCGETINTEGER64VSOFT OpenALExt::alcGetInteger64v = NULL;
+#endif
+#ifdef AL_SOFT_source_start_delay
+LPALSOURCEPLAYATTIMESOFT OpenALExt::alSourcePlayAtTime = NULL;
+#endif
+#ifdef ALC_SOFT_pause_device
+LPALCDEVICEPAUSESOFT OpenALExt::alcDevicePause = NULL;
+LPALCDEVICERESUMESOFT OpenALExt::alcDeviceResume = NULL;
+#endif
+#ifdef AL_SOFT_deferred_updates
+LPALDEFERUPDATESSOFT OpenALExt::alDeferUpdates = NULL;
+LPALPROCESSUPDATESSOFT OpenALExt::alProcessUpdates = NULL;
+#endif
+bool OpenALExt::disconnect = false;
+bool OpenALExt::mulaw = false;
+bool OpenALExt::ima4 = false;
+
@@ -0,0 +1,133 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kosound_openal_ext_h
+#define _kosound_openal_ext_h
+
+#include "kosoundconfig.h"
+#include <kobold/platform.h>
+
+#if KOBOLD_PLATFORM == KOBOLD_PLATFORM_IOS || \
+    KOBOLD_PLATFORM == KOBOLD_PLATFORM_MACOS
+   /* Apple's OpenAL has no OpenAL Soft extensions */
+   #include <OpenAL/al.h>
+   #include <OpenAL/alc.h>
+#else
+   #include <AL/al.h>
+   #include <AL/alc.h>
+   #include <AL/alext.h>
+#endif
+
+namespace Kosound
+{
+
+/*! The OpenAL (mostly OpenAL Soft) extensions used by kosound, when
+ * available at the current implementation. Each function pointer is
+ * NULL when its extension isn't present (or not even known by the
+ * alext.h kosound was built with). */
+class OpenALExt
+{
+   public:
+      /*! Load the extension functions of a device (and of its current
+       * context). Must be called after the context is made current. */
+      static void load(ALCdevice* device);
+
+      /*! Forget all loaded functions (as when the device is closed) */
+      static void unload();
+
+      /*! \return if AL_SOFT_events is available */
+      static bool hasEvents();
+
+      /*! \return if ALC_SOFT_reopen_device is available */
+      static bool hasReopen();
+
+      /*! \return if ALC_EXT_disconnect is available (ALC_CONNECTED) */
+      static bool hasDisconnect();
+
+      /*! \return if AL_EXT_MULAW buffers (AL_FORMAT_*_MULAW) are 
+       * supported */
+      static bool hasMulaw();
+
+      /*! \return if AL_EXT_IMA4 buffers (AL_FORMAT_*_IMA4) are supported */
+      static bool hasIma4();
+
+      /*! \return if ALC_SOFT_device_clock is available */
+      static bool hasDeviceClock();
+
+      /*! \return if sources could start at a device clock time 
+       * (AL_SOFT_source_start_delay, with ALC_SOFT_device_clock) */
+      static bool hasStartAtTime();
+
+      /*! \return if ALC_SOFT_pause_device is available */
+      static bool hasDevicePause();
+
+      /*! Pause the mixing (and output) of a device, if supported */
+      static void pauseDevice(ALCdevice* device);
+
+      /*! Resume the mixing of a device paused by pauseDevice */
+      static void resumeDevice(ALCdevice* device);
+
+      /*! \return if AL_SOFT_deferred_updates is available */
+      static bool hasDeferredUpdates();
+
+      /*! Start deferring source and listener changes, to be applied
+       * together by processUpdates (no-op without the extension). */
+      static void deferUpdates();
+
+      /*! Apply, at once, all changes deferred since deferUpdates */
+      static void processUpdates();
+
+#ifdef AL_SOFT_events
+      static LPALEVENTCONTROLSOFT alEventControl;   /**< AL_SOFT_events */
+      static LPALEVENTCALLBACKSOFT alEventCallback; /**< AL_SOFT_events */
+#endif
+#ifdef ALC_SOFT_reopen_device
+      /*! ALC_SOFT_reopen_device */
+      static LPALCREOPENDEVICESOFT alcReopenDevice;
+#endif
+#ifdef ALC_SOFT_device_clock
+      /*! ALC_SOFT_device_clock */
+      static LPALCGETINTEGER64VSOFT alcGetInteger64v;
+#endif
+#ifdef AL_SOFT_source_start_delay
+      /*! AL_SOFT_source_start_delay */
+      static LPALSOURCEPLAYATTIMESOFT alSourcePlayAtTime;
+#endif
+#ifdef ALC_SOFT_pause_device
+      /*! ALC_SOFT_pause_device */
+      static LPALCDEVICEPAUSESOFT alcDevicePause;
+      static LPALCDEVICERESUMESOFT alcDeviceResume;
+#endif
+#ifdef AL_SOFT_deferred_updates
+      /*! AL_SOFT_deferred_updates */
+      static LPALDEFERUPDATESSOFT alDeferUpdates;
+      static LPALPROCESSUPDATESSOFT alProcessUpdates;
+#endif
+
+   private:
+      static bool disconnect; /**< If ALC_EXT_disconnect is present */
+      static bool mulaw; /**< If AL_EXT_MULAW is present */
+      static bool ima4; /**< If AL_EXT_IMA4 is present */
+};
+
+}
+
+#endif
+
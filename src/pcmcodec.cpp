@@ -0,0 +1,185 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pcmcodec.h"
+
+using namespace Kosound;
+
+#define KOSOUND_MULAW_BIAS  0x84
+#define KOSOUND_MULAW_CLIP  32635
+
+/* IMA ADPCM step sizes and their index changes */
+static const int kosound_ima_steps[89] =
+{
+   7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 
+   41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 
+   190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 
+   724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 
+   2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484,
+   7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 
+   18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+static const int kosound_ima_index[16] =
+{
+   -1, -1, -1, -1, 2, 4, 6, 8,
+   -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+/*************************************************************************
+ *                              encodeMulaw                              *
+ *************************************************************************/
+void PcmCodec::encodeMulaw(const int16_t* pcm, size_t samples,
+      std::vector<char>& out)
+{
+   int sample, sign, exponent, mantissa;
+   size_t i;
+
+   out.resize(samples);
+   for(i = 0; i < samples; i++)
+   {
+      sample = pcm[i];
+      sign = (sample < 0) ? 0x80 : 0x00;
+      if(sign)
+      {
+         sample = -sample;
+      }
+      if(sample > KOSOUND_MULAW_CLIP)
+      {
+         sample = KOSOUND_MULAW_CLIP;
+      }
+      sample += KOSOUND_MULAW_BIAS;
+
+      /* Segment: position of the highest set bit, from bit 7 */
+      for(exponent = 7; (exponent > 0) && 
+          (!(sample & (0x80 << exponent))); exponent--)
+      {
+      }
+      mantissa = (sample >> (exponent + 3)) & 0x0F;
+
+      out[i] = (char)~(sign | (exponent << 4) | mantissa);
+   }
+}
+
+/*************************************************************************
+ *                          kosound_ima_encode                           *
+ *************************************************************************/
+static inline int kosound_ima_encode(int sample, int* predictor, 
+      int* index)
+{
+   int step = kosound_ima_steps[*index];
+   int diff = sample - *predictor;
+   int delta = step >> 3;
+   int nibble = 0;
+
+   if(diff < 0)
+   {
+      nibble = 8;
+      diff = -diff;
+   }
+   if(diff >= step)
+   {
+      nibble |= 4;
+      diff -= step;
+      delta += step;
+   }
+   step >>= 1;
+   if(diff >= step)
+   {
+      nibble |= 2;
+      diff -= step;
+      delta += step;
+   }
+   step >>= 1;
+   if(diff >= step)
+   {
+      nibble |= 1;
+      delta += step;
+   }
+
+   /* Track the decoder, which only knows the nibbles */
+   *predictor += (nibble & 8) ? -delta : delta;
+   *predictor = (*predictor < -32768) ? -32768 : 
+                ((*predictor > 32767) ? 32767 : *predictor);
+   *index += kosound_ima_index[nibble];
+   *index = (*index < 0) ? 0 : ((*index > 88) ? 88 : *index);
+
+   return nibble;
+}
+
+/*************************************************************************
+ *                             getIma4Frames                             *
+ *************************************************************************/
+size_t PcmCodec::getIma4Frames(size_t frames)
+{
+   return ((frames + KOSOUND_IMA4_BLOCK_FRAMES - 1) / 
+           KOSOUND_IMA4_BLOCK_FRAMES) * KOSOUND_IMA4_BLOCK_FRAMES;
+}
+
+/*************************************************************************
+ *                              encodeIma4                               *
+ *************************************************************************/
+void PcmCodec::encodeIma4(const int16_t* pcm, size_t frames, int channels,
+      std::vector<char>& out)
+{
+   size_t blocks = getIma4Frames(frames) / KOSOUND_IMA4_BLOCK_FRAMES;
+   size_t block, first, frame;
+   int predictor[2] = {0, 0}, index[2] = {0, 0};
+   int c, i, j, nibble;
+   int16_t sample;
+   unsigned char* dst;
+
+   out.assign(blocks * KOSOUND_IMA4_BLOCK_BYTES * channels, 0);
+   dst = (unsigned char*)&out[0];
+
+   for(block = 0; block < blocks; block++)
+   {
+      first = block * KOSOUND_IMA4_BLOCK_FRAMES;
+
+      /* Header of each channel: its first sample, as is, and its index */
+      for(c = 0; c < channels; c++)
+      {
+         sample = (first < frames) ? pcm[first * channels + c] : 0;
+         predictor[c] = sample;
+         dst[0] = (unsigned char)(sample & 0xFF);
+         dst[1] = (unsigned char)((sample >> 8) & 0xFF);
+         dst[2] = (unsigned char)index[c];
+         dst[3] = 0;
+         dst += 4;
+      }
+
+      /* Then groups of 8 samples, 4 bytes for each channel */
+      for(i = 1; i < KOSOUND_IMA4_BLOCK_FRAMES; i += 8)
+      {
+         for(c = 0; c < channels; c++)
+         {
+            for(j = 0; j < 8; j++)
+            {
+               frame = first + i + j;
+               sample = (frame < frames) ? pcm[frame * channels + c] : 0;
+               nibble = kosound_ima_encode(sample, &predictor[c], &index[c]);
+               /* Low nibble first */
+               dst[j >> 1] |= (j & 1) ? (nibble << 4) : nibble;
+            }
+            dst += 4;
+         }
+      }
+   }
+}
+
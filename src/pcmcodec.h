@@ -0,0 +1,66 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kosound_pcm_codec_h
+#define _kosound_pcm_codec_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace Kosound
+{
+
+/*! Samples per channel at each IMA4 block (the OpenAL Soft default 
+ * block alignment, as of WAV IMA ADPCM with 36 bytes blocks) */
+#define KOSOUND_IMA4_BLOCK_FRAMES  65
+/*! Bytes per channel at each IMA4 block */
+#define KOSOUND_IMA4_BLOCK_BYTES   36
+
+/*! Encoders of 16-bit PCM to the compact formats OpenAL Soft could play
+ * directly (AL_EXT_MULAW and AL_EXT_IMA4), decoded by its mixer. */
+class PcmCodec
+{
+   public:
+      /*! Encode to G.711 mu-law: a byte per sample (2:1).
+       * \param pcm -> interleaved samples
+       * \param samples -> number of samples (frames * channels)
+       * \param out -> receives the encoded data */
+      static void encodeMulaw(const int16_t* pcm, size_t samples,
+            std::vector<char>& out);
+
+      /*! Encode to IMA ADPCM, as WAV IMA4 blocks of 
+       * KOSOUND_IMA4_BLOCK_FRAMES frames (about 4:1). The last block is
+       * padded with silence.
+       * \param pcm -> interleaved samples
+       * \param frames -> number of frames
+       * \param channels -> 1 or 2
+       * \param out -> receives the encoded data */
+      static void encodeIma4(const int16_t* pcm, size_t frames, 
+            int channels, std::vector<char>& out);
+
+      /*! \return frames of IMA4 data, after padding to whole blocks */
+      static size_t getIma4Frames(size_t frames);
+};
+
+}
+
+#endif
+
@@ -0,0 +1,187 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "profiler.h"
+
+#include <chrono>
+#include <stdio.h>
+
+using namespace Kosound;
+
+/*************************************************************************
+ *                              setCallback                              *
+ *************************************************************************/
+void Profiler::setCallback(ProfilerCallback callback, void* userData)
+{
+   Profiler::userData = userData;
+   Profiler::callback = callback;
+}
+
+/*************************************************************************
+ *                            startRecording                             *
+ *************************************************************************/
+void Profiler::startRecording(size_t events)
+{
+   size_t size = (events > 0) ? events : 1;
+
+   recording = false;
+   if(Profiler::events.size() != size)
+   {
+      /* Only here zones must not be recording (see header) */
+      Profiler::events.clear();
+      Profiler::events.shrink_to_fit();
+      Profiler::events.resize(size);
+   }
+   nextEvent = 0;
+   recording = true;
+}
+
+/*************************************************************************
+ *                             stopRecording                             *
+ *************************************************************************/
+void Profiler::stopRecording()
+{
+   recording = false;
+}
+
+/*************************************************************************
+ *                                  now                                  *
+ *************************************************************************/
+int64_t Profiler::now()
+{
+   static const std::chrono::steady_clock::time_point epoch = 
+      std::chrono::steady_clock::now();
+
+   return std::chrono::duration_cast<std::chrono::microseconds>(
+         std::chrono::steady_clock::now() - epoch).count();
+}
+
+/*************************************************************************
+ *                               getThread                               *
+ *************************************************************************/
+int Profiler::getThread()
+{
+   static thread_local int thread = 0;
+
+   if(thread == 0)
+   {
+      thread = ++lastThread;
+   }
+   return thread;
+}
+
+/*************************************************************************
+ *                                 enter                                 *
+ *************************************************************************/
+int64_t Profiler::enter(const char* zone)
+{
+   ProfilerCallback cb = callback;
+
+   if(cb != NULL)
+   {
+      cb(zone, true, userData);
+   }
+   return (recording) ? now() : -1;
+}
+
+/*************************************************************************
+ *                                 leave                                 *
+ *************************************************************************/
+void Profiler::leave(const char* zone, int64_t start)
+{
+   ProfilerCallback cb = callback;
+   size_t index;
+
+   if(cb != NULL)
+   {
+      cb(zone, false, userData);
+   }
+
+   if( (start >= 0) && (recording) )
+   {
+      /* Each zone takes its own slot: no lock needed */
+      index = nextEvent.fetch_add(1) % events.size();
+      Event& event = events[index];
+      event.zone = zone;
+      event.thread = getThread();
+      event.start = start;
+      event.duration = now() - start;
+   }
+}
+
+/*************************************************************************
+ *                           writeChromeTrace                            *
+ *************************************************************************/
+void Profiler::writeChromeTrace(std::string& out)
+{
+   size_t total = nextEvent;
+   size_t first, i;
+   char line[256];
+
+   /* Oldest first: after a wrap, the oldest is the next to overwrite */
+   first = (total > events.size()) ? total - events.size() : 0;
+
+   out = "{\"traceEvents\":[\n";
+   for(i = first; i < total; i++)
+   {
+      const Event& event = events[i % events.size()];
+      snprintf(line, sizeof(line), 
+            "%s{\"name\":\"%s\",\"cat\":\"kosound\",\"ph\":\"X\","
+            "\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%d}",
+            (i == first) ? "" : ",\n", event.zone, 
+            (long long)event.start, (long long)event.duration, 
+            event.thread);
+      out += line;
+   }
+   out += "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+/*************************************************************************
+ *                            saveChromeTrace                            *
+ *************************************************************************/
+bool Profiler::saveChromeTrace(const Kobold::String& fileName)
+{
+   std::string trace;
+   FILE* f;
+   bool res;
+
+   writeChromeTrace(trace);
+
+   f = fopen(fileName.c_str(), "wb");
+   if(f == NULL)
+   {
+      return false;
+   }
+   res = (fwrite(trace.data(), 1, trace.size(), f) == trace.size());
+   fclose(f);
+
+   return res;
+}
+
+/*************************************************************************
+ *                            static members                             *
+ *************************************************************************/
+std::atomic<ProfilerCallback> Profiler::callback(NULL);
+void* Profiler::userData = NULL;
+std::atomic<bool> Profiler::recording(false);
+std::vector<Profiler::Event> Profiler::events;
+std::atomic<size_t> Profiler::nextEvent(0);
+std::atomic<int> Profiler::lastThread(0);
+
@@ -0,0 +1,151 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kosound_profiler_h
+#define _kosound_profiler_h
+
+#include "kosoundconfig.h"
+#include <kobold/kstring.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace Kosound
+{
+
+/*! Default number of zones kept by Profiler::startRecording */
+#define KOSOUND_PROFILER_DEFAULT_EVENTS  65536
+
+/*! Called when entering (enter == true) and leaving a profiler zone. 
+ * It's called from any thread doing audio work (as the decode ones). 
+ * \param zone -> zone name (a string literal, same pointer on each call)
+ * \param enter -> true when entering it, false when leaving
+ * \param userData -> as given to Profiler::setCallback */
+typedef void (*ProfilerCallback)(const char* zone, bool enter, 
+      void* userData);
+
+/*! Instrumentation of the audio pipeline: zones (see KOSOUND_PROFILE_ZONE)
+ * are forwarded to an external profiler callback and/or recorded into an
+ * in-process ring buffer, which could be written as a Chrome trace_event
+ * JSON (to open at chrome://tracing or Perfetto). 
+ * \note Zones only exist when built with the KOSOUND_PROFILE option:
+ *       otherwise they compile to nothing, and nothing is recorded. */
+class Profiler
+{
+   public:
+      /*! Define the external profiler callback (NULL for none). Should
+       * be defined before any audio work (or with it suspended). */
+      static void setCallback(ProfilerCallback callback, void* userData);
+
+      /*! Start recording zones, discarding the previously recorded ones.
+       * The ring is only (re)allocated when its size changes: that call
+       * must be done as writeChromeTrace (not recording, or with no
+       * audio work happening), as a zone being recorded could write to
+       * the freed ring. With the same size, it's safe at any time.
+       * \param events -> ring size: only the last events zones are kept */
+      static void startRecording(size_t events=KOSOUND_PROFILER_DEFAULT_EVENTS);
+
+      /*! Stop recording zones (the recorded ones are kept) */
+      static void stopRecording();
+
+      /*! Write the recorded zones as a Chrome trace_event JSON. Must be 
+       * called while not recording, or with no audio work happening.
+       * \param out -> string to write to */
+      static void writeChromeTrace(std::string& out);
+
+      /*! Save the recorded zones as a Chrome trace_event JSON file 
+       * (see writeChromeTrace).
+       * \return true if saved */
+      static bool saveChromeTrace(const Kobold::String& fileName);
+
+      /*! Enter a zone (see ProfileZone)
+       * \return its start time, or -1 if not recording */
+      static int64_t enter(const char* zone);
+
+      /*! Leave a zone (see ProfileZone)
+       * \param start -> as returned by enter */
+      static void leave(const char* zone, int64_t start);
+
+   private:
+      /*! A recorded zone */
+      class Event
+      {
+         public:
+            const char* zone;  /**< Zone name */
+            int thread;        /**< Thread it was recorded at */
+            int64_t start;     /**< Start time (us) */
+            int64_t duration;  /**< Duration (us) */
+      };
+
+      /*! \return microseconds since the profiler epoch */
+      static int64_t now();
+
+      /*! \return small identifier of the calling thread */
+      static int getThread();
+
+      static std::atomic<ProfilerCallback> callback; /**< External one */
+      static void* userData;                      /**< Of the callback */
+      static std::atomic<bool> recording;         /**< If recording */
+      static std::vector<Event> events;           /**< Ring of events */
+      static std::atomic<size_t> nextEvent;       /**< Total recorded */
+      static std::atomic<int> lastThread;         /**< Last thread id */
+};
+
+/*! A profiler zone, from its construction to its destruction. Use the
+ * KOSOUND_PROFILE_ZONE macro instead, to compile it away when disabled. */
+class ProfileZone
+{
+   public:
+      /*! Enter the zone
+       * \param zone -> its name. Must be a string literal. */
+      ProfileZone(const char* zone) 
+      {
+         this->zone = zone;
+         this->start = Profiler::enter(zone);
+      };
+      /*! Leave the zone */
+      ~ProfileZone()
+      {
+         Profiler::leave(zone, start);
+      };
+
+   private:
+      const char* zone; /**< Its name */
+      int64_t start;    /**< Its start time, or -1 if not recording */
+};
+
+#define KOSOUND_PROFILE_CONCAT2(a, b) a##b
+#define KOSOUND_PROFILE_CONCAT(a, b) KOSOUND_PROFILE_CONCAT2(a, b)
+
+#if KOSOUND_PROFILE
+   /*! Profile from here to the end of the current scope */
+   #define KOSOUND_PROFILE_ZONE(zone) \
+      Kosound::ProfileZone KOSOUND_PROFILE_CONCAT(kosoundZone, __LINE__)(zone)
+#else
+   #define KOSOUND_PROFILE_ZONE(zone)
+#endif
+
+}
+
+#endif
+
@@ -19,6 +19,7 @@
  */
 
 #include "sndfx.h"
+#include "soundasset.h"
 #include <kobold/log.h>
 
 using namespace Kosound;
@@ -29,38 +30,35 @@ using namespace Kosound;
 SndFx::SndFx()
 {
    sndStream = NULL;
-   removable = true;
+   asset = NULL;
+   resetState();
 }
 
 /*************************************************************************
  *                             Constructor                               *
  *************************************************************************/
 SndFx::SndFx(ALfloat centerX, ALfloat centerY, ALfloat centerZ, int lp,
-      const Kobold::String& fileName, Kobold::FileReader* fileReader)
+      const Kobold::String& fileName, Kobold::FileReader* fileReader, 
+      bool play, bool mono)
 {
-   removable = true;
+   asset = NULL;
+   resetState();
    /* Create the Ogg Stream */ 
    sndStream = createStream(fileName, fileReader);
    if(sndStream == NULL)
    {
       return;
    }
+   sndStream->setDownmix(mono);
 
    /*! open and load things */
    if(sndStream->open(fileName))
    {
       /* Define Position and OpenAL things */
-      alSourcei(sndStream->getSource(), AL_SOURCE_RELATIVE, AL_FALSE);
-      alSource3f(sndStream->getSource(), AL_POSITION, centerX,centerY,centerZ);
-      alSourcef(sndStream->getSource(), AL_REFERENCE_DISTANCE, 160);
-      alSource3f(sndStream->getSource(), AL_VELOCITY, 0.0, 0.0, 0.0);
-      alSource3f(sndStream->getSource(), AL_DIRECTION, 0.0, 0.0, 0.0);
-      alSourcef(sndStream->getSource(), AL_ROLLOFF_FACTOR, 1.0);
-      alSourcef(sndStream->getSource(), AL_PITCH, 1.0f);
-      alSourcef(sndStream->getSource(), AL_GAIN, 1.0f);
+      definePosition(centerX, centerY, centerZ);
       setLoop(lp);
 
-      if(!sndStream->playback())
+      if( (play) && (!sndStream->playback()) )
       {
          Kobold::Log::add(Kobold::String("Couldn't play sound effect: ") +
                fileName);
@@ -77,9 +75,10 @@ SndFx::SndFx(ALfloat centerX, ALfloat centerY, ALfloat centerZ, int lp,
  *                             Constructor                               *
  *************************************************************************/
 SndFx::SndFx(int lp, const Kobold::String& fileName, 
-      Kobold::FileReader* fileReader)
+      Kobold::FileReader* fileReader, bool play)
 {
-   removable = true;
+   asset = NULL;
+   resetState();
    /* Create the Ogg Stream */ 
    sndStream = createStream(fileName, fileReader);
    if(!sndStream)
@@ -93,7 +92,7 @@ SndFx::SndFx(int lp, const Kobold::String& fileName,
       sndStream->defineAsMusic();
       setLoop(lp);
 
-      if(!sndStream->playback())
+      if( (play) && (!sndStream->playback()) )
       {
          //cerr << "Couldn't play sound effect: " << fileName << endl;
       }
@@ -105,6 +104,104 @@ SndFx::SndFx(int lp, const Kobold::String& fileName,
    }
 }
 
+/*************************************************************************
+ *                             Constructor                               *
+ *************************************************************************/
+SndFx::SndFx(SoundAsset* asset)
+{
+   this->asset = asset;
+   resetState();
+
+   /* Streamed from the asset memory: nothing to read nor decode */
+   sndStream = new AssetStream(asset);
+   if(!sndStream->open(asset->getFileName()))
+   {
+      delete sndStream;
+      sndStream = NULL;
+   }
+}
+
+/*************************************************************************
+ *                              resetState                               *
+ *************************************************************************/
+void SndFx::resetState()
+{
+   removable = true;
+   handle = SOUND_INVALID_HANDLE;
+   emitter = SOUND_INVALID_EMITTER;
+   policy = NULL;
+   policyOrder = 0;
+   gain = 1.0f;
+   nextUpdate = 0;
+   startTime = -1.0;
+}
+
+/*************************************************************************
+ *                            definePosition                             *
+ *************************************************************************/
+void SndFx::definePosition(ALfloat centerX, ALfloat centerY, ALfloat centerZ)
+{
+   ALuint source = sndStream->getSource();
+
+   alSourcei(source, AL_SOURCE_RELATIVE, AL_FALSE);
+   alSource3f(source, AL_POSITION, centerX, centerY, centerZ);
+   alSourcef(source, AL_REFERENCE_DISTANCE, 160);
+   alSource3f(source, AL_VELOCITY, 0.0, 0.0, 0.0);
+   alSource3f(source, AL_DIRECTION, 0.0, 0.0, 0.0);
+   alSourcef(source, AL_ROLLOFF_FACTOR, 1.0);
+   alSourcef(source, AL_PITCH, 1.0f);
+   alSourcef(source, AL_GAIN, 1.0f);
+}
+
+/*************************************************************************
+ *                                replay                                 *
+ *************************************************************************/
+bool SndFx::replay(bool positional, ALfloat centerX, ALfloat centerY,
+      ALfloat centerZ, int lp)
+{
+   ALuint source;
+
+   if(sndStream == NULL)
+   {
+      return false;
+   }
+
+   resetState();
+   source = sndStream->getSource();
+   if(positional)
+   {
+      definePosition(centerX, centerY, centerZ);
+   }
+   else
+   {
+      sndStream->defineAsMusic();
+      alSourcef(source, AL_PITCH, 1.0f);
+      alSourcef(source, AL_GAIN, 1.0f);
+   }
+   /* Its last play could have set a cone */
+   alSourcef(source, AL_CONE_INNER_ANGLE, 360.0f);
+   alSourcef(source, AL_CONE_OUTER_ANGLE, 360.0f);
+   setLoop(lp);
+
+   return sndStream->playback(true);
+}
+
+/*************************************************************************
+ *                                recycle                                *
+ *************************************************************************/
+void SndFx::recycle()
+{
+   if(policy != NULL)
+   {
+      policy->removeInstance();
+      policy = NULL;
+   }
+   if(sndStream != NULL)
+   {
+      sndStream->stop();
+   }
+}
+
 /*************************************************************************
  *                             createStream                              *
  *************************************************************************/
@@ -116,6 +213,11 @@ SoundStream* SndFx::createStream(const Kobold::String& fileName,
       /* Create Ogg */
       return new OggStream(fileReader);
    }
+   else if(fileName.find(Kobold::String(".kosnd")) != Kobold::String::npos)
+   {
+      /* Create pre-decoded */
+      return new KosndStream(fileReader);
+   }
    else
    {
 #if KOBOLD_PLATFORM == KOBOLD_PLATFORM_MACOS || \
@@ -135,6 +237,10 @@ SoundStream* SndFx::createStream(const Kobold::String& fileName,
  *************************************************************************/
 SndFx::~SndFx()
 {
+   if(policy != NULL)
+   {
+      policy->removeInstance();
+   }
    if(sndStream != NULL)
    {
       sndStream->release();
@@ -142,6 +248,27 @@ SndFx::~SndFx()
    }
 }
 
+/*************************************************************************
+ *                               setPolicy                               *
+ *************************************************************************/
+void SndFx::setPolicy(SoundPolicy* policy, unsigned long order)
+{
+   this->policy = policy;
+   this->policyOrder = order;
+}
+
+/*************************************************************************
+ *                               getSource                               *
+ *************************************************************************/
+ALuint SndFx::getSource()
+{
+   if(sndStream != NULL)
+   {
+      return sndStream->getSource();
+   }
+   return 0;
+}
+
 /*************************************************************************
  *                                setLoop                                *
  *************************************************************************/
@@ -225,12 +352,40 @@ bool SndFx::rewind()
 {
    if(sndStream != NULL)
    {
+      nextUpdate = 0;
       return(sndStream->rewind());
    }
 
    return(false);
 }
 
+/*************************************************************************
+ *                                 seek                                  *
+ *************************************************************************/
+bool SndFx::seek(double seconds)
+{
+   if(sndStream != NULL)
+   {
+      nextUpdate = 0;
+      return(sndStream->seek(seconds));
+   }
+
+   return(false);
+}
+
+/*************************************************************************
+ *                                 tell                                  *
+ *************************************************************************/
+double SndFx::tell()
+{
+   if(sndStream != NULL)
+   {
+      return(sndStream->tell());
+   }
+
+   return(0.0);
+}
+
 /*************************************************************************
  *                               update                                  *
  *************************************************************************/
@@ -243,6 +398,126 @@ bool SndFx::update()
    return(false);
 }
 
+/*************************************************************************
+ *                               update                                  *
+ *************************************************************************/
+bool SndFx::update(char* scratch)
+{
+   if(sndStream != NULL)
+   {
+      return(sndStream->update(scratch)); 
+   }
+   return(false);
+}
+
+/*************************************************************************
+ *                                prepare                                *
+ *************************************************************************/
+bool SndFx::prepare()
+{
+   if(sndStream != NULL)
+   {
+      return(sndStream->prepare());
+   }
+   return(false);
+}
+
+/*************************************************************************
+ *                                enqueue                                *
+ *************************************************************************/
+bool SndFx::enqueue(double silence)
+{
+   if(sndStream != NULL)
+   {
+      return(sndStream->enqueue(silence));
+   }
+   return(false);
+}
+
+/*************************************************************************
+ *                                 start                                 *
+ *************************************************************************/
+void SndFx::start()
+{
+   if(sndStream != NULL)
+   {
+      sndStream->start();
+   }
+}
+
+/*************************************************************************
+ *                                resume                                 *
+ *************************************************************************/
+bool SndFx::resume()
+{
+   if(sndStream != NULL)
+   {
+      return(sndStream->resume());
+   }
+   return(false);
+}
+
+/*************************************************************************
+ *                             detachSource                              *
+ *************************************************************************/
+void SndFx::detachSource(SourceState& state)
+{
+   state.active = false;
+   state.sourceState = AL_INITIAL;
+   if(sndStream != NULL)
+   {
+      sndStream->detachSource(state);
+   }
+}
+
+/*************************************************************************
+ *                             attachSource                              *
+ *************************************************************************/
+bool SndFx::attachSource(const SourceState& state)
+{
+   if(sndStream != NULL)
+   {
+      return(sndStream->attachSource(state));
+   }
+   return(false);
+}
+
+/*************************************************************************
+ *                             getQueuedTime                             *
+ *************************************************************************/
+double SndFx::getQueuedTime()
+{
+   if(sndStream != NULL)
+   {
+      return(sndStream->getQueuedTime());
+   }
+   return(0.0);
+}
+
+/*************************************************************************
+ *                            getRefillDelay                             *
+ *************************************************************************/
+double SndFx::getRefillDelay(double margin)
+{
+   if(sndStream != NULL)
+   {
+      return(sndStream->getRefillDelay(margin));
+   }
+   return(0.0);
+}
+
+/*************************************************************************
+ *                             isWaitingLoop                             *
+ *************************************************************************/
+bool SndFx::isWaitingLoop()
+{
+   if(sndStream != NULL)
+   {
+      return(sndStream->isWaitingLoop());
+   }
+   return(false);
+}
+
 /*************************************************************************
  *                               isPlaying                               *
  *************************************************************************/
@@ -260,10 +535,19 @@ bool SndFx::isPlaying()
  *                            changeVolume                               *
  *************************************************************************/
 void SndFx::changeVolume(int volume)
+{
+   gain = volume / 128.0f;
+   applyBusGain(getBusGain());
+}
+
+/*************************************************************************
+ *                             applyBusGain                              *
+ *************************************************************************/
+void SndFx::applyBusGain(ALfloat busGain)
 {
    if(sndStream)
    {
-      sndStream->changeVolume(volume);
+      alSourcef(sndStream->getSource(), AL_GAIN, gain * busGain);
    }
 }
 
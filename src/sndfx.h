@@ -32,6 +32,10 @@
 #endif
 
 #include "soundstream.h"
+#include "soundcommand.h"
+#include "soundpolicy.h"
+#include "soundbus.h"
+#include "soundemitter.h"
 
 #if KOBOLD_PLATFORM == KOBOLD_PLATFORM_MACOS || \
     KOBOLD_PLATFORM == KOBOLD_PLATFORM_IOS
@@ -41,6 +45,10 @@
 
 /* OGG sound files for all platforms */
 #include "oggstream.h"
+/* Pre-decoded kosound files for all platforms */
+#include "kosndstream.h"
+/* Registered assets kept in memory */
+#include "assetstream.h"
 
 #include "kosoundconfig.h"
 #include <kobold/list.h>
@@ -49,7 +57,7 @@ namespace Kosound
 {
 
 /*! Sound Effect Manipulation and Definitions */
-class SndFx: public Kobold::ListElement
+class SndFx: public Kobold::ListElement, public SoundBusMember
 {
    public:
       /*! Constructor of NULL class (for head node) */
@@ -59,9 +67,11 @@ class SndFx: public Kobold::ListElement
        * \param lp -> loop interval (<0 won't loop, =0 loop 
        *              just after the end, >0 wait lp seconds to loop)
        * \param fileName -> name of the Ogg File to Open 
-       * \param fileReader -> FileReader to use. Will be deleted by SndFx. */
+       * \param fileReader -> FileReader to use. Will be deleted by SndFx. 
+       * \param play -> if will start to play now (false to start it 
+       *                later, with prepare, enqueue and start) */
       SndFx(int lp, const Kobold::String& fileName,
-            Kobold::FileReader* fileReader);
+            Kobold::FileReader* fileReader, bool play=true);
       
       /*! Constructor of the Class.
        * \param centerX -> X position of the source
@@ -69,12 +79,41 @@ class SndFx: public Kobold::ListElement
        * \param centerZ -> Z position of the source
        * \param lp -> loop interval (see setLoop)
        * \param fileName -> name of the Ogg File to Open 
-       * \param fileReader -> FileReader to use. Will be deleted by SndFx. */
+       * \param fileReader -> FileReader to use. Will be deleted by SndFx. 
+       * \param play -> if will start to play now
+       * \param mono -> if a stereo file is downmixed to mono, as only 
+       *                mono sources are spatialized by OpenAL */
       SndFx(ALfloat centerX, ALfloat centerY, ALfloat centerZ, int lp,
-            const Kobold::String& fileName, Kobold::FileReader* fileReader);
+            const Kobold::String& fileName, Kobold::FileReader* fileReader,
+            bool play=true, bool mono=true);
+
+      /*! Constructor of a recyclable sound effect of a registered asset,
+       * streamed from its kept PCM (see AssetStream). Not played here:
+       * see replay.
+       * \param asset -> the asset. Must outlive the SndFx. */
+      SndFx(SoundAsset* asset);
+
       /*! Destructor */
       ~SndFx();
 
+      /*! Play again, from the start, a sound effect of an asset (see
+       * recycle), resetting all its state, as if just created.
+       * \param positional -> if positional (or relative to the listener)
+       * \param centerX -> X position of the source
+       * \param centerY -> Y position of the source
+       * \param centerZ -> Z position of the source
+       * \param lp -> loop interval (see setLoop)
+       * \return false if couldn't play */
+      bool replay(bool positional, ALfloat centerX, ALfloat centerY,
+            ALfloat centerZ, int lp);
+
+      /*! Stop it, leaving its policy, to be kept idle by its asset till
+       * played again (see replay) */
+      void recycle();
+
+      /*! \return asset it streams, if recyclable, or NULL */
+      SoundAsset* getAsset() const { return asset; };
+
       /*! Redefine Position of the Source
        * \param centerX -> X position of the source
        * \param centerY -> Y position of the source
@@ -111,12 +150,67 @@ class SndFx: public Kobold::ListElement
        * \return false when execution is over */
       bool update();
 
+      /*! Update the Execution of the Source, decoding into a buffer
+       * owned by the caller (see SoundStream::update(char*)).
+       * \return false when execution is over */
+      bool update(char* scratch);
+
+      /*! Decode its first buffers, without starting (see 
+       * SoundStream::prepare) */
+      bool prepare();
+
+      /*! Queue its prepared buffers (see SoundStream::enqueue) */
+      bool enqueue(double silence);
+
+      /*! Start a prepared and queued playback */
+      void start();
+
+      /*! Define the audio time it's scheduled to start at 
+       * (see Sound::scheduleSoundEffect), or < 0 if not waiting to. When
+       * started by the device, it's kept after the start. */
+      void setStartTime(double time) { startTime = time; };
+
+      /*! \return audio time it's scheduled to start at, or < 0 */
+      double getStartTime() const { return startTime; };
+
+      /*! Restart it, if stopped by a device loss (see SoundStream) */
+      bool resume();
+
+      /*! Save its source state, releasing its AL objects (see 
+       * SoundStream::detachSource) */
+      void detachSource(SourceState& state);
+
+      /*! Recreate its AL objects, restoring a saved state (see 
+       * SoundStream::attachSource) */
+      bool attachSource(const SourceState& state);
+
+      /*! \return time, in seconds, of audio queued but not yet played */
+      double getQueuedTime();
+
+      /*! \return time, in seconds, until it needs an update (see
+       * SoundStream::getRefillDelay) */
+      double getRefillDelay(double margin);
+
+      /*! Define when it must be updated again
+       * \param time -> Sound clock time, in milliseconds */
+      void setNextUpdate(unsigned long time) { nextUpdate = time; };
+
+      /*! \return Sound clock time it must be updated again */
+      unsigned long getNextUpdate() const { return nextUpdate; };
+
+      /*! \return if just waiting its loop interval (see 
+       * SoundStream::isWaitingLoop) */
+      bool isWaitingLoop();
+
       /*! Verify if the file still is playing */
       bool isPlaying();
 
-      /*! Change the stream overall volume 
+      /*! Change the stream overall volume, relative to its bus
        * \param volume -> volume value [0 - 128]*/
       void changeVolume(int volume);
+
+      /*! Apply a new effective gain of its bus */
+      void applyBusGain(ALfloat busGain);
    
       /*! Define the SndFx as a music */
       void defineAsMusic();
@@ -125,6 +219,14 @@ class SndFx: public Kobold::ListElement
        * \return true if successfull */
       bool rewind();
 
+      /*! Seek the sound effect to a position (sample-accurate)
+       * \param seconds -> position from the start
+       * \return true if successfull */
+      bool seek(double seconds);
+
+      /*! \return current playback position, in seconds */
+      double tell();
+
       /*! Set removal flag (true will remove when ended all plays) */
       void setRemoval(bool r){removable=r;};
 
@@ -132,13 +234,57 @@ class SndFx: public Kobold::ListElement
        * (repeats included). */
       const bool getRemoval() const { return removable; };
 
-   private:
-      /*! Create specific sound stream (related with file type) */
-      SoundStream* createStream(const Kobold::String& fileName,
+      /*! Set the handle the sound effect was posted with */
+      void setHandle(SoundHandle h) { handle = h; };
+
+      /*! \return handle the sound effect was posted with, if any */
+      SoundHandle getHandle() const { return handle; };
+
+      /*! Set the emitter it's the instance of */
+      void setEmitter(EmitterId id) { emitter = id; };
+
+      /*! \return emitter it's the instance of, if any */
+      EmitterId getEmitter() const { return emitter; };
+
+      /*! Set the playback limits it's counted on
+       * \param policy -> policy of its file
+       * \param order -> its order at the policy */
+      void setPolicy(SoundPolicy* policy, unsigned long order);
+
+      /*! \return policy it's counted on, if any */
+      SoundPolicy* getPolicy() const { return policy; };
+
+      /*! \return its order at its policy */
+      unsigned long getPolicyOrder() const { return policyOrder; };
+
+      /*! \return its AL source, or 0 if not opened */
+      ALuint getSource();
+
+      /*! Create specific sound stream (related with file type)
+       * \param fileName -> name of the file
+       * \param fileReader -> FileReader to use. Will be deleted by the 
+       *                      created stream.
+       * \return new stream or NULL if unsupported */
+      static SoundStream* createStream(const Kobold::String& fileName,
             Kobold::FileReader* fileReader);
 
+   private:
+      /*! Define all positional parameters of its source */
+      void definePosition(ALfloat centerX, ALfloat centerY, ALfloat centerZ);
+
+      /*! Reset its own state to the one of a just created sound effect */
+      void resetState();
+
       SoundStream* sndStream; /**< Sound stream used */
+      SoundAsset* asset; /**< Asset streamed, if recyclable */
       bool removable; /**< if is automatically removable or not */
+      SoundHandle handle; /**< Handle, if posted by a command */
+      EmitterId emitter; /**< Emitter it's the instance of, if any */
+      SoundPolicy* policy; /**< Limits it's counted on, if any */
+      ALfloat gain; /**< Its own gain (relative to its bus) */
+      unsigned long policyOrder; /**< Its order at the policy */
+      unsigned long nextUpdate; /**< When it needs an update (ms) */
+      double startTime; /**< Scheduled start, if waiting for it */
 };
 
 }
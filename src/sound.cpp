@@ -19,16 +19,24 @@
  */
 
 #include "sound.h"
+#include "bufferedreader.h"
+#include "profiler.h"
 #include <kobold/log.h>
 
 #include <math.h>
+#include <algorithm>
 
 #define PID180 M_PI / 180.0 /**< PI / 180 definition */
 inline double deg2Rad(double x){ return PID180 * x; }
 
 using namespace Kosound;
 
-#define KOBOLD_SOUND_UPDATE_RATE   100
+#define KOSOUND_IDLE_UPDATE_RATE   100 /**< ms between ended streams checks */
+#define KOSOUND_RECLAIM_RATE       100 /**< ms between one-shots reclaims */
+#define KOSOUND_REOPEN_RATE       1000 /**< ms between device reopen tries */
+#define KOSOUND_SCHEDULE_LEAD     0.15 /**< s to start a scheduled before */
+#define KOSOUND_COMMAND_QUEUE_SIZE 1024 /**< Max pending commands */
+#define KOSOUND_EVENT_QUEUE_SIZE   4096 /**< Max pending AL events */
 
 
 /*************************************************************************
@@ -43,6 +51,7 @@ void Sound::init()
 
    musicVolume = DEFAULT_VOLUME;
    sndfxVolume = DEFAULT_VOLUME;
+   createDefaultBuses();
 
    if(!initOpenAL())
    {
@@ -51,48 +60,199 @@ void Sound::init()
 }
 
 /*************************************************************************
- *                             initOpenAL                                *
+ *                               initAsync                               *
  *************************************************************************/
-bool Sound::initOpenAL()
+void Sound::initAsync()
 {
-   /* Initialize Open AL */
-   device = alcOpenDevice(NULL); 
-   
-   if (device != NULL) 
-   {
-      context=alcCreateContext(device,NULL); 
-      if (context != NULL) 
-      {
-         alcMakeContextCurrent(context);
-         enabled = true;
-         /* set attenuation model */
-         alDistanceModel(AL_EXPONENT_DISTANCE);
-         return true;
-      }
-      else
-      {
-         Kobold::Log::add("Sound::initOpenAL() Couldn't create context!");
-      }
+   /* Only enabled when the device is ready */
+   enabled = false;
+
+   backMusic = NULL;
+
+   musicVolume = DEFAULT_VOLUME;
+   sndfxVolume = DEFAULT_VOLUME;
+   createDefaultBuses();
 
+   deviceOpened = false;
+   opening = true;
+   openThread = std::thread(&Sound::openDeviceThread);
+}
+
+/*************************************************************************
+ *                           openDeviceThread                            *
+ *************************************************************************/
+void Sound::openDeviceThread()
+{
+   openError = openDevice(NULL);
+   deviceOpened = true;
+}
+
+/*************************************************************************
+ *                            finishAsyncInit                            *
+ *************************************************************************/
+void Sound::finishAsyncInit()
+{
+   openThread.join();
+
+   if(openError == NULL)
+   {
+      initContext();
    }
    else
    {
-      Kobold::Log::add("Sound::initOpenAL() No OpenAL device available!");
+      Kobold::Log::add(Kobold::String("Sound::initAsync() ") + openError);
+      timer.reset();
+   }
+   opening = false;
+
+   if(!enabled)
+   {
+      /* Nothing will play the queued requests */
+      discardCommands();
    }
+}
+
+/*************************************************************************
+ *                               isOpening                               *
+ *************************************************************************/
+bool Sound::isOpening()
+{
+   return opening;
+}
+
+/*************************************************************************
+ *                          createDefaultBuses                           *
+ *************************************************************************/
+void Sound::createDefaultBuses()
+{
+   if(masterBus != NULL)
+   {
+      return;
+   }
+
+   masterBus = createBus(KOSOUND_BUS_MASTER, NULL);
+   musicBus = createBus(KOSOUND_BUS_MUSIC, masterBus);
+   sfxBus = createBus(KOSOUND_BUS_SFX, masterBus);
+   createBus(KOSOUND_BUS_VOICE, masterBus);
+   createBus(KOSOUND_BUS_UI, masterBus);
+}
+
+/*************************************************************************
+ *                             initOpenAL                                *
+ *************************************************************************/
+bool Sound::initOpenAL()
+{
+   const char* error;
+
+   /* Initialize Open AL */
+   error = openDevice(NULL);
+   if(error == NULL)
+   {
+      initContext();
+      return true;
+   }
+
+   Kobold::Log::add(Kobold::String("Sound::initOpenAL() ") + error);
    enabled = false;
    timer.reset();
    return false;
 }
 
+/*************************************************************************
+ *                              openDevice                               *
+ *************************************************************************/
+const char* Sound::openDevice(const char* deviceName)
+{
+   /* Note: could be called by the initAsync thread. No log here. */
+   context = NULL;
+   device = alcOpenDevice(deviceName); 
+   if(device == NULL)
+   {
+      return "No OpenAL device available!";
+   }
+
+   context = alcCreateContext(device, NULL); 
+   if(context == NULL) 
+   {
+      alcCloseDevice(device);
+      device = NULL;
+      return "Couldn't create context!";
+   }
+
+   return NULL;
+}
+
+/*************************************************************************
+ *                              initContext                              *
+ *************************************************************************/
+void Sound::initContext()
+{
+   alcMakeContextCurrent(context);
+   enabled = true;
+   /* set attenuation model */
+   alDistanceModel(AL_EXPONENT_DISTANCE);
+   /* Refill streams only when OpenAL tell us to, if able to */
+   OpenALExt::load(device);
+   enableEvents(useEvents);
+   /* Create all one-shot voices at once */
+   voicePool = new VoicePool(totalVoices);
+}
+
 /*************************************************************************
  *                               Finish                                  *
  *************************************************************************/
 void Sound::finish()
 {
+   std::map<Kobold::String, SoundPolicy*>::iterator it;
+   std::map<Kobold::String, SoundBus*>::iterator busIt;
+
+   if(opening)
+   {
+      /* Must wait the device to close it */
+      finishAsyncInit();
+   }
+
    if(enabled)
    {
       finishOpenAL();
    }
+
+   /* Stop the decode threads */
+   suspended = false;
+   suspendedThreads = 0;
+   pausedSources.clear();
+   clockOffset = 0.0;
+   setDecodeThreads(0);
+
+   /* And the read-ahead one (with its pooled buffers) */
+   BufferedReader::stopPrefetcher();
+   BufferedReader::clearChunkPool();
+
+   /* Free cached seek indexes */
+   OggSeekIndex::clearCache();
+
+   /* Log any remaining stream error */
+   StreamLog::drain();
+
+   /* And the emitters (with their readers) */
+   removeAllEmitters();
+
+   /* And the playback limits */
+   for(it = policies.begin(); it != policies.end(); ++it)
+   {
+      delete it->second;
+   }
+   policies.clear();
+
+   /* And the buses */
+   for(busIt = buses.begin(); busIt != buses.end(); ++busIt)
+   {
+      delete busIt->second;
+   }
+   buses.clear();
+   masterBus = NULL;
+   musicBus = NULL;
+   sfxBus = NULL;
 }
 
 /*************************************************************************
@@ -100,6 +260,8 @@ void Sound::finish()
  *************************************************************************/
 void Sound::finishOpenAL()
 {
+   size_t i;
+
    /* Clear the Opened Music */
    if(backMusic)
    {
@@ -110,216 +272,2463 @@ void Sound::finishOpenAL()
    /* Clear all opened Sound Effects */
    removeAllSoundEffects();
 
-   /* Clear OpenAL Context and Device */
-   alcDestroyContext(context);
-   alcCloseDevice(device);
-}
-
-/*************************************************************************
- *                          setListenerPosition                          *
- *************************************************************************/
-void Sound::setListenerPosition(ALfloat centerX, ALfloat centerY, 
-                                ALfloat centerZ, ALfloat phi, ALfloat theta,
-                                ALfloat d)
-{
-   if(enabled)
+   /* Clear one-shots and its assets (after the voices using them) */
+   if(voicePool)
    {
-      float posX, posY, posZ;   /* Listener Position */
-      ALfloat directionvect[6]; /* Direction Vector of Listener */
-      
-      	
-      alListener3f(AL_POSITION, centerX, centerY, centerZ);
+      delete voicePool;
+      voicePool = NULL;
+   }
+   for(i = 0; i < assets.size(); i++)
+   {
+      delete assets[i];
+   }
+   assets.clear();
 
-      float thetaR = deg2Rad(theta);
-      float phiR = deg2Rad(phi);
+   /* No more events */
+   enableEvents(false);
+   OpenALExt::unload();
 
-      float cosTheta = cos(thetaR);
-      float sinTheta = sin(thetaR);
-      
-      float cosPhi = cos(phiR);
-      float sinPhi = sin(phiR);
-      
-      posX = centerX + d * cosTheta * sinPhi;
-      posY = centerY + d * sinTheta;
-      posZ	= centerZ + d * cosTheta * cosPhi;
-      
-      directionvect[0] = centerX - posX;
-      directionvect[1] = centerY - posY;
-      directionvect[2] = centerZ - posZ;
-      directionvect[3] = 0;
-      directionvect[4] = 1;
-      directionvect[5] = 0;
-      alListenerfv(AL_ORIENTATION, directionvect);
+   /* Clear OpenAL Context and Device */
+   alcMakeContextCurrent(NULL);
+   if(context != NULL)
+   {
+      alcDestroyContext(context);
+      context = NULL;
+   }
+   if(device != NULL)
+   {
+      alcCloseDevice(device);
+      device = NULL;
    }
 }
 
 /*************************************************************************
- *                              loadMusic                                *
+ *                             reopenDevice                              *
  *************************************************************************/
-bool Sound::loadMusic(const Kobold::String& fileName, 
-      Kobold::FileReader* fileReader)
+bool Sound::reopenDevice(const char* deviceName)
 {
    if(!enabled)
    {
       return false;
    }
-      
-   if(backMusic)
+
+#ifdef ALC_SOFT_reopen_device
+   if(OpenALExt::hasReopen())
    {
-      /* Delete Active Music, if one is */
-      delete(backMusic);
-      backMusic = NULL;
+      /* Same context, sources and buffers: just moved */
+      if(!OpenALExt::alcReopenDevice(device, deviceName, NULL))
+      {
+         Kobold::Log::add(Kobold::LOG_LEVEL_ERROR, 
+               "Sound::reopenDevice(): couldn't reopen the device");
+         return false;
+      }
+      deviceLost = false;
+      resumeStreams();
+      return true;
    }
+#endif
 
-   /* Load The File and Set The active Music */
-   backMusic = new SndFx(0, fileName, fileReader);
-   backMusic->changeVolume(musicVolume);
-
-   backMusic->setLoop(SOUND_AUTO_LOOP);
-   backMusic->defineAsMusic();
-   
-   return true;
+   return recreateDevice(deviceName);
 }
 
 /*************************************************************************
- *                                flush                                  *
+ *                            recreateDevice                             *
  *************************************************************************/
-void Sound::flush()
+bool Sound::recreateDevice(const char* deviceName)
 {
-   SndFx* snd, *tmp;
+   std::vector<SourceState> states;
+   SourceState musicState;
+   ALfloat listenerPos[3];
+   ALfloat listenerOri[6];
+   ALfloat listenerGain = 1.0f;
+   double audioTime;
+   const char* error;
+   SndFx* snd;
    int i, total;
+   size_t n;
 
-   if(!enabled)
+   /* Save what lives at the current context (still valid, even if its
+    * device was lost) */
+   audioTime = getAudioTime();
+   alGetListenerfv(AL_POSITION, listenerPos);
+   alGetListenerfv(AL_ORIENTATION, listenerOri);
+   alGetListenerf(AL_GAIN, &listenerGain);
+   if(backMusic)
    {
-      return;
+      backMusic->detachSource(musicState);
    }
-   
-   if(timer.getMilliseconds() < KOBOLD_SOUND_UPDATE_RATE)
+   total = sndList.getTotal();
+   states.resize(total);
+   snd = (SndFx*)sndList.getFirst();
+   for(i = 0; i < total; i++)
    {
-      return;
+      snd->detachSource(states[i]);
+      snd = (SndFx*)snd->getNext();
    }
-   
-   /* Music Update */
+   if(voicePool)
+   {
+      delete voicePool;
+      voicePool = NULL;
+   }
+   for(n = 0; n < assets.size(); n++)
+   {
+      assets[n]->unload();
+   }
+
+   /* Change the device */
+   enableEvents(false);
+   OpenALExt::unload();
+   alcMakeContextCurrent(NULL);
+   alcDestroyContext(context);
+   alcCloseDevice(device);
+
+   error = openDevice(deviceName);
+   if( (error != NULL) && (deviceName != NULL) )
+   {
+      /* Better the default one than none */
+      error = openDevice(NULL);
+   }
+   if(error != NULL)
+   {
+      Kobold::Log::add(Kobold::String("Sound::reopenDevice() ") + error);
+      /* Nothing left to play at */
+      finishOpenAL();
+      enabled = false;
+      return false;
+   }
+   initContext();
+   deviceLost = false;
+
+   /* The new device clock restarts: keep the audio time continuous, so
+    * the scheduled times are still valid */
+   clockOffset = 0.0;
+   clockOffset = audioTime - getAudioTime();
+
+   /* Restore it all */
+   alListenerfv(AL_POSITION, listenerPos);
+   alListenerfv(AL_ORIENTATION, listenerOri);
+   alListenerf(AL_GAIN, listenerGain);
+   for(n = 0; n < assets.size(); n++)
+   {
+      assets[n]->reload();
+   }
+   pausedSources.clear();
    if(backMusic)
    {
-      if(!backMusic->update()) 
+      if(!backMusic->attachSource(musicState))
       {
-         Kobold::Log::add("Sound::flush: Error while playing music");
-         delete backMusic;
-         backMusic = NULL;
+         Kobold::Log::add("Sound::reopenDevice: couldn't restore the music");
+      }
+      else if(musicState.sourceState == AL_PAUSED)
+      {
+         pausedSources.push_back(backMusic->getSource());
       }
    }
-
-   /* Sound Effects Update */
-   total = sndList.getTotal();
+   scheduled.clear();
    snd = (SndFx*)sndList.getFirst();
-   for(i=0; i < total; i++)
+   for(i = 0; i < total; i++)
    {
-      if( (!snd->update()) && (snd->getRemoval()) )
+      if(!snd->attachSource(states[i]))
       {
-         /* Remove Sound */
-         tmp = snd;
-         snd = (SndFx*)snd->getNext();
-         removeSoundEffect(tmp);
+         Kobold::Log::add("Sound::reopenDevice: couldn't restore effect");
       }
-      else
+      else if(snd->getStartTime() >= 0.0)
       {
-         snd = (SndFx*)snd->getNext();
+         if(states[i].sourceState == AL_INITIAL)
+         {
+            /* Still waiting its start: prepare and schedule it again */
+            schedule(snd, snd->getStartTime());
+         }
+         else
+         {
+            /* Already started by the device */
+            snd->setStartTime(-1.0);
+         }
       }
+      else if(states[i].sourceState == AL_PAUSED)
+      {
+         /* Paused by suspend(): to be resumed with the others */
+         pausedSources.push_back(snd->getSource());
+      }
+      snd->setNextUpdate(0);
+      snd = (SndFx*)snd->getNext();
+   }
+   if(backMusic)
+   {
+      backMusic->setNextUpdate(0);
    }
+
+   /* Their sources changed */
+   retrackStreams();
+
+   return true;
 }
 
 /*************************************************************************
- *                            addSoundEffect                             *
+ *                             resumeStreams                             *
  *************************************************************************/
-SndFx* Sound::addSoundEffect(ALfloat x, ALfloat y, ALfloat z, int loop,
-      const Kobold::String& fileName, Kobold::FileReader* fileReader)
+void Sound::resumeStreams()
 {
-   SndFx* snd = NULL;
+   SndFx* snd;
+   int i, total;
 
-   if(enabled)
+   if(backMusic)
    {
-      /* Create it */
-      snd = new SndFx(x,y,z,loop, fileName, fileReader);
-      snd->changeVolume(sndfxVolume);
-
-      /* Insert on the list */
-      sndList.insert(snd);
+      backMusic->resume();
+      setDeadline(backMusic, 0);
+   }
+   total = sndList.getTotal();
+   snd = (SndFx*)sndList.getFirst();
+   for(i = 0; i < total; i++)
+   {
+      snd->resume();
+      setDeadline(snd, 0);
+      snd = (SndFx*)snd->getNext();
    }
-
-   return snd;
 }
 
 /*************************************************************************
- *                            addSoundEffect                             *
+ *                              checkDevice                              *
  *************************************************************************/
-SndFx* Sound::addSoundEffect(int loop, const Kobold::String& fileName, 
-      Kobold::FileReader* fileReader)
+void Sound::checkDevice()
 {
-   SndFx* snd = NULL;
+#ifdef ALC_EXT_disconnect
+   ALCint connected = ALC_TRUE;
 
-   if(enabled)
+   if( (!deviceLost) && (OpenALExt::hasDisconnect()) )
    {
-      /* Create it */
-      snd = new SndFx(loop, fileName, fileReader);
-      snd->changeVolume(sndfxVolume);
-
-      /* Insert on the list */
-      sndList.insert(snd);
+      alcGetIntegerv(device, ALC_CONNECTED, 1, &connected);
+      if(connected == ALC_FALSE)
+      {
+         deviceLost = true;
+      }
    }
+#endif
 
-   return snd;
+   if( (deviceLost) && (autoReopen) && 
+       (flushTime - lastReopen >= KOSOUND_REOPEN_RATE) )
+   {
+      lastReopen = flushTime;
+      Kobold::Log::add("Sound: output device lost, reopening it");
+      reopenDevice(NULL);
+   }
 }
 
-
 /*************************************************************************
- *                          removeSoundEffect                            *
+ *                             isDeviceLost                              *
  *************************************************************************/
-void Sound::removeSoundEffect(SndFx* snd)
+bool Sound::isDeviceLost()
 {
-   if( (enabled) && (snd != NULL) )
-   {
-      sndList.remove(snd);
-   }
+   return deviceLost;
 }
 
 /*************************************************************************
- *                        removeAllSoundEffects                          *
+ *                             setAutoReopen                             *
  *************************************************************************/
-void Sound::removeAllSoundEffects()
+void Sound::setAutoReopen(bool enable)
 {
-   /* Clear all opened Sound Effects */
-   sndList.clearList();
+   autoReopen = enable;
 }
 
-
 /*************************************************************************
- *                              changeVolume                             *
+ *                                suspend                                *
  *************************************************************************/
-void Sound::changeVolume(int music, int sndV)
+void Sound::suspend()
 {
+   std::vector<ALuint> sources;
    SndFx* snd;
-   int i;
-   
-   if(enabled)
+   ALint state;
+   size_t i;
+   int total;
+
+   if( (!enabled) || (suspended) )
    {
-      /* Updata values */
-      musicVolume = music;
-      sndfxVolume = sndV;
-      
-      /* Update backmusic */
-      if(backMusic)
-      {
-         backMusic->changeVolume(musicVolume);
-      }
-      
-      /* Update all current Sounds */
-      snd = (SndFx*)sndList.getFirst();
-      for(i=0; i < sndList.getTotal(); i++)
+      return;
+   }
+
+   /* Gather the sources of all streams and one-shots */
+   if(backMusic)
+   {
+      sources.push_back(backMusic->getSource());
+   }
+   total = sndList.getTotal();
+   snd = (SndFx*)sndList.getFirst();
+   for(i = 0; i < (size_t)total; i++)
+   {
+      sources.push_back(snd->getSource());
+      snd = (SndFx*)snd->getNext();
+   }
+   if(voicePool)
+   {
+      voicePool->collectSources(sources);
+   }
+
+   /* Pause, at once, just the playing ones (to resume only those) */
+   pausedSources.clear();
+   for(i = 0; i < sources.size(); i++)
+   {
+      if(sources[i] != 0)
+      {
+         alGetSourcei(sources[i], AL_SOURCE_STATE, &state);
+         if(state == AL_PLAYING)
+         {
+            pausedSources.push_back(sources[i]);
+         }
+      }
+   }
+   if(!pausedSources.empty())
+   {
+      alSourcePausev((ALsizei)pausedSources.size(), &pausedSources[0]);
+   }
+
+   /* No decoding (nor its threads) while suspended */
+   total = (decodePool != NULL) ? decodePool->getTotalThreads() - 1 : 0;
+   setDecodeThreads(0);
+   BufferedReader::stopPrefetcher();
+
+   OpenALExt::pauseDevice(device);
+
+   suspended = true;
+   suspendedThreads = total;
+}
+
+/*************************************************************************
+ *                                resume                                 *
+ *************************************************************************/
+void Sound::resume()
+{
+   ALint state;
+   size_t i, total = 0;
+
+   if(!suspended)
+   {
+      return;
+   }
+   suspended = false;
+
+   OpenALExt::resumeDevice(device);
+
+   /* Only the ones still paused: some could have been removed (or 
+    * stopped) meanwhile, and a single invalid source fails the call. */
+   for(i = 0; i < pausedSources.size(); i++)
+   {
+      if(alIsSource(pausedSources[i]))
+      {
+         alGetSourcei(pausedSources[i], AL_SOURCE_STATE, &state);
+         if(state == AL_PAUSED)
+         {
+            pausedSources[total] = pausedSources[i];
+            total++;
+         }
+      }
+   }
+   if(total > 0)
+   {
+      alSourcePlayv((ALsizei)total, &pausedSources[0]);
+   }
+   pausedSources.clear();
+
+   if(suspendedThreads > 0)
+   {
+      setDecodeThreads(suspendedThreads);
+   }
+   suspendedThreads = 0;
+}
+
+/*************************************************************************
+ *                              isSuspended                              *
+ *************************************************************************/
+bool Sound::isSuspended()
+{
+   return suspended;
+}
+
+/*************************************************************************
+ *                          setListenerPosition                          *
+ *************************************************************************/
+void Sound::setListenerPosition(ALfloat centerX, ALfloat centerY, 
+                                ALfloat centerZ, ALfloat phi, ALfloat theta,
+                                ALfloat d)
+{
+   if(enabled)
+   {
+      float posX, posY, posZ;   /* Listener Position */
+      ALfloat directionvect[6]; /* Direction Vector of Listener */
+      
+      	
+      alListener3f(AL_POSITION, centerX, centerY, centerZ);
+      listenerX = centerX;
+      listenerY = centerY;
+      listenerZ = centerZ;
+
+      /* Check the emitters in range again, if moved enough */
+      if( (fabsf(listenerX - cullX) > KOSOUND_EMITTER_CULL_DISTANCE) ||
+          (fabsf(listenerY - cullY) > KOSOUND_EMITTER_CULL_DISTANCE) ||
+          (fabsf(listenerZ - cullZ) > KOSOUND_EMITTER_CULL_DISTANCE) )
+      {
+         emittersChanged = true;
+      }
+
+      float thetaR = deg2Rad(theta);
+      float phiR = deg2Rad(phi);
+
+      float cosTheta = cos(thetaR);
+      float sinTheta = sin(thetaR);
+      
+      float cosPhi = cos(phiR);
+      float sinPhi = sin(phiR);
+      
+      posX = centerX + d * cosTheta * sinPhi;
+      posY = centerY + d * sinTheta;
+      posZ	= centerZ + d * cosTheta * cosPhi;
+      
+      directionvect[0] = centerX - posX;
+      directionvect[1] = centerY - posY;
+      directionvect[2] = centerZ - posZ;
+      directionvect[3] = 0;
+      directionvect[4] = 1;
+      directionvect[5] = 0;
+      alListenerfv(AL_ORIENTATION, directionvect);
+   }
+}
+
+/*************************************************************************
+ *                              loadMusic                                *
+ *************************************************************************/
+bool Sound::loadMusic(const Kobold::String& fileName, 
+      Kobold::FileReader* fileReader)
+{
+   if(opening)
+   {
+      /* Play it once the device is ready */
+      return postMusic(fileName, fileReader);
+   }
+
+   if(!enabled)
+   {
+      return false;
+   }
+      
+   if(backMusic)
+   {
+      /* Delete Active Music, if one is */
+      delete(backMusic);
+      backMusic = NULL;
+   }
+
+   /* Load The File and Set The active Music */
+   backMusic = new SndFx(0, fileName, fileReader);
+   backMusic->setBus(musicBus);
+
+   backMusic->setLoop(SOUND_AUTO_LOOP);
+   backMusic->defineAsMusic();
+   
+   return true;
+}
+
+/*************************************************************************
+ *                                flush                                  *
+ *************************************************************************/
+void Sound::flush()
+{
+   KOSOUND_PROFILE_ZONE("Sound::flush");
+
+   if(opening)
+   {
+      if(!deviceOpened)
+      {
+         /* Keep the requests queued until the device is ready */
+         return;
+      }
+      finishAsyncInit();
+   }
+
+   if( (!enabled) || (suspended) )
+   {
+      return;
+   }
+
+   /* Report AL errors raised since the last flush (if checking so) */
+   KOSOUND_AL_CHECK_FLUSH();
+
+   /* And log the errors of the streams (maybe at decode threads) */
+   StreamLog::drain();
+
+   /* Commands posted by any thread are executed as soon as possible */
+   processCommands();
+
+   /* Start the scheduled sounds whose time is near */
+   startScheduled();
+
+   /* Apply changed bus gains to their affected sources */
+   if( (masterBus != NULL) && (masterBus->needsUpdate()) )
+   {
+      masterBus->update();
+      if(voicePool)
+      {
+         voicePool->applyBusGains();
+      }
+   }
+
+   /* Each stream has its own update time: no global rate */
+   flushTime = timer.getMilliseconds();
+
+   /* Check the device and get back the voices of ended one-shots (and
+    * the emitters of ended effects) */
+   if(flushTime - lastReclaim >= KOSOUND_RECLAIM_RATE)
+   {
+      lastReclaim = flushTime;
+      checkDevice();
+      if(!enabled)
+      {
+         /* Lost for good */
+         return;
+      }
+      if(voicePool)
+      {
+         voicePool->reclaim();
+      }
+      if(!activeEmitters.empty())
+      {
+         emittersChanged = true;
+      }
+   }
+
+   /* Create (or release) the emitters entering (or leaving) range */
+   updateEmitters();
+
+   /* Know which streams need a refill */
+   processEvents();
+
+   /* Music and sound effects update */
+   updateStreams();
+}
+
+/*************************************************************************
+ *                        kosound_job_stream_less                        *
+ *************************************************************************/
+static bool kosound_job_stream_less(const DecodeJob& a, const DecodeJob& b)
+{
+   return a.sndFx < b.sndFx;
+}
+
+/*************************************************************************
+ *                        kosound_job_same_stream                        *
+ *************************************************************************/
+static bool kosound_job_same_stream(const DecodeJob& a, const DecodeJob& b)
+{
+   return a.sndFx == b.sndFx;
+}
+
+/*************************************************************************
+ *                          kosound_find_tracked                         *
+ *************************************************************************/
+static std::vector<StreamSource>::iterator kosound_find_tracked(
+      std::vector<StreamSource>& tracked, ALuint source, SndFx* snd)
+{
+   std::vector<StreamSource>::iterator it;
+   StreamSource entry;
+
+   entry.source = source;
+   entry.sndFx = snd;
+   it = std::lower_bound(tracked.begin(), tracked.end(), entry);
+   while( (it != tracked.end()) && (it->source == source) )
+   {
+      if(it->sndFx == snd)
+      {
+         return it;
+      }
+      ++it;
+   }
+
+   return tracked.end();
+}
+
+/*************************************************************************
+ *                             updateStreams                             *
+ *************************************************************************/
+void Sound::updateStreams()
+{
+   DecodeBudget budget;
+   DecodeJob job;
+   StreamDeadline due;
+   SndFx* snd;
+   size_t i, deferred = 0;
+   int total;
+   bool over;
+
+   /* Define the jobs */
+   decodeJobs.clear();
+   job.result = true;
+   job.deferred = false;
+   if(backMusic)
+   {
+      addJob(job, backMusic);
+   }
+   if(pollAll)
+   {
+      /* Events were lost: check every stream */
+      total = sndList.getTotal();
+      snd = (SndFx*)sndList.getFirst();
+      for(i = 0; i < (size_t)total; i++)
+      {
+         addJob(job, snd);
+         snd = (SndFx*)snd->getNext();
+      }
+   }
+   else
+   {
+      /* Only the ones told by an AL event... */
+      for(i = 0; i < eventSources.size(); i++)
+      {
+         addJob(job, findStream(eventSources[i]));
+      }
+   }
+
+   /* ...or at their deadline (just dropped when all were checked) */
+   while( (!deadlines.empty()) && (deadlines.front().time <= flushTime) )
+   {
+      due = deadlines.front();
+      std::pop_heap(deadlines.begin(), deadlines.end());
+      deadlines.pop_back();
+
+      /* Only if its stream still exists (so safe to use), and is due */
+      if( (!pollAll) && (kosound_find_tracked(streamSources, due.source,
+                  due.sndFx) != streamSources.end()) &&
+          (due.sndFx->getNextUpdate() <= flushTime) )
+      {
+         addJob(job, due.sndFx);
+      }
+   }
+   if(decodeJobs.empty())
+   {
+      return;
+   }
+
+   /* A stream could be got by more than an event or deadline */
+   std::sort(decodeJobs.begin(), decodeJobs.end(), kosound_job_stream_less);
+   decodeJobs.erase(std::unique(decodeJobs.begin(), decodeJobs.end(),
+            kosound_job_same_stream), decodeJobs.end());
+
+   /* Most urgent first */
+   std::sort(decodeJobs.begin(), decodeJobs.end());
+
+   /* Streams with less than two refill margins queued can't wait */
+   budget.start(decodeBudget, (2 * refillMargin) / 1000.0);
+   if(decodePool != NULL)
+   {
+      decodePool->run(decodeJobs, budget);
+   }
+   else
+   {
+      for(i = 0; i < decodeJobs.size(); i++)
+      {
+         if(budget.allows(decodeJobs[i]))
+         {
+            decodeJobs[i].result = decodeJobs[i].sndFx->update();
+         }
+         else
+         {
+            decodeJobs[i].deferred = true;
+         }
+      }
+   }
+   over = budget.isOver();
+
+   /* Remove the ended ones */
+   for(i = 0; i < decodeJobs.size(); i++)
+   {
+      snd = decodeJobs[i].sndFx;
+      if(decodeJobs[i].deferred)
+      {
+         /* Out of budget: carried over to the next flush */
+         setDeadline(snd, flushTime);
+         deferred++;
+         continue;
+      }
+      if(decodeJobs[i].result)
+      {
+         scheduleUpdate(snd, true);
+         continue;
+      }
+      if(snd == backMusic)
+      {
+         Kobold::Log::add("Sound::flush: Error while playing music");
+         delete backMusic;
+         backMusic = NULL;
+      }
+      else if(snd->getRemoval())
+      {
+         removeSoundEffect(snd);
+      }
+      else
+      {
+         scheduleUpdate(snd, false);
+      }
+   }
+
+   if(decodeBudget > 0)
+   {
+      budgetStats.flushes++;
+      if(over)
+      {
+         budgetStats.overruns++;
+      }
+      if(deferred > 0)
+      {
+         budgetStats.deferrals++;
+         budgetStats.deferredJobs += deferred;
+      }
+   }
+}
+
+/*************************************************************************
+ *                             enableEvents                              *
+ *************************************************************************/
+void Sound::enableEvents(bool enable)
+{
+   ALuint source;
+#ifdef AL_SOFT_events
+   ALenum types[3] = {AL_EVENT_TYPE_BUFFER_COMPLETED_SOFT, 
+                      AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT,
+                      AL_EVENT_TYPE_DISCONNECTED_SOFT};
+#endif
+
+   eventDriven = false;
+
+#ifdef AL_SOFT_events
+   if(OpenALExt::hasEvents())
+   {
+      if(enable)
+      {
+         OpenALExt::alEventCallback(&Sound::onEvent, NULL);
+         OpenALExt::alEventControl(3, types, AL_TRUE);
+         eventDriven = true;
+      }
+      else
+      {
+         OpenALExt::alEventControl(3, types, AL_FALSE);
+         OpenALExt::alEventCallback(NULL, NULL);
+      }
+   }
+#endif
+
+   /* Events could be missed while switching: discard the pending ones
+    * and poll all streams once. */
+   while(events.pop(source))
+   {
+   }
+   eventsOverflow = true;
+}
+
+/*************************************************************************
+ *                            setEventDriven                             *
+ *************************************************************************/
+void Sound::setEventDriven(bool enable)
+{
+   useEvents = enable;
+   if(enabled)
+   {
+      enableEvents(enable);
+   }
+}
+
+/*************************************************************************
+ *                             isEventDriven                             *
+ *************************************************************************/
+bool Sound::isEventDriven()
+{
+   return eventDriven;
+}
+
+/*************************************************************************
+ *                                onEvent                                *
+ *************************************************************************/
+void AL_APIENTRY Sound::onEvent(ALenum eventType, ALuint object, 
+      ALuint param, ALsizei length, const ALchar* message, void* userParam)
+{
+#ifdef AL_SOFT_events
+   if( (eventType == AL_EVENT_TYPE_BUFFER_COMPLETED_SOFT) ||
+       (eventType == AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT) )
+   {
+      /* Never block the mixer: if full, just poll all at next flush */
+      if(!events.push(object))
+      {
+         eventsOverflow = true;
+      }
+   }
+   else if(eventType == AL_EVENT_TYPE_DISCONNECTED_SOFT)
+   {
+      /* Reopened at next flush (see checkDevice) */
+      deviceLost = true;
+   }
+#endif
+}
+
+/*************************************************************************
+ *                             processEvents                             *
+ *************************************************************************/
+void Sound::processEvents()
+{
+   ALuint source;
+
+   eventSources.clear();
+   pollAll = eventsOverflow.exchange(false);
+   if(!eventDriven)
+   {
+      /* Polling fallback: just by the deadlines */
+      return;
+   }
+
+   while(events.pop(source))
+   {
+      eventSources.push_back(source);
+   }
+   std::sort(eventSources.begin(), eventSources.end());
+}
+
+/*************************************************************************
+ *                              needsUpdate                              *
+ *************************************************************************/
+bool Sound::needsUpdate(SndFx* snd)
+{
+   if( (snd->getStartTime() >= 0.0) && (!OpenALExt::hasStartAtTime()) )
+   {
+      /* Waiting for its scheduled start, by a flush */
+      return false;
+   }
+
+   /* At its deadline (the only way when polling, and a safety net for
+    * missed events or waiting to loop, when event driven) or told by 
+    * an AL event */
+   return (pollAll) || (flushTime >= snd->getNextUpdate()) ||
+          (std::binary_search(eventSources.begin(), eventSources.end(),
+                              snd->getSource()));
+}
+
+/*************************************************************************
+ *                                addJob                                 *
+ *************************************************************************/
+void Sound::addJob(DecodeJob& job, SndFx* snd)
+{
+   if( (snd != NULL) && (needsUpdate(snd)) )
+   {
+      job.sndFx = snd;
+      job.urgency = snd->getQueuedTime();
+      decodeJobs.push_back(job);
+   }
+}
+
+/*************************************************************************
+ *                            scheduleUpdate                             *
+ *************************************************************************/
+void Sound::scheduleUpdate(SndFx* snd, bool active)
+{
+   double delay;
+
+   if(active)
+   {
+      delay = snd->getRefillDelay(refillMargin / 1000.0);
+      setDeadline(snd, flushTime + (unsigned long)(delay * 1000.0));
+   }
+   else
+   {
+      /* Ended (but kept): just check now and then */
+      setDeadline(snd, flushTime + KOSOUND_IDLE_UPDATE_RATE);
+   }
+}
+
+/*************************************************************************
+ *                              setDeadline                              *
+ *************************************************************************/
+void Sound::setDeadline(SndFx* snd, unsigned long time)
+{
+   StreamDeadline deadline;
+
+   snd->setNextUpdate(time);
+   if(snd == backMusic)
+   {
+      /* Always checked */
+      return;
+   }
+
+   /* The previous one is left outdated (see updateStreams). Note that
+    * a SndFx::rewind or seek only zeroes its nextUpdate: it's then got
+    * at its pending deadline, but its queue was just refilled anyway. */
+   deadline.time = time;
+   deadline.source = snd->getSource();
+   deadline.sndFx = snd;
+   deadlines.push_back(deadline);
+   std::push_heap(deadlines.begin(), deadlines.end());
+}
+
+/*************************************************************************
+ *                              trackStream                              *
+ *************************************************************************/
+void Sound::trackStream(SndFx* snd)
+{
+   StreamSource entry;
+
+   entry.source = snd->getSource();
+   entry.sndFx = snd;
+   streamSources.insert(std::upper_bound(streamSources.begin(),
+            streamSources.end(), entry), entry);
+
+   setDeadline(snd, snd->getNextUpdate());
+}
+
+/*************************************************************************
+ *                             untrackStream                             *
+ *************************************************************************/
+void Sound::untrackStream(SndFx* snd)
+{
+   std::vector<StreamSource>::iterator it;
+
+   /* Its deadlines are left outdated */
+   it = kosound_find_tracked(streamSources, snd->getSource(), snd);
+   if(it != streamSources.end())
+   {
+      streamSources.erase(it);
+   }
+}
+
+/*************************************************************************
+ *                            retrackStreams                             *
+ *************************************************************************/
+void Sound::retrackStreams()
+{
+   StreamSource entry;
+   SndFx* snd;
+   int i, total;
+
+   streamSources.clear();
+   deadlines.clear();
+
+   total = sndList.getTotal();
+   snd = (SndFx*)sndList.getFirst();
+   for(i = 0; i < total; i++)
+   {
+      entry.source = snd->getSource();
+      entry.sndFx = snd;
+      streamSources.push_back(entry);
+      setDeadline(snd, snd->getNextUpdate());
+      snd = (SndFx*)snd->getNext();
+   }
+   std::sort(streamSources.begin(), streamSources.end());
+}
+
+/*************************************************************************
+ *                              findStream                               *
+ *************************************************************************/
+SndFx* Sound::findStream(ALuint source)
+{
+   std::vector<StreamSource>::iterator it;
+   StreamSource entry;
+
+   entry.source = source;
+   entry.sndFx = NULL;
+   it = std::lower_bound(streamSources.begin(), streamSources.end(), 
+         entry);
+   if( (it != streamSources.end()) && (it->source == source) )
+   {
+      return it->sndFx;
+   }
+
+   return NULL;
+}
+
+/*************************************************************************
+ *                            setRefillMargin                            *
+ *************************************************************************/
+void Sound::setRefillMargin(unsigned long milliseconds)
+{
+   refillMargin = milliseconds;
+}
+
+/*************************************************************************
+ *                           setDecodeThreads                            *
+ *************************************************************************/
+void Sound::setDecodeThreads(int threads)
+{
+   if(suspended)
+   {
+      /* Just to be created at resume */
+      suspendedThreads = threads;
+      return;
+   }
+   if(decodePool != NULL)
+   {
+      delete decodePool;
+      decodePool = NULL;
+   }
+   if(threads > 0)
+   {
+      decodePool = new DecodePool(threads);
+   }
+}
+
+/*************************************************************************
+ *                            setDecodeBudget                            *
+ *************************************************************************/
+void Sound::setDecodeBudget(unsigned long microseconds)
+{
+   decodeBudget = microseconds;
+}
+
+/*************************************************************************
+ *                         getDecodeBudgetStats                          *
+ *************************************************************************/
+const DecodeBudgetStats& Sound::getDecodeBudgetStats()
+{
+   return budgetStats;
+}
+
+/*************************************************************************
+ *                        resetDecodeBudgetStats                         *
+ *************************************************************************/
+void Sound::resetDecodeBudgetStats()
+{
+   budgetStats.flushes = 0;
+   budgetStats.overruns = 0;
+   budgetStats.deferrals = 0;
+   budgetStats.deferredJobs = 0;
+}
+
+/*************************************************************************
+ *                             setReadAhead                              *
+ *************************************************************************/
+void Sound::setReadAhead(size_t chunkSize, bool asyncPrefetch)
+{
+   BufferedReader::setDefaults(chunkSize, asyncPrefetch);
+}
+
+/*************************************************************************
+ *                            addSoundEffect                             *
+ *************************************************************************/
+SndFx* Sound::addSoundEffect(ALfloat x, ALfloat y, ALfloat z, int loop,
+      const Kobold::String& fileName, Kobold::FileReader* fileReader)
+{
+   if(opening)
+   {
+      /* Play it once the device is ready */
+      postSoundEffect(x, y, z, loop, fileName, fileReader);
+      return NULL;
+   }
+
+   return createSoundEffect(true, x, y, z, loop, fileName, fileReader, 
+         true);
+}
+
+/*************************************************************************
+ *                            addSoundEffect                             *
+ *************************************************************************/
+SndFx* Sound::addSoundEffect(int loop, const Kobold::String& fileName, 
+      Kobold::FileReader* fileReader)
+{
+   if(opening)
+   {
+      /* Play it once the device is ready */
+      postSoundEffect(loop, fileName, fileReader);
+      return NULL;
+   }
+
+   return createSoundEffect(false, 0.0f, 0.0f, 0.0f, loop, fileName, 
+         fileReader, true);
+}
+
+/*************************************************************************
+ *                            addSoundEffect                             *
+ *************************************************************************/
+SndFx* Sound::addSoundEffect(SoundAssetId assetId, ALfloat x, ALfloat y,
+      ALfloat z, int loop)
+{
+   return createAssetEffect(true, assetId, x, y, z, loop);
+}
+
+/*************************************************************************
+ *                            addSoundEffect                             *
+ *************************************************************************/
+SndFx* Sound::addSoundEffect(SoundAssetId assetId, int loop)
+{
+   return createAssetEffect(false, assetId, 0.0f, 0.0f, 0.0f, loop);
+}
+
+/*************************************************************************
+ *                           createSoundEffect                           *
+ *************************************************************************/
+SndFx* Sound::createSoundEffect(bool positional, ALfloat x, ALfloat y, 
+      ALfloat z, int loop, const Kobold::String& fileName, 
+      Kobold::FileReader* fileReader, bool play)
+{
+   SndFx* snd = NULL;
+   SoundPolicy* policy;
+
+   if(enabled)
+   {
+      /* Check its limits before opening anything */
+      policy = getPolicy(fileName);
+      if(!admit(policy, positional, x, y, z, sfxBus->getEffectiveGain()))
+      {
+         delete fileReader;
+         return NULL;
+      }
+
+      /* Create it */
+      if(positional)
+      {
+         snd = new SndFx(x, y, z, loop, fileName, fileReader, play, 
+               downmixPositional);
+      }
+      else
+      {
+         snd = new SndFx(loop, fileName, fileReader, play);
+      }
+      snd->setBus(sfxBus);
+      if(policy != NULL)
+      {
+         snd->setPolicy(policy, policy->addInstance());
+      }
+
+      /* Insert on the list */
+      sndList.insert(snd);
+      trackStream(snd);
+   }
+
+   return snd;
+}
+
+/*************************************************************************
+ *                           createAssetEffect                           *
+ *************************************************************************/
+SndFx* Sound::createAssetEffect(bool positional, SoundAssetId assetId,
+      ALfloat x, ALfloat y, ALfloat z, int loop)
+{
+   SoundAsset* asset = getAsset(assetId);
+   SndFx* snd;
+   SoundPolicy* policy;
+
+   if( (!enabled) || (asset == NULL) || (!asset->hasPcm()) )
+   {
+      return NULL;
+   }
+
+   /* Check its limits before anything */
+   policy = asset->getPolicy();
+   if(!admit(policy, positional, x, y, z, 
+            asset->getBus()->getEffectiveGain()))
+   {
+      return NULL;
+   }
+
+   /* Recycle an idle one, only creating it when none */
+   snd = asset->takeIdleEffect();
+   if(snd == NULL)
+   {
+      snd = new SndFx(asset);
+   }
+   if(!snd->replay(positional, x, y, z, loop))
+   {
+      Kobold::Log::add(Kobold::String("Couldn't play sound effect: ") +
+            asset->getFileName());
+      delete snd;
+      return NULL;
+   }
+   snd->setBus(asset->getBus());
+   if(policy != NULL)
+   {
+      snd->setPolicy(policy, policy->addInstance());
+   }
+
+   /* Insert on the list */
+   sndList.insert(snd);
+   trackStream(snd);
+
+   return snd;
+}
+
+/*************************************************************************
+ *                               setDownmix                              *
+ *************************************************************************/
+void Sound::setDownmix(bool enable)
+{
+   downmixPositional = enable;
+}
+
+/*************************************************************************
+ *                           setAssetEncoding                            *
+ *************************************************************************/
+void Sound::setAssetEncoding(SoundAsset::Encoding encoding)
+{
+   assetEncoding = encoding;
+}
+
+/*************************************************************************
+ *                             getAudioTime                              *
+ *************************************************************************/
+double Sound::getAudioTime()
+{
+#ifdef ALC_SOFT_device_clock
+   ALCint64SOFT clock = 0;
+
+   if( (enabled) && (OpenALExt::hasDeviceClock()) )
+   {
+      OpenALExt::alcGetInteger64v(device, ALC_DEVICE_CLOCK_SOFT, 1, &clock);
+      return clock / 1000000000.0 + clockOffset;
+   }
+#endif
+   return timer.getMilliseconds() / 1000.0 + clockOffset;
+}
+
+/*************************************************************************
+ *                          scheduleSoundEffect                          *
+ *************************************************************************/
+SndFx* Sound::scheduleSoundEffect(double time, ALfloat x, ALfloat y, 
+      ALfloat z, int loop, const Kobold::String& fileName, 
+      Kobold::FileReader* fileReader)
+{
+   SndFx* snd = createSoundEffect(true, x, y, z, loop, fileName, 
+         fileReader, false);
+   schedule(snd, time);
+   return snd;
+}
+
+/*************************************************************************
+ *                          scheduleSoundEffect                          *
+ *************************************************************************/
+SndFx* Sound::scheduleSoundEffect(double time, int loop, 
+      const Kobold::String& fileName, Kobold::FileReader* fileReader)
+{
+   SndFx* snd = createSoundEffect(false, 0.0f, 0.0f, 0.0f, loop, fileName,
+         fileReader, false);
+   schedule(snd, time);
+   return snd;
+}
+
+/*************************************************************************
+ *                               schedule                                *
+ *************************************************************************/
+void Sound::schedule(SndFx* snd, double time)
+{
+#ifdef AL_SOFT_source_start_delay
+   double deviceTime;
+#endif
+
+   if(snd == NULL)
+   {
+      return;
+   }
+
+   /* Decode ahead, so its start costs nothing */
+   if(!snd->prepare())
+   {
+      snd->setStartTime(-1.0);
+      return;
+   }
+
+   /* Kept even when started by the device, to schedule it again if the
+    * device is reopened before its start */
+   snd->setStartTime(time);
+
+#ifdef AL_SOFT_source_start_delay
+   if(OpenALExt::hasStartAtTime())
+   {
+      /* The device itself starts it, exactly at that clock time */
+      deviceTime = time - clockOffset;
+      snd->enqueue(0.0);
+      OpenALExt::alSourcePlayAtTime(snd->getSource(), 
+            (ALint64SOFT)(((deviceTime > 0.0) ? deviceTime : 0.0) *
+                          1000000000.0));
+      return;
+   }
+#endif
+
+   /* Started by a flush just before it */
+   scheduled.push_back(snd);
+}
+
+/*************************************************************************
+ *                            startScheduled                             *
+ *************************************************************************/
+void Sound::startScheduled()
+{
+   size_t i = 0;
+   double now, delay;
+   SndFx* snd;
+
+   if(scheduled.empty())
+   {
+      return;
+   }
+
+   now = getAudioTime();
+   while(i < scheduled.size())
+   {
+      snd = scheduled[i];
+      delay = snd->getStartTime() - now;
+      if(delay > KOSOUND_SCHEDULE_LEAD)
+      {
+         /* Not yet */
+         i++;
+         continue;
+      }
+
+      /* Start now, but after silence covering the time remaining */
+      snd->enqueue(delay);
+      snd->start();
+      snd->setStartTime(-1.0);
+      setDeadline(snd, 0);
+
+      scheduled[i] = scheduled.back();
+      scheduled.pop_back();
+   }
+}
+
+
+/*************************************************************************
+ *                          kosound_handle_less                          *
+ *************************************************************************/
+static bool kosound_handle_less(SndFx* snd, SoundHandle handle)
+{
+   return snd->getHandle() < handle;
+}
+
+/*************************************************************************
+ *                          removeSoundEffect                            *
+ *************************************************************************/
+void Sound::removeSoundEffect(SndFx* snd)
+{
+   std::vector<SndFx*>::iterator it;
+
+   if( (enabled) && (snd != NULL) )
+   {
+      if(snd->getStartTime() >= 0.0)
+      {
+         /* Was still waiting to start */
+         it = std::find(scheduled.begin(), scheduled.end(), snd);
+         if(it != scheduled.end())
+         {
+            scheduled.erase(it);
+         }
+      }
+      if(snd->getHandle() != SOUND_INVALID_HANDLE)
+      {
+         it = std::lower_bound(handles.begin(), handles.end(), 
+               snd->getHandle(), kosound_handle_less);
+         if( (it != handles.end()) && (*it == snd) )
+         {
+            handles.erase(it);
+         }
+      }
+      if(snd->getEmitter() != SOUND_INVALID_EMITTER)
+      {
+         detachEmitter(snd);
+      }
+      untrackStream(snd);
+      if(snd->getAsset() != NULL)
+      {
+         /* Kept stopped by its asset, to be played again */
+         sndList.removeWithoutDelete(snd);
+         snd->recycle();
+         snd->getAsset()->putIdleEffect(snd);
+      }
+      else
+      {
+         sndList.remove(snd);
+      }
+   }
+}
+
+/*************************************************************************
+ *                        removeAllSoundEffects                          *
+ *************************************************************************/
+void Sound::removeAllSoundEffects()
+{
+   /* Emitters are kept, just virtual */
+   while(!activeEmitters.empty())
+   {
+      detachEmitter(emitters[activeEmitters.back() - 1].sndFx);
+   }
+
+   /* Clear all opened Sound Effects */
+   sndList.clearList();
+   handles.clear();
+   scheduled.clear();
+   streamSources.clear();
+   deadlines.clear();
+}
+
+/*************************************************************************
+ *                              addEmitter                               *
+ *************************************************************************/
+EmitterId Sound::addEmitter(ALfloat x, ALfloat y, ALfloat z, int loop,
+      const Kobold::String& fileName, Kobold::FileReader* fileReader,
+      ALfloat range)
+{
+   SoundEmitter emitter;
+   EmitterId id;
+
+   emitter.loop = loop;
+   emitter.innerAngle = 360.0f;
+   emitter.outerAngle = 360.0f;
+   emitter.fileName = fileName;
+   emitter.fileReader = fileReader;
+   emitter.sndFx = NULL;
+   emitter.time = -1.0;
+   emitter.virtualSince = 0;
+   emitter.used = true;
+   emitter.done = false;
+   emitter.selected = false;
+
+   if(!freeEmitters.empty())
+   {
+      id = freeEmitters.back();
+      freeEmitters.pop_back();
+      emitters[id - 1] = emitter;
+   }
+   else
+   {
+      emitters.push_back(emitter);
+      id = (EmitterId)emitters.size();
+      emitterParams.resize(emitters.size());
+   }
+
+   /* As the SndFx will be created */
+   emitterParams.set(id - 1, x, y, z, 1.0f, 160.0f, 1.0f, range);
+   emitterParams.setCone(id - 1, 0.0f, 0.0f, 0.0f, 360.0f, 360.0f, 0.0f);
+
+   emitterGrid.insert(id, x, y, z);
+   if(range > maxEmitterRange)
+   {
+      maxEmitterRange = range;
+   }
+   emittersChanged = true;
+
+   return id;
+}
+
+/*************************************************************************
+ *                              getEmitter                               *
+ *************************************************************************/
+SoundEmitter* Sound::getEmitter(EmitterId id)
+{
+   if( (id == SOUND_INVALID_EMITTER) || (id > emitters.size()) ||
+       (!emitters[id - 1].used) )
+   {
+      return NULL;
+   }
+   return &emitters[id - 1];
+}
+
+/*************************************************************************
+ *                              moveEmitter                              *
+ *************************************************************************/
+void Sound::moveEmitter(EmitterId id, ALfloat x, ALfloat y, ALfloat z)
+{
+   SoundEmitter* emitter = getEmitter(id);
+
+   if(emitter == NULL)
+   {
+      return;
+   }
+
+   emitterGrid.move(id, emitterParams.x[id - 1], emitterParams.y[id - 1],
+         emitterParams.z[id - 1], x, y, z);
+   emitterParams.setPosition(id - 1, x, y, z);
+   if(emitter->sndFx != NULL)
+   {
+      emitter->sndFx->redefinePosition(x, y, z);
+   }
+   emittersChanged = true;
+}
+
+/*************************************************************************
+ *                            setEmitterGain                             *
+ *************************************************************************/
+void Sound::setEmitterGain(EmitterId id, ALfloat gain)
+{
+   SoundEmitter* emitter = getEmitter(id);
+
+   if(emitter == NULL)
+   {
+      return;
+   }
+
+   emitterParams.gain[id - 1] = gain;
+   if(emitter->sndFx != NULL)
+   {
+      emitter->sndFx->changeVolume((int)(gain * 128));
+   }
+   emittersChanged = true;
+}
+
+/*************************************************************************
+ *                            setEmitterCone                             *
+ *************************************************************************/
+void Sound::setEmitterCone(EmitterId id, ALfloat dirX, ALfloat dirY, 
+      ALfloat dirZ, ALfloat innerAngle, ALfloat outerAngle)
+{
+   SoundEmitter* emitter = getEmitter(id);
+
+   if(emitter == NULL)
+   {
+      return;
+   }
+
+   /* The SndFx keeps the AL default outer gain (0) */
+   emitterParams.setCone(id - 1, dirX, dirY, dirZ, innerAngle, 
+         outerAngle, 0.0f);
+   emitter->innerAngle = innerAngle;
+   emitter->outerAngle = outerAngle;
+   if(emitter->sndFx != NULL)
+   {
+      emitter->sndFx->setDirectionCone(dirX, dirY, dirZ, 
+            innerAngle, outerAngle);
+   }
+   emittersChanged = true;
+}
+
+/*************************************************************************
+ *                             removeEmitter                             *
+ *************************************************************************/
+void Sound::removeEmitter(EmitterId id)
+{
+   SoundEmitter* emitter = getEmitter(id);
+
+   if(emitter == NULL)
+   {
+      return;
+   }
+
+   if(emitter->sndFx != NULL)
+   {
+      removeSoundEffect(emitter->sndFx);
+   }
+   emitterGrid.remove(id, emitterParams.x[id - 1], emitterParams.y[id - 1],
+         emitterParams.z[id - 1]);
+   delete emitter->fileReader;
+   emitter->fileReader = NULL;
+   emitter->fileName.clear();
+   emitter->used = false;
+   freeEmitters.push_back(id);
+}
+
+/*************************************************************************
+ *                           removeAllEmitters                           *
+ *************************************************************************/
+void Sound::removeAllEmitters()
+{
+   size_t i;
+
+   for(i = 0; i < emitters.size(); i++)
+   {
+      removeEmitter((EmitterId)(i + 1));
+   }
+   emitters.clear();
+   emitterParams.resize(0);
+   freeEmitters.clear();
+   activeEmitters.clear();
+   emitterGrid.clear();
+   maxEmitterRange = 0.0f;
+}
+
+/*************************************************************************
+ *                         getEmitterSoundEffect                         *
+ *************************************************************************/
+SndFx* Sound::getEmitterSoundEffect(EmitterId id)
+{
+   SoundEmitter* emitter = getEmitter(id);
+   return (emitter != NULL) ? emitter->sndFx : NULL;
+}
+
+/*************************************************************************
+ *                          setEmitterCellSize                           *
+ *************************************************************************/
+void Sound::setEmitterCellSize(ALfloat size)
+{
+   size_t i;
+
+   if(size <= 0.0f)
+   {
+      return;
+   }
+
+   /* Insert all again, at the new cells */
+   emitterGrid.clear();
+   emitterGrid.setCellSize(size);
+   for(i = 0; i < emitters.size(); i++)
+   {
+      if(emitters[i].used)
+      {
+         emitterGrid.insert((EmitterId)(i + 1), emitterParams.x[i], 
+               emitterParams.y[i], emitterParams.z[i]);
+      }
+   }
+}
+
+/*************************************************************************
+ *                           setEmitterVoices                            *
+ *************************************************************************/
+void Sound::setEmitterVoices(int voices)
+{
+   emitterVoices = voices;
+   emittersChanged = true;
+}
+
+/*************************************************************************
+ *                            updateEmitters                             *
+ *************************************************************************/
+void Sound::updateEmitters()
+{
+   SoundEmitter* emitter;
+   EmitterScore candidate;
+   EmitterId id;
+   size_t i, total;
+
+   if(!emittersChanged)
+   {
+      return;
+   }
+   emittersChanged = false;
+   cullX = listenerX;
+   cullY = listenerY;
+   cullZ = listenerZ;
+
+   /* Gather the emitters near enough to be heard (the ones created are
+    * only released past their range with hysteresis) */
+   emitterGrid.query(listenerX, listenerY, listenerZ, 
+         maxEmitterRange * KOSOUND_EMITTER_HYSTERESIS, nearEmitters);
+   total = nearEmitters.size();
+   nearParams.resize(total);
+   nearScores.resize(total);
+   for(i = 0; i < total; i++)
+   {
+      id = nearEmitters[i];
+      nearParams.copy(i, emitterParams, id - 1);
+      if(emitters[id - 1].sndFx != NULL)
+      {
+         nearParams.range[i] *= KOSOUND_EMITTER_HYSTERESIS;
+      }
+   }
+
+   /* Estimate how loud each one is, all at once */
+   if(total > 0)
+   {
+      nearParams.score(listenerX, listenerY, listenerZ, &nearScores[0]);
+   }
+
+   /* And select the loudest ones */
+   rankedEmitters.clear();
+   for(i = 0; i < total; i++)
+   {
+      if( (nearScores[i] > 0.0f) && (!emitters[nearEmitters[i] - 1].done) )
+      {
+         candidate.id = nearEmitters[i];
+         candidate.score = nearScores[i];
+         if(emitters[candidate.id - 1].sndFx != NULL)
+         {
+            candidate.score *= KOSOUND_EMITTER_KEEP_FACTOR;
+         }
+         rankedEmitters.push_back(candidate);
+      }
+   }
+   if( (emitterVoices > 0) && 
+       (rankedEmitters.size() > (size_t)emitterVoices) )
+   {
+      std::nth_element(rankedEmitters.begin(), 
+            rankedEmitters.begin() + emitterVoices, rankedEmitters.end());
+      rankedEmitters.resize(emitterVoices);
+   }
+   for(i = 0; i < rankedEmitters.size(); i++)
+   {
+      emitters[rankedEmitters[i].id - 1].selected = true;
+   }
+
+   /* Release the ones not selected (or ended, if not looping) */
+   i = 0;
+   while(i < activeEmitters.size())
+   {
+      emitter = &emitters[activeEmitters[i] - 1];
+      if( (!emitter->selected) ||
+          ( (emitter->loop < 0) && (!emitter->sndFx->isPlaying()) ) )
+      {
+         /* Also taken out of activeEmitters */
+         removeSoundEffect(emitter->sndFx);
+      }
+      else
+      {
+         i++;
+      }
+   }
+
+   /* And create the selected ones still virtual */
+   for(i = 0; i < rankedEmitters.size(); i++)
+   {
+      emitter = &emitters[rankedEmitters[i].id - 1];
+      emitter->selected = false;
+      if( (emitter->sndFx == NULL) && (!emitter->done) )
+      {
+         createEmitterSoundEffect(rankedEmitters[i].id);
+      }
+   }
+}
+
+/*************************************************************************
+ *                       createEmitterSoundEffect                        *
+ *************************************************************************/
+void Sound::createEmitterSoundEffect(EmitterId id)
+{
+   SoundEmitter& emitter = emitters[id - 1];
+   size_t index = id - 1;
+   SndFx* snd;
+   double position;
+
+   snd = createSoundEffect(true, emitterParams.x[index], 
+         emitterParams.y[index], emitterParams.z[index], emitter.loop, 
+         emitter.fileName, new EmitterReader(emitter.fileReader), true);
+   if(snd == NULL)
+   {
+      /* Rejected by its policy: try again at the next check */
+      return;
+   }
+   snd->setRemoval(false);
+   snd->setEmitter(id);
+   if(emitterParams.gain[index] != 1.0f)
+   {
+      snd->changeVolume((int)(emitterParams.gain[index] * 128));
+   }
+   if(emitterParams.coneScale[index] != 0.0f)
+   {
+      snd->setDirectionCone(emitterParams.dirX[index], 
+            emitterParams.dirY[index], emitterParams.dirZ[index],
+            emitter.innerAngle, emitter.outerAngle);
+   }
+   emitter.sndFx = snd;
+   activeEmitters.push_back(id);
+
+   if(emitter.time >= 0.0)
+   {
+      /* Continue where it would be, if never made virtual */
+      position = emitter.time + 
+         (timer.getMilliseconds() - emitter.virtualSince) / 1000.0;
+      if( (!snd->seek(position)) && (emitter.loop < 0) )
+      {
+         /* Already ended */
+         emitter.done = true;
+         removeSoundEffect(snd);
+      }
+   }
+}
+
+/*************************************************************************
+ *                             detachEmitter                             *
+ *************************************************************************/
+void Sound::detachEmitter(SndFx* snd)
+{
+   SoundEmitter* emitter = getEmitter(snd->getEmitter());
+   std::vector<EmitterId>::iterator it;
+
+   snd->setEmitter(SOUND_INVALID_EMITTER);
+   if( (emitter == NULL) || (emitter->sndFx != snd) )
+   {
+      return;
+   }
+
+   emitter->time = snd->tell();
+   emitter->virtualSince = timer.getMilliseconds();
+   emitter->sndFx = NULL;
+   if( (emitter->loop < 0) && (!snd->isPlaying()) )
+   {
+      emitter->done = true;
+   }
+
+   it = std::find(activeEmitters.begin(), activeEmitters.end(), 
+         (EmitterId)(emitter - &emitters[0] + 1));
+   if(it != activeEmitters.end())
+   {
+      *it = activeEmitters.back();
+      activeEmitters.pop_back();
+   }
+}
+
+
+/*************************************************************************
+ *                              changeVolume                             *
+ *************************************************************************/
+void Sound::changeVolume(int music, int sndV)
+{
+   if(opening)
+   {
+      postVolume(music, sndV);
+   }
+   else if(enabled)
+   {
+      /* Updata values */
+      musicVolume = music;
+      sndfxVolume = sndV;
+      
+      /* Just mark the buses: only applied at flush */
+      musicBus->setGain(musicVolume / 128.0f);
+      sfxBus->setGain(sndfxVolume / 128.0f);
+   }
+}
+
+/*************************************************************************
+ *                                getBus                                 *
+ *************************************************************************/
+SoundBus* Sound::getBus(const Kobold::String& name)
+{
+   std::map<Kobold::String, SoundBus*>::iterator it = buses.find(name);
+   if(it != buses.end())
+   {
+      return it->second;
+   }
+   return NULL;
+}
+
+/*************************************************************************
+ *                               createBus                               *
+ *************************************************************************/
+SoundBus* Sound::createBus(const Kobold::String& name, SoundBus* parent)
+{
+   SoundBus* bus;
+
+   if(getBus(name) != NULL)
+   {
+      return NULL;
+   }
+   if(parent == NULL)
+   {
+      parent = masterBus;
+   }
+
+   bus = new SoundBus(name, parent);
+   buses[name] = bus;
+
+   return bus;
+}
+
+/*************************************************************************
+ *                              setAssetBus                              *
+ *************************************************************************/
+void Sound::setAssetBus(SoundAssetId assetId, SoundBus* bus)
+{
+   SoundAsset* asset = getAsset(assetId);
+   if(asset != NULL)
+   {
+      asset->setBus(bus);
+   }
+}
+
+/*************************************************************************
+ *                             registerAsset                             *
+ *************************************************************************/
+SoundAssetId Sound::registerAsset(const Kobold::String& fileName,
+      Kobold::FileReader* fileReader, bool mono, bool keepPcm)
+{
+   SoundAsset* asset;
+   size_t i;
+
+   if(!enabled)
+   {
+      delete fileReader;
+      return SOUND_INVALID_ASSET;
+   }
+
+   for(i = 0; i < assets.size(); i++)
+   {
+      if(assets[i]->getFileName() == fileName)
+      {
+         /* Already registered */
+         delete fileReader;
+         return assets[i]->getId();
+      }
+   }
+
+   asset = new SoundAsset((SoundAssetId)(assets.size() + 1), fileName);
+   asset->setPolicy(getPolicy(fileName));
+   asset->setBus(sfxBus);
+   /* Without reopen, must keep its data to restore on a device change.
+    * Streamed as sound effects, its PCM is needed too. */
+   if(!asset->load(fileReader, (keepPcm) || (!OpenALExt::hasReopen()), 
+            mono, (keepPcm) ? SoundAsset::ENCODING_PCM16 : assetEncoding))
+   {
+      Kobold::Log::add(Kobold::LOG_LEVEL_ERROR,
+            "Sound::registerAsset(): couldn't load '%s'", fileName.c_str());
+      delete asset;
+      return SOUND_INVALID_ASSET;
+   }
+   assets.push_back(asset);
+
+   return asset->getId();
+}
+
+/*************************************************************************
+ *                               getAsset                                *
+ *************************************************************************/
+SoundAsset* Sound::getAsset(SoundAssetId assetId)
+{
+   if( (assetId == SOUND_INVALID_ASSET) || (assetId > assets.size()) )
+   {
+      return NULL;
+   }
+   return assets[assetId - 1];
+}
+
+/*************************************************************************
+ *                           kosound_bus_gain                            *
+ *************************************************************************/
+static ALfloat kosound_bus_gain(SoundBus* bus)
+{
+   return (bus != NULL) ? bus->getEffectiveGain() : 1.0f;
+}
+
+/*************************************************************************
+ *                              playOneShot                              *
+ *************************************************************************/
+OneShotHandle Sound::playOneShot(SoundAssetId assetId, 
+      ALfloat x, ALfloat y, ALfloat z, ALfloat gain)
+{
+   SoundAsset* asset = getAsset(assetId);
+
+   if( (!enabled) || (voicePool == NULL) || (asset == NULL) ||
+       (!admit(asset->getPolicy(), true, x, y, z, 
+               gain * kosound_bus_gain(asset->getBus()))) )
+   {
+      return ONE_SHOT_INVALID_HANDLE;
+   }
+   return voicePool->play(asset, true, x, y, z, gain, asset->getBus());
+}
+
+/*************************************************************************
+ *                              playOneShot                              *
+ *************************************************************************/
+OneShotHandle Sound::playOneShot(SoundAssetId assetId, ALfloat gain)
+{
+   SoundAsset* asset = getAsset(assetId);
+
+   if( (!enabled) || (voicePool == NULL) || (asset == NULL) ||
+       (!admit(asset->getPolicy(), false, 0.0f, 0.0f, 0.0f, 
+               gain * kosound_bus_gain(asset->getBus()))) )
+   {
+      return ONE_SHOT_INVALID_HANDLE;
+   }
+   return voicePool->play(asset, false, 0.0f, 0.0f, 0.0f, 
+         gain, asset->getBus());
+}
+
+/*************************************************************************
+ *                             playOneShots                              *
+ *************************************************************************/
+int Sound::playOneShots(const OneShotDesc* descs, int count,
+      OneShotHandle* handles)
+{
+   SoundAsset* asset = NULL;
+   SoundAssetId assetId = SOUND_INVALID_ASSET;
+   ALfloat busGain = 1.0f;
+   OneShotHandle handle;
+   int i, played = 0;
+
+   if( (!enabled) || (voicePool == NULL) )
+   {
+      for(i = 0; (handles != NULL) && (i < count); i++)
+      {
+         handles[i] = ONE_SHOT_INVALID_HANDLE;
+      }
+      return 0;
+   }
+
+   OpenALExt::deferUpdates();
+   for(i = 0; i < count; i++)
+   {
+      const OneShotDesc& desc = descs[i];
+      if(desc.asset != assetId)
+      {
+         /* Usually the same for a sequence of them */
+         assetId = desc.asset;
+         asset = getAsset(assetId);
+         busGain = (asset != NULL) ? kosound_bus_gain(asset->getBus()) : 1.0f;
+      }
+
+      handle = ONE_SHOT_INVALID_HANDLE;
+      if( (asset != NULL) &&
+          (admit(asset->getPolicy(), desc.positional, desc.x, desc.y, 
+                 desc.z, desc.gain * busGain)) )
+      {
+         handle = voicePool->queue(asset, desc.positional, 
+               desc.x, desc.y, desc.z, desc.gain, asset->getBus());
+      }
+      if(handle != ONE_SHOT_INVALID_HANDLE)
+      {
+         played++;
+      }
+      if(handles != NULL)
+      {
+         handles[i] = handle;
+      }
+   }
+   OpenALExt::processUpdates();
+   voicePool->playQueued();
+
+   return played;
+}
+
+/*************************************************************************
+ *                              stopOneShot                              *
+ *************************************************************************/
+void Sound::stopOneShot(OneShotHandle handle)
+{
+   if( (enabled) && (voicePool != NULL) )
+   {
+      voicePool->stop(handle);
+   }
+}
+
+/*************************************************************************
+ *                           isOneShotPlaying                            *
+ *************************************************************************/
+bool Sound::isOneShotPlaying(OneShotHandle handle)
+{
+   if( (enabled) && (voicePool != NULL) )
+   {
+      return voicePool->isPlaying(handle);
+   }
+   return false;
+}
+
+/*************************************************************************
+ *                          setOneShotPosition                           *
+ *************************************************************************/
+void Sound::setOneShotPosition(OneShotHandle handle, 
+      ALfloat x, ALfloat y, ALfloat z)
+{
+   if( (enabled) && (voicePool != NULL) )
+   {
+      voicePool->setPosition(handle, x, y, z);
+   }
+}
+
+/*************************************************************************
+ *                           setOneShotVoices                            *
+ *************************************************************************/
+void Sound::setOneShotVoices(int voices)
+{
+   totalVoices = voices;
+   if( (enabled) && (voicePool != NULL) )
+   {
+      delete voicePool;
+      voicePool = new VoicePool(totalVoices);
+   }
+}
+
+/*************************************************************************
+ *                            setSoundPolicy                             *
+ *************************************************************************/
+void Sound::setSoundPolicy(const Kobold::String& fileName, int maxInstances,
+      SoundPolicy::StealMode mode, unsigned long minRetrigger)
+{
+   SoundPolicy* policy = getPolicy(fileName);
+   size_t i;
+
+   if(policy == NULL)
+   {
+      policy = new SoundPolicy();
+      policies[fileName] = policy;
+
+      /* Its asset, if already registered, is now limited too */
+      for(i = 0; i < assets.size(); i++)
+      {
+         if(assets[i]->getFileName() == fileName)
+         {
+            assets[i]->setPolicy(policy);
+         }
+      }
+   }
+   policy->define(maxInstances, mode, minRetrigger);
+}
+
+/*************************************************************************
+ *                               getPolicy                               *
+ *************************************************************************/
+SoundPolicy* Sound::getPolicy(const Kobold::String& fileName)
+{
+   std::map<Kobold::String, SoundPolicy*>::iterator it;
+
+   if(policies.empty())
+   {
+      return NULL;
+   }
+   it = policies.find(fileName);
+   if(it != policies.end())
+   {
+      return it->second;
+   }
+   return NULL;
+}
+
+/*************************************************************************
+ *                              getLoudness                              *
+ *************************************************************************/
+static ALfloat kosound_loudness(ALfloat dx, ALfloat dy, ALfloat dz,
+      ALfloat gain, ALfloat reference, ALfloat rolloff)
+{
+   ALfloat dist = sqrtf(dx * dx + dy * dy + dz * dz);
+
+   if( (rolloff <= 0.0f) || (dist <= reference) || (reference <= 0.0f) )
+   {
+      return gain;
+   }
+   /* As AL_EXPONENT_DISTANCE attenuates */
+   return gain * powf(dist / reference, -rolloff);
+}
+
+ALfloat Sound::getLoudness(ALuint source)
+{
+   ALfloat gain = 1.0f, reference = 1.0f, rolloff = 1.0f;
+   ALfloat x = 0.0f, y = 0.0f, z = 0.0f;
+   ALint relative = AL_FALSE;
+
+   alGetSourcef(source, AL_GAIN, &gain);
+   alGetSourcef(source, AL_REFERENCE_DISTANCE, &reference);
+   alGetSourcef(source, AL_ROLLOFF_FACTOR, &rolloff);
+   alGetSource3f(source, AL_POSITION, &x, &y, &z);
+   alGetSourcei(source, AL_SOURCE_RELATIVE, &relative);
+
+   if(relative == AL_TRUE)
+   {
+      return kosound_loudness(x, y, z, gain, reference, rolloff);
+   }
+   return kosound_loudness(x - listenerX, y - listenerY, z - listenerZ,
+         gain, reference, rolloff);
+}
+
+/*************************************************************************
+ *                                 admit                                 *
+ *************************************************************************/
+bool Sound::admit(SoundPolicy* policy, bool positional,
+      ALfloat x, ALfloat y, ALfloat z, ALfloat gain)
+{
+   PolicyInstance instance;
+   SndFx* snd;
+   ALfloat loudness, victimLoudness = 0.0f;
+   size_t i, victim;
+   int total;
+
+   if(policy == NULL)
+   {
+      /* No limits */
+      return true;
+   }
+   if(policy->isCoolingDown())
+   {
+      return false;
+   }
+
+   if(policy->isFull())
+   {
+      if(policy->getStealMode() == SoundPolicy::STEAL_NONE)
+      {
+         return false;
+      }
+
+      /* Get all its instances */
+      candidates.clear();
+      instance.oneShot = ONE_SHOT_INVALID_HANDLE;
+      total = sndList.getTotal();
+      snd = (SndFx*)sndList.getFirst();
+      for(i = 0; i < (size_t)total; i++)
       {
-         snd->changeVolume(sndfxVolume);
+         if(snd->getPolicy() == policy)
+         {
+            instance.order = snd->getPolicyOrder();
+            instance.source = snd->getSource();
+            instance.sndFx = snd;
+            candidates.push_back(instance);
+         }
          snd = (SndFx*)snd->getNext();
       }
+      if(voicePool != NULL)
+      {
+         voicePool->collect(policy, candidates);
+      }
+
+      if(!candidates.empty())
+      {
+         /* Select the one to steal */
+         victim = 0;
+         if(policy->getStealMode() == SoundPolicy::STEAL_QUIETEST)
+         {
+            victimLoudness = getLoudness(candidates[0].source);
+         }
+         for(i = 1; i < candidates.size(); i++)
+         {
+            switch(policy->getStealMode())
+            {
+               case SoundPolicy::STEAL_OLDEST:
+                  if(candidates[i].order < candidates[victim].order)
+                  {
+                     victim = i;
+                  }
+               break;
+               case SoundPolicy::STEAL_NEWEST:
+                  if(candidates[i].order > candidates[victim].order)
+                  {
+                     victim = i;
+                  }
+               break;
+               default:
+                  loudness = getLoudness(candidates[i].source);
+                  if(loudness < victimLoudness)
+                  {
+                     victim = i;
+                     victimLoudness = loudness;
+                  }
+               break;
+            }
+         }
+
+         if(policy->getStealMode() == SoundPolicy::STEAL_QUIETEST)
+         {
+            loudness = (positional) ? 
+               kosound_loudness(x - listenerX, y - listenerY, z - listenerZ,
+                     gain, 160.0f, 1.0f) : gain;
+            if(loudness < victimLoudness)
+            {
+               /* The request itself is the quietest one */
+               return false;
+            }
+         }
+
+         /* Steal it */
+         if(candidates[victim].sndFx != NULL)
+         {
+            removeSoundEffect(candidates[victim].sndFx);
+         }
+         else
+         {
+            voicePool->stop(candidates[victim].oneShot);
+         }
+      }
+   }
+
+   policy->trigger();
+   return true;
+}
+
+/*************************************************************************
+ *                               newHandle                               *
+ *************************************************************************/
+SoundHandle Sound::newHandle()
+{
+   SoundHandle handle = ++lastHandle;
+   while(handle == SOUND_INVALID_HANDLE)
+   {
+      /* Wrapped around */
+      handle = ++lastHandle;
+   }
+   return handle;
+}
+
+/*************************************************************************
+ *                                 post                                  *
+ *************************************************************************/
+bool Sound::post(const SoundCommand& cmd)
+{
+   if( ( (!enabled) && (!opening) ) || (!commands.push(cmd)) )
+   {
+      if(cmd.fileReader != NULL)
+      {
+         /* It's our responsibility to delete the reader */
+         delete cmd.fileReader;
+      }
+      return false;
+   }
+   return true;
+}
+
+/*************************************************************************
+ *                            discardCommands                            *
+ *************************************************************************/
+void Sound::discardCommands()
+{
+   SoundCommand cmd;
+
+   while(commands.pop(cmd))
+   {
+      if(cmd.fileReader != NULL)
+      {
+         delete cmd.fileReader;
+      }
+   }
+}
+
+/*************************************************************************
+ *                            postSoundEffect                            *
+ *************************************************************************/
+SoundHandle Sound::postSoundEffect(ALfloat x, ALfloat y, ALfloat z, 
+      int loop, const Kobold::String& fileName, 
+      Kobold::FileReader* fileReader)
+{
+   SoundCommand cmd;
+   cmd.type = SoundCommand::COMMAND_PLAY;
+   cmd.handle = newHandle();
+   cmd.positional = true;
+   cmd.x = x;
+   cmd.y = y;
+   cmd.z = z;
+   cmd.loop = loop;
+   cmd.fileName = fileName;
+   cmd.fileReader = fileReader;
+
+   return (post(cmd)) ? cmd.handle : SOUND_INVALID_HANDLE;
+}
+
+/*************************************************************************
+ *                            postSoundEffect                            *
+ *************************************************************************/
+SoundHandle Sound::postSoundEffect(int loop, const Kobold::String& fileName, 
+      Kobold::FileReader* fileReader)
+{
+   SoundCommand cmd;
+   cmd.type = SoundCommand::COMMAND_PLAY;
+   cmd.handle = newHandle();
+   cmd.positional = false;
+   cmd.loop = loop;
+   cmd.fileName = fileName;
+   cmd.fileReader = fileReader;
+
+   return (post(cmd)) ? cmd.handle : SOUND_INVALID_HANDLE;
+}
+
+/*************************************************************************
+ *                          postStopSoundEffect                          *
+ *************************************************************************/
+bool Sound::postStopSoundEffect(SoundHandle handle)
+{
+   SoundCommand cmd;
+   cmd.type = SoundCommand::COMMAND_STOP;
+   cmd.handle = handle;
+   cmd.fileReader = NULL;
+
+   return post(cmd);
+}
+
+/*************************************************************************
+ *                        postSoundEffectPosition                        *
+ *************************************************************************/
+bool Sound::postSoundEffectPosition(SoundHandle handle, 
+      ALfloat x, ALfloat y, ALfloat z)
+{
+   SoundCommand cmd;
+   cmd.type = SoundCommand::COMMAND_MOVE;
+   cmd.handle = handle;
+   cmd.x = x;
+   cmd.y = y;
+   cmd.z = z;
+   cmd.fileReader = NULL;
+
+   return post(cmd);
+}
+
+/*************************************************************************
+ *                              postVolume                               *
+ *************************************************************************/
+bool Sound::postVolume(int music, int sndV)
+{
+   SoundCommand cmd;
+   cmd.type = SoundCommand::COMMAND_VOLUME;
+   cmd.music = music;
+   cmd.sndfx = sndV;
+   cmd.fileReader = NULL;
+
+   return post(cmd);
+}
+
+/*************************************************************************
+ *                               postMusic                               *
+ *************************************************************************/
+bool Sound::postMusic(const Kobold::String& fileName, 
+      Kobold::FileReader* fileReader)
+{
+   SoundCommand cmd;
+   cmd.type = SoundCommand::COMMAND_MUSIC;
+   cmd.fileName = fileName;
+   cmd.fileReader = fileReader;
+
+   return post(cmd);
+}
+
+/*************************************************************************
+ *                            getSoundEffect                             *
+ *************************************************************************/
+SndFx* Sound::getSoundEffect(SoundHandle handle)
+{
+   std::vector<SndFx*>::iterator it = std::lower_bound(handles.begin(),
+         handles.end(), handle, kosound_handle_less);
+   if( (it != handles.end()) && ((*it)->getHandle() == handle) )
+   {
+      return *it;
+   }
+   return NULL;
+}
+
+/*************************************************************************
+ *                            processCommands                            *
+ *************************************************************************/
+void Sound::processCommands()
+{
+   SoundCommand cmd;
+   SndFx* snd;
+
+   while(commands.pop(cmd))
+   {
+      switch(cmd.type)
+      {
+         case SoundCommand::COMMAND_PLAY:
+         {
+            if(cmd.positional)
+            {
+               snd = addSoundEffect(cmd.x, cmd.y, cmd.z, cmd.loop, 
+                     cmd.fileName, cmd.fileReader);
+            }
+            else
+            {
+               snd = addSoundEffect(cmd.loop, cmd.fileName, cmd.fileReader);
+            }
+            if(snd != NULL)
+            {
+               snd->setHandle(cmd.handle);
+               handles.insert(std::lower_bound(handles.begin(), 
+                        handles.end(), cmd.handle, kosound_handle_less), 
+                     snd);
+            }
+         }
+         break;
+         case SoundCommand::COMMAND_STOP:
+         {
+            /* Could already be removed (ended) */
+            removeSoundEffect(getSoundEffect(cmd.handle));
+         }
+         break;
+         case SoundCommand::COMMAND_MOVE:
+         {
+            snd = getSoundEffect(cmd.handle);
+            if(snd != NULL)
+            {
+               snd->redefinePosition(cmd.x, cmd.y, cmd.z);
+            }
+         }
+         break;
+         case SoundCommand::COMMAND_VOLUME:
+         {
+            changeVolume(cmd.music, cmd.sndfx);
+         }
+         break;
+         case SoundCommand::COMMAND_MUSIC:
+         {
+            loadMusic(cmd.fileName, cmd.fileReader);
+         }
+         break;
+      }
    }
 }
 
@@ -330,11 +2739,70 @@ ALCdevice* Sound::device;         /**< Active AL device */
 ALCcontext* Sound::context;       /**< Active AL context */
 SndFx* Sound::backMusic;         /**< Active BackGround Music */
 
-bool Sound::enabled;              /**< If Sound is Enabled or Not */
+std::atomic<bool> Sound::enabled(false); /**< If Sound is Enabled or Not */
+std::atomic<bool> Sound::opening(false);
+std::atomic<bool> Sound::deviceOpened(false);
+const char* Sound::openError = NULL;
+std::thread Sound::openThread;
 
 Kobold::List Sound::sndList;         /**< sndFx List */
+ALfloat Sound::listenerX = 0.0f;
+ALfloat Sound::listenerY = 0.0f;
+ALfloat Sound::listenerZ = 0.0f;
 
 int Sound::musicVolume;           /**< The Music volume */
 int Sound::sndfxVolume;           /**< The SndFxVolume */
+std::map<Kobold::String, SoundBus*> Sound::buses;
+SoundBus* Sound::masterBus = NULL;
+SoundBus* Sound::musicBus = NULL;
+SoundBus* Sound::sfxBus = NULL;
 Kobold::Timer Sound::timer;
+unsigned long Sound::flushTime = 0;
+unsigned long Sound::lastReclaim = 0;
+std::atomic<bool> Sound::deviceLost(false);
+bool Sound::autoReopen = true;
+unsigned long Sound::lastReopen = 0;
+bool Sound::suspended = false;
+int Sound::suspendedThreads = 0;
+std::vector<ALuint> Sound::pausedSources;
+unsigned long Sound::refillMargin = KOSOUND_DEFAULT_REFILL_MARGIN;
+MpscQueue<SoundCommand> Sound::commands(KOSOUND_COMMAND_QUEUE_SIZE);
+std::atomic<SoundHandle> Sound::lastHandle(SOUND_INVALID_HANDLE);
+std::vector<SndFx*> Sound::handles;
+std::vector<SndFx*> Sound::scheduled;
+double Sound::clockOffset = 0.0;
+bool Sound::downmixPositional = true;
+SoundAsset::Encoding Sound::assetEncoding = SoundAsset::ENCODING_PCM16;
+std::vector<SoundEmitter> Sound::emitters;
+SpatialParams Sound::emitterParams;
+SpatialParams Sound::nearParams;
+std::vector<ALfloat> Sound::nearScores;
+std::vector<EmitterScore> Sound::rankedEmitters;
+int Sound::emitterVoices = KOSOUND_DEFAULT_EMITTER_VOICES;
+std::vector<EmitterId> Sound::freeEmitters;
+std::vector<EmitterId> Sound::activeEmitters;
+EmitterGrid Sound::emitterGrid(KOSOUND_DEFAULT_EMITTER_CELL_SIZE);
+std::vector<EmitterId> Sound::nearEmitters;
+ALfloat Sound::maxEmitterRange = 0.0f;
+bool Sound::emittersChanged = false;
+ALfloat Sound::cullX = 0.0f;
+ALfloat Sound::cullY = 0.0f;
+ALfloat Sound::cullZ = 0.0f;
+std::vector<SoundAsset*> Sound::assets;
+VoicePool* Sound::voicePool = NULL;
+std::map<Kobold::String, SoundPolicy*> Sound::policies;
+std::vector<PolicyInstance> Sound::candidates;
+int Sound::totalVoices = KOSOUND_DEFAULT_ONE_SHOT_VOICES;
+bool Sound::useEvents = true;
+bool Sound::eventDriven = false;
+bool Sound::pollAll = true;
+MpscQueue<ALuint> Sound::events(KOSOUND_EVENT_QUEUE_SIZE);
+std::atomic<bool> Sound::eventsOverflow(false);
+std::vector<ALuint> Sound::eventSources;
+std::vector<StreamSource> Sound::streamSources;
+std::vector<StreamDeadline> Sound::deadlines;
+DecodePool* Sound::decodePool = NULL;
+std::vector<DecodeJob> Sound::decodeJobs;
+unsigned long Sound::decodeBudget = 0;
+DecodeBudgetStats Sound::budgetStats = {0, 0, 0, 0};
 
@@ -37,6 +37,20 @@
 #include <kobold/timer.h>
 
 #include "sndfx.h"
+#include "soundcommand.h"
+#include "mpscqueue.h"
+#include "decodepool.h"
+#include "soundasset.h"
+#include "voicepool.h"
+#include "soundpolicy.h"
+#include "soundbus.h"
+#include "openalext.h"
+#include "spatialparams.h"
+
+#include <atomic>
+#include <map>
+#include <thread>
+#include <vector>
 
 
 namespace Kosound
@@ -47,13 +61,34 @@ namespace Kosound
 
 #define DEFAULT_VOLUME  128
 
-/*! The Sound Class definitions */
+/*! Default safety margin, in milliseconds, of stream refills */
+#define KOSOUND_DEFAULT_REFILL_MARGIN  50
+
+/*! Default number of voices to play one-shots */
+#define KOSOUND_DEFAULT_ONE_SHOT_VOICES  32
+
+/*! The Sound Class definitions.
+ * \note All functions, except the post* ones, must be called by a single
+ *       thread (the one calling flush()). The post* functions could be
+ *       called by any thread at any time, without blocking: they queue
+ *       commands executed at the next flush(). */
 class Sound
 {
    public:
       /*! Init the Sound system to use (must be called at program's init) */
       static void init();
 
+      /*! Init the Sound system without waiting for the OpenAL device,
+       * which is opened by a background thread (as it could take long on
+       * some systems). Meanwhile, requested sound effects, musics and 
+       * volumes (either by the post* functions, addSoundEffect, loadMusic
+       * or changeVolume) are queued, to be replayed at the first flush() 
+       * after the device is ready. Use instead of init(). */
+      static void initAsync();
+
+      /*! \return if the OpenAL device is still being opened (initAsync) */
+      static bool isOpening();
+
       /*! Finish the use of Sound system (must be called at program's end) */
       static void finish();
 
@@ -69,7 +104,12 @@ class Sound
 
 
       /*! Flush All Buffers to the Sound Device, updating the played Sounds
-       *  and music (usually called every frame, near GLflush() */
+       *  and music (usually called every frame, near GLflush() 
+       *  \note Once its containers have grown to the load, it does no
+       *        heap allocation itself, only creating (and opening) new
+       *        streamed effects does: one-shots and recycled sound 
+       *        effects of registered assets are the allocation free ways
+       *        to play cached sounds. */
       static void flush();
 
       /*! Load and Start to Play OGG music file.
@@ -87,7 +127,9 @@ class Sound
        *  \param fileName -> name of the ogg file to open
        *  \param fileReader -> FileReader to use. Pointer should not be freed 
        *   and will be deleted here when no longer needed. 
-       *  \return pointer to the added Sound */
+       *  \return pointer to the added Sound. NULL if rejected, or while
+       *          the device is opening (when it's just queued: use 
+       *          postSoundEffect to get a handle to it). */
       static SndFx* addSoundEffect(ALfloat x, ALfloat y, ALfloat z, int loop,
             const Kobold::String& fileName, Kobold::FileReader* fileReader);
       
@@ -97,10 +139,79 @@ class Sound
        *  \param fileName -> name of the ogg file to open
        *  \param fileReader -> FileReader to use. Pointer should not be freed 
        *   and will be deleted here when no longer needed. 
-       *  \return pointer to the added Sound */
+       *  \return pointer to the added Sound (NULL if rejected or queued,
+       *          see above) */
       static SndFx* addSoundEffect(int loop, const Kobold::String& fileName,
             Kobold::FileReader* fileReader);
 
+      /*! Add a sound effect of a registered asset (see registerAsset,
+       * with keepPcm), streamed from its decoded data in memory. Once 
+       * removed (by removeSoundEffect or at its end), it's kept stopped 
+       * by the asset and recycled by its next play: once grown to the 
+       * load, neither the play nor the removal allocates anything.
+       *  \param assetId -> asset to play
+       *  \param x -> X position
+       *  \param y -> Y position
+       *  \param z -> Z position
+       *  \param loop -> Sound loop interval ( < 0 won't loop) 
+       *  \return pointer to the added Sound. NULL if rejected, or the 
+       *          asset isn't registered with its PCM kept. */
+      static SndFx* addSoundEffect(SoundAssetId assetId, ALfloat x, 
+            ALfloat y, ALfloat z, int loop);
+
+      /*! Add a sound effect of a registered asset without position (see
+       * above).
+       *  \param assetId -> asset to play
+       *  \param loop -> Sound loop interval ( < 0 won't loop) 
+       *  \return pointer to the added Sound or NULL (see above) */
+      static SndFx* addSoundEffect(SoundAssetId assetId, int loop);
+
+      /*! Define if stereo files of positional sound effects (including
+       * emitters) are downmixed to mono as decoded. Without it, OpenAL
+       * won't spatialize (nor attenuate) them. Affects only the ones
+       * created after the call.
+       * \param enable -> true to downmix (default) */
+      static void setDownmix(bool enable);
+
+      /*! Define how assets (see registerAsset) keep their samples in 
+       * memory: compressed ones cost a fraction of it, decoded by the
+       * OpenAL mixer as played. Affects only the ones registered after 
+       * the call. Without its OpenAL extension, 16-bit PCM is used.
+       * \param encoding -> encoding to use (default: ENCODING_PCM16) */
+      static void setAssetEncoding(SoundAsset::Encoding encoding);
+
+      /*! \return current audio time, in seconds: the device clock (time
+       * of its played samples, with ALC_SOFT_device_clock) or, without
+       * it, the Sound wall clock. Continuous over device reopens. */
+      static double getAudioTime();
+
+      /*! Create a Sound effect to start at a precise audio time. With 
+       * AL_SOFT_source_start_delay, the device starts it sample-accurately
+       * at that time. Otherwise, it's started by the last flush() before
+       * the time, after leading silence covering the time remaining.
+       *  \param time -> audio time to start at (see getAudioTime). If 
+       *                 already past, starts as soon as possible.
+       *  \param x -> X position
+       *  \param y -> Y position
+       *  \param z -> Z position
+       *  \param loop -> Sound loop interval ( < 0 won't loop) 
+       *  \param fileName -> name of the file to open
+       *  \param fileReader -> FileReader to use. Will be deleted here.
+       *  \return pointer to the created (not yet playing) Sound or NULL */
+      static SndFx* scheduleSoundEffect(double time, ALfloat x, ALfloat y,
+            ALfloat z, int loop, const Kobold::String& fileName, 
+            Kobold::FileReader* fileReader);
+
+      /*! Create a Sound effect without position to start at a precise 
+       * audio time (see above).
+       *  \param time -> audio time to start at (see getAudioTime).
+       *  \param loop -> Sound loop interval ( < 0 won't loop) 
+       *  \param fileName -> name of the file to open
+       *  \param fileReader -> FileReader to use. Will be deleted here.
+       *  \return pointer to the created (not yet playing) Sound or NULL */
+      static SndFx* scheduleSoundEffect(double time, int loop, 
+            const Kobold::String& fileName, Kobold::FileReader* fileReader);
+
       /*! Remove Sound effect from list
        *  \param snd -> pointer to Sound effect to remove */
       static void removeSoundEffect(SndFx* snd);
@@ -108,11 +219,312 @@ class Sound
       /*! Remove All Sound Effects from list */
       static void removeAllSoundEffects();
 
-      /*! Change Overall Volume.
+      /*! Place a positional sound on the world, for large worlds with a
+       * lot of them (like ambient loops). Unlike addSoundEffect, nothing
+       * is opened until the listener gets inside its range (at a 
+       * flush()) and it's among the loudest ones heard (see 
+       * setEmitterVoices), when its SndFx is created. Out of range again
+       * (with a small hysteresis), or replaced by louder ones, it's 
+       * released and the emitter is kept virtual, its playback time 
+       * still running. Emitters are found by a uniform grid, so only 
+       * the ones near the listener are checked, and their loudness is
+       * estimated for all of them at once (see SpatialParams::score).
+       *  \param x -> X position
+       *  \param y -> Y position
+       *  \param z -> Z position
+       *  \param loop -> Sound loop interval ( < 0 won't loop: once 
+       *                 ended, it won't be created again) 
+       *  \param fileName -> name of the file to open
+       *  \param fileReader -> FileReader to use for each of its 
+       *                       instances. Will be deleted here, when the
+       *                       emitter is removed.
+       *  \param range -> max distance it's heard from 
+       *  \return its identifier */
+      static EmitterId addEmitter(ALfloat x, ALfloat y, ALfloat z, 
+            int loop, const Kobold::String& fileName, 
+            Kobold::FileReader* fileReader, 
+            ALfloat range=KOSOUND_DEFAULT_EMITTER_RANGE);
+
+      /*! Move an emitter (and its SndFx, if created) */
+      static void moveEmitter(EmitterId id, ALfloat x, ALfloat y, ALfloat z);
+
+      /*! Define the gain of an emitter [0, 1] (default 1) */
+      static void setEmitterGain(EmitterId id, ALfloat gain);
+
+      /*! Make an emitter directional (see SndFx::setDirectionCone) */
+      static void setEmitterCone(EmitterId id, ALfloat dirX, ALfloat dirY,
+            ALfloat dirZ, ALfloat innerAngle, ALfloat outerAngle);
+
+      /*! Define how many emitters could have a SndFx at once: only the
+       * loudest ones heard by the listener are created.
+       * \param voices -> max emitters created (0 for no limit; default:
+       *                  KOSOUND_DEFAULT_EMITTER_VOICES) */
+      static void setEmitterVoices(int voices);
+
+      /*! Remove an emitter, releasing its SndFx (if created) */
+      static void removeEmitter(EmitterId id);
+
+      /*! Remove all emitters */
+      static void removeAllEmitters();
+
+      /*! \return the SndFx of an emitter, or NULL if virtual (or not
+       * valid). Valid only until the next flush(). */
+      static SndFx* getEmitterSoundEffect(EmitterId id);
+
+      /*! Define the cell size of the emitters grid. Should be about the
+       * usual range of the emitters. 
+       * \param size -> cell size (default: 
+       *                KOSOUND_DEFAULT_EMITTER_CELL_SIZE) */
+      static void setEmitterCellSize(ALfloat size);
+
+      /*! Change Overall Volume: the gains of the music and sfx buses
+       * (applied at the next flush).
        *  \param music -> volume of the music
        *  \param sndV -> Sound effects volume */
       static void changeVolume(int music, int sndV); 
 
+      /*! Get a mix bus by its name. Default ones are KOSOUND_BUS_MASTER
+       * (the root), with KOSOUND_BUS_MUSIC, KOSOUND_BUS_SFX, 
+       * KOSOUND_BUS_VOICE and KOSOUND_BUS_UI as its children. 
+       * New sound effects (and one-shots) play at KOSOUND_BUS_SFX, and 
+       * the music at KOSOUND_BUS_MUSIC. To change the bus of a sound 
+       * effect, use its setBus(). 
+       * \return the bus or NULL if not defined */
+      static SoundBus* getBus(const Kobold::String& name);
+
+      /*! Create a new mix bus
+       * \param name -> its name (must be unique)
+       * \param parent -> its parent bus (NULL for the master one)
+       * \return the new bus, or NULL if the name is already used */
+      static SoundBus* createBus(const Kobold::String& name, 
+            SoundBus* parent);
+
+      /*! Define the bus the one-shots of an asset play at */
+      static void setAssetBus(SoundAssetId assetId, SoundBus* bus);
+
+      /*! Post, from any thread, a Sound effect to be created and played.
+       *  \param x -> X position
+       *  \param y -> Y position
+       *  \param z -> Z position
+       *  \param loop -> Sound loop interval ( < 0 won't loop) 
+       *  \param fileName -> name of the ogg file to open
+       *  \param fileReader -> FileReader to use. Pointer should not be freed 
+       *   and will be deleted here when no longer needed. 
+       *  \return handle to the posted effect, already valid to be used on 
+       *          other posts, or SOUND_INVALID_HANDLE if the command queue
+       *          is full. */
+      static SoundHandle postSoundEffect(ALfloat x, ALfloat y, ALfloat z, 
+            int loop, const Kobold::String& fileName, 
+            Kobold::FileReader* fileReader);
+
+      /*! Post, from any thread, a Sound effect without position.
+       *  \param loop -> if Sound will loop at end or not
+       *  \param fileName -> name of the ogg file to open
+       *  \param fileReader -> FileReader to use. Pointer should not be freed 
+       *   and will be deleted here when no longer needed. 
+       *  \return handle to the posted effect or SOUND_INVALID_HANDLE */
+      static SoundHandle postSoundEffect(int loop, 
+            const Kobold::String& fileName, Kobold::FileReader* fileReader);
+
+      /*! Post, from any thread, the stop (and removal) of a Sound effect 
+       * \param handle -> handle of the posted effect to stop
+       * \return false if the command queue is full */
+      static bool postStopSoundEffect(SoundHandle handle);
+
+      /*! Post, from any thread, a new position of a Sound effect 
+       * \param handle -> handle of the posted effect
+       * \param x -> new X position 
+       * \param y -> new Y position 
+       * \param z -> new Z position 
+       * \return false if the command queue is full */
+      static bool postSoundEffectPosition(SoundHandle handle, 
+            ALfloat x, ALfloat y, ALfloat z);
+
+      /*! Post, from any thread, an overall volume change.
+       *  \param music -> volume of the music
+       *  \param sndV -> Sound effects volume 
+       *  \return false if the command queue is full */
+      static bool postVolume(int music, int sndV);
+
+      /*! Post, from any thread, a music to load and play.
+       * \param fileName -> name of the ogg file with the desired music.
+       * \param fileReader -> FileReader to use. Will be deleted by Sound.
+       * \return false if the command queue is full */
+      static bool postMusic(const Kobold::String& fileName, 
+            Kobold::FileReader* fileReader);
+
+      /*! Get the sound effect created for a posted handle.
+       * \note only valid on the thread calling flush()
+       * \return the sound effect or NULL (not yet created or removed) */
+      static SndFx* getSoundEffect(SoundHandle handle);
+
+      /*! Register a sound to be played as one-shots, decoding its whole
+       * file now. Registering an already registered file just returns
+       * its current identifier.
+       * \param fileName -> name of the file to load
+       * \param fileReader -> FileReader to use. Will be deleted here.
+       * \param mono -> if a stereo file is downmixed to mono, as its 
+       *                positional one-shots are only spatialized if mono
+       * \param keepPcm -> if its decoded 16-bit PCM is also kept in 
+       *                  memory (ignoring setAssetEncoding), so it could
+       *                  be played as recycled sound effects too (see 
+       *                  addSoundEffect(SoundAssetId, ...)).
+       * \return asset identifier or SOUND_INVALID_ASSET on error */
+      static SoundAssetId registerAsset(const Kobold::String& fileName,
+            Kobold::FileReader* fileReader, bool mono=false, 
+            bool keepPcm=false);
+
+      /*! \return a registered asset, or NULL if not registered */
+      static SoundAsset* getAsset(SoundAssetId assetId);
+
+      /*! Play, once, a registered asset at a position. It's just a bind
+       * of the asset buffer to a pooled voice: nothing is allocated. 
+       * \param assetId -> asset to play
+       * \param x -> X position
+       * \param y -> Y position
+       * \param z -> Z position
+       * \param gain -> gain of this play [0, 1], relative to the sound 
+       *                effects volume.
+       * \return handle to the play or ONE_SHOT_INVALID_HANDLE */
+      static OneShotHandle playOneShot(SoundAssetId assetId, 
+            ALfloat x, ALfloat y, ALfloat z, ALfloat gain=1.0f);
+
+      /*! Play, once, a registered asset without position.
+       * \param assetId -> asset to play
+       * \param gain -> gain of this play [0, 1]
+       * \return handle to the play or ONE_SHOT_INVALID_HANDLE */
+      static OneShotHandle playOneShot(SoundAssetId assetId, 
+            ALfloat gain=1.0f);
+
+      /*! Play many one-shots at once (as debris of an explosion). Each 
+       * asset is resolved once for consecutive descriptors, all voices
+       * get their state in a single deferred batch (when 
+       * AL_SOFT_deferred_updates is available) and start together with
+       * a single alSourcePlayv. Each one is admitted by its policy as
+       * if played by playOneShot.
+       * \param descs -> one-shots to play
+       * \param count -> number of descriptors at descs
+       * \param handles -> if not NULL, receives the handle of each one
+       *                  (ONE_SHOT_INVALID_HANDLE for rejected ones)
+       * \return number of one-shots accepted */
+      static int playOneShots(const OneShotDesc* descs, int count,
+            OneShotHandle* handles=NULL);
+
+      /*! Stop a one-shot (no-op if already ended) */
+      static void stopOneShot(OneShotHandle handle);
+
+      /*! \return if a one-shot is still playing */
+      static bool isOneShotPlaying(OneShotHandle handle);
+
+      /*! Redefine the position of a still playing one-shot */
+      static void setOneShotPosition(OneShotHandle handle, 
+            ALfloat x, ALfloat y, ALfloat z);
+
+      /*! Define how many one-shots could play at once: when all are
+       * playing, a new one steals the oldest. Stops all current ones.
+       * \param voices -> number of voices (default: 
+       *                  KOSOUND_DEFAULT_ONE_SHOT_VOICES) */
+      static void setOneShotVoices(int voices);
+
+      /*! Define the playback limits of a sound file, checked at each 
+       * request to play it (either by addSoundEffect, postSoundEffect or
+       * playOneShot), before any stream is created. A rejected request
+       * returns NULL (or an invalid handle).
+       * \param fileName -> the sound file
+       * \param maxInstances -> max instances at once (0 for no limit)
+       * \param mode -> what to do when at maxInstances
+       * \param minRetrigger -> min milliseconds between two requests 
+       *                        (0 for no limit) */
+      static void setSoundPolicy(const Kobold::String& fileName,
+            int maxInstances, SoundPolicy::StealMode mode, 
+            unsigned long minRetrigger);
+
+      /*! Define how many threads will decode streams in parallel at each
+       * flush(), besides the caller itself. 
+       * \param threads -> number of threads. 0 to update all streams
+       *                   sequentially, on the flush() caller (default). */
+      static void setDecodeThreads(int threads);
+
+      /*! Define a decode time budget for each flush(). Streams are 
+       * updated most urgent first (least queued audio) and, once the
+       * budget is over, the others are left to the next flush. Streams
+       * close to an underrun (less than two refill margins queued, see
+       * setRefillMargin) are always updated, even over the budget.
+       * \param microseconds -> budget, or 0 for no limit (default) */
+      static void setDecodeBudget(unsigned long microseconds);
+
+      /*! \return how often the decode budget was exceeded or streams
+       * deferred by it (see setDecodeBudget) */
+      static const DecodeBudgetStats& getDecodeBudgetStats();
+
+      /*! Zero the decode budget statistics */
+      static void resetDecodeBudgetStats();
+
+      /*! Define the read-ahead of the next opened Ogg streams.
+       * \param chunkSize -> size of each read chunk, in bytes. Seeks 
+       *                     inside the current two chunks cost no I/O.
+       * \param asyncPrefetch -> if will read the next chunk on a
+       *                         background thread, while consuming the
+       *                         current one (default: false). */
+      static void setReadAhead(size_t chunkSize, bool asyncPrefetch);
+
+      /*! Define if streams are refilled only when OpenAL reports (by the
+       * AL_SOFT_events extension) that they consumed a buffer or changed 
+       * their state (or at their refill deadline), instead of polling 
+       * them. Either way, a flush only visits the streams with an event
+       * or a due deadline, not all of them. Without the extension, 
+       * streams are always polled.
+       * \param enable -> true to use events when available (default) */
+      static void setEventDriven(bool enable);
+
+      /*! \return if streams are currently refilled by OpenAL events */
+      static bool isEventDriven();
+
+      /*! Define the safety margin of stream refills. Each stream is 
+       * updated only when its queued audio is about to run out, minus 
+       * this margin, which should be greater than the usual time between
+       * two flush() calls.
+       * \param milliseconds -> margin (default: 
+       *                        KOSOUND_DEFAULT_REFILL_MARGIN) */
+      static void setRefillMargin(unsigned long milliseconds);
+
+      /*! Move the output to another device (or the default one), as 
+       * after the current one was lost (see setAutoReopen). Playing 
+       * streams continue from where they were, and registered assets 
+       * aren't decoded again: with ALC_SOFT_reopen_device the context is
+       * just moved to the new device; otherwise, the state of each 
+       * stream is saved, the context recreated on the new device and 
+       * the state restored, with assets reloaded from their decoded 
+       * data (kept in memory just for that). Playing one-shots are lost.
+       * \param deviceName -> device to use, NULL for the default one
+       * \return true on success. On failure to open any device, sound
+       *         is disabled. */
+      static bool reopenDevice(const char* deviceName=NULL);
+
+      /*! \return if the output device was lost (like an unplugged 
+       * headset), and not yet reopened */
+      static bool isDeviceLost();
+
+      /*! Define if, when the output device is lost, it's automatically
+       * reopened at the default device (trying again each second, on 
+       * failure). Default: true. */
+      static void setAutoReopen(bool enable);
+
+      /*! Suspend all audio work, as when the application goes to the
+       * background: playing sources are paused (all at once), the decode
+       * and read-ahead threads are stopped and, with 
+       * ALC_SOFT_pause_device, the device stops mixing. Streams keep 
+       * their decoder state, so resume() is instant. While suspended,
+       * flush() does nothing (posted commands wait on the queue). */
+      static void suspend();
+
+      /*! Resume what was suspended by suspend(): the paused sources play
+       * again (all at once) and the decode threads are created again. */
+      static void resume();
+
+      /*! \return if suspended (see suspend) */
+      static bool isSuspended();
+
       /*! init the OpenAL device
        * \return true if successfull */
       static bool initOpenAL();
@@ -124,17 +536,236 @@ class Sound
       /* Must not allow instances. */
       Sound(){};
 
+      /*! Push a command to the queue, deleting its fileReader if full */
+      static bool post(const SoundCommand& cmd);
+
+      /*! Discard all posted commands, deleting their fileReaders */
+      static void discardCommands();
+
+      /*! Open the OpenAL device and create its context
+       * \param deviceName -> device to open, NULL for the default one
+       * \return NULL on success, or the error message */
+      static const char* openDevice(const char* deviceName);
+
+      /*! Check if the device was lost, reopening it if automatic */
+      static void checkDevice();
+
+      /*! Restart all streams stopped by a device loss */
+      static void resumeStreams();
+
+      /*! Reopen the device, without ALC_SOFT_reopen_device: recreate 
+       * the context, saving and restoring sources and buffers */
+      static bool recreateDevice(const char* deviceName);
+
+      /*! Make the context current, preparing it to use */
+      static void initContext();
+
+      /*! Body of the thread opening the device (initAsync) */
+      static void openDeviceThread();
+
+      /*! Finish an initAsync, with the device already opened (or not) */
+      static void finishAsyncInit();
+
+      /*! Get a new, not yet used, handle */
+      static SoundHandle newHandle();
+
+      /*! Execute all commands posted until now */
+      static void processCommands();
+
+      /*! Create a sound effect, inserting it on the list
+       * \param positional -> if positional (x, y and z) or not
+       * \param play -> if will start to play now
+       * \return the new sound effect, or NULL if rejected or disabled */
+      static SndFx* createSoundEffect(bool positional, ALfloat x, 
+            ALfloat y, ALfloat z, int loop, const Kobold::String& fileName,
+            Kobold::FileReader* fileReader, bool play);
+
+      /*! Play a sound effect of an asset, recycling an idle one of it if
+       * any, inserting it on the list.
+       * \param positional -> if positional (x, y and z) or not
+       * \return the sound effect, or NULL if rejected or disabled */
+      static SndFx* createAssetEffect(bool positional, SoundAssetId assetId,
+            ALfloat x, ALfloat y, ALfloat z, int loop);
+
+      /*! Schedule the start of a just created sound effect */
+      static void schedule(SndFx* snd, double time);
+
+      /*! Start the scheduled sound effects whose time is near */
+      static void startScheduled();
+
+      /*! Create the emitters now in range, releasing those out of it */
+      static void updateEmitters();
+
+      /*! Create the SndFx of a virtual emitter */
+      static void createEmitterSoundEffect(EmitterId id);
+
+      /*! Keep an emitter virtual, as its SndFx is being removed */
+      static void detachEmitter(SndFx* snd);
+
+      /*! \return an emitter in use, or NULL if not valid */
+      static SoundEmitter* getEmitter(EmitterId id);
+
+      /*! \return the policy of a file, or NULL if none */
+      static SoundPolicy* getPolicy(const Kobold::String& fileName);
+
+      /*! Check a request to play against its policy, stealing an 
+       * instance if needed.
+       * \param policy -> policy of the requested file (could be NULL)
+       * \param positional -> if the request is positional
+       * \param x -> X position of the request
+       * \param y -> Y position of the request
+       * \param z -> Z position of the request
+       * \param gain -> effective gain of the request
+       * \return true if could play, false if rejected */
+      static bool admit(SoundPolicy* policy, bool positional,
+            ALfloat x, ALfloat y, ALfloat z, ALfloat gain);
+
+      /*! \return how loud a playing source is heard by the listener */
+      static ALfloat getLoudness(ALuint source);
+
+      /*! Update the streams needing it, most urgent first, within the
+       * decode budget: in parallel by the decodePool, if any */
+      static void updateStreams();
+
+      /*! Subscribe (or unsubscribe) to the OpenAL stream events */
+      static void enableEvents(bool enable);
+
+      /*! Get the sources reported by OpenAL events since last call */
+      static void processEvents();
+
+      /*! \return if a stream must be updated at the current flush */
+      static bool needsUpdate(SndFx* snd);
+
+      /*! Add to decodeJobs a stream needing an update at this flush
+       * \param job -> job to fill and add
+       * \param snd -> the stream (could be NULL: not added) */
+      static void addJob(DecodeJob& job, SndFx* snd);
+
+      /*! Define when a just updated stream needs its next update
+       * \param snd -> the stream
+       * \param active -> result of its update */
+      static void scheduleUpdate(SndFx* snd, bool active);
+
+      /*! Define when a stream needs its next update
+       * \param snd -> the stream
+       * \param time -> its deadline (ms, at the flush clock) */
+      static void setDeadline(SndFx* snd, unsigned long time);
+
+      /*! Start tracking a sound effect at sndList, by its source and
+       * next update (so updated without walking the list) */
+      static void trackStream(SndFx* snd);
+
+      /*! Stop tracking a sound effect, as leaving sndList */
+      static void untrackStream(SndFx* snd);
+
+      /*! Track again every sound effect (after their sources changed) */
+      static void retrackStreams();
+
+      /*! \return the tracked sound effect playing at a source, or NULL */
+      static SndFx* findStream(ALuint source);
+
+      /*! Called by OpenAL (from its mixer thread) on a subscribed event */
+      static void AL_APIENTRY onEvent(ALenum eventType, ALuint object, 
+            ALuint param, ALsizei length, const ALchar* message, 
+            void* userParam);
+
       static ALCdevice* device;         /**< Active AL device */
       static ALCcontext* context;       /**< Active AL context */
       static SndFx* backMusic;          /**< Active BackGround Music */
 
-      static bool enabled;              /**< If Sound is Enabled or Not */
+      static std::atomic<bool> enabled; /**< If Sound is Enabled or Not */
+      static std::atomic<bool> opening; /**< If opening by initAsync */
+      static std::atomic<bool> deviceOpened; /**< If open thread is done */
+      static const char* openError;     /**< Result of the open thread */
+      static std::thread openThread;    /**< Thread opening the device */
+      static std::atomic<bool> deviceLost; /**< If output was lost */
+      static bool autoReopen;           /**< If reopen on device loss */
+      static unsigned long lastReopen;  /**< Clock of last reopen try */
+
+      static bool suspended;            /**< If suspended */
+      static int suspendedThreads;      /**< Decode threads to recreate */
+      /*! Sources paused by suspend, to play again at resume */
+      static std::vector<ALuint> pausedSources;
 
       static Kobold::List sndList;      /**< Head Node of sndFx List */
 
+      static ALfloat listenerX;         /**< Listener X position */
+      static ALfloat listenerY;         /**< Listener Y position */
+      static ALfloat listenerZ;         /**< Listener Z position */
+
+      /*! Create the default buses, if not yet created */
+      static void createDefaultBuses();
+
       static int musicVolume;           /**< The Music volume */
       static int sndfxVolume;           /**< The SndFxVolume */
-      static Kobold::Timer timer;       /**< Timer for sound update */
+      static Kobold::Timer timer;       /**< Clock of stream updates */
+      static unsigned long flushTime;   /**< Clock time at this flush */
+      static unsigned long lastReclaim; /**< Clock time of last reclaim */
+      static unsigned long refillMargin; /**< Refill margin (ms) */
+
+      static std::map<Kobold::String, SoundBus*> buses; /**< By name */
+      static SoundBus* masterBus;       /**< Root bus */
+      static SoundBus* musicBus;        /**< Default bus of the music */
+      static SoundBus* sfxBus;          /**< Default bus of effects */
+
+      static MpscQueue<SoundCommand> commands; /**< Posted commands */
+      static std::atomic<SoundHandle> lastHandle; /**< Last handle given */
+      /*! Sound effects created by posted commands, sorted by handle (a
+       * vector: no allocation per play, once grown) */
+      static std::vector<SndFx*> handles;
+
+      /*! Sound effects waiting a flush to start (without start delay) */
+      static std::vector<SndFx*> scheduled;
+      /*! Added to the device clock, keeping the audio time continuous
+       * when the device is reopened (its clock restarting) */
+      static double clockOffset;
+
+      static bool downmixPositional;    /**< If downmix positional ones */
+      static SoundAsset::Encoding assetEncoding; /**< Of new assets */
+
+      static std::vector<SoundEmitter> emitters; /**< By EmitterId - 1 */
+      /*! Spatial parameters of the emitters, by EmitterId - 1 */
+      static SpatialParams emitterParams;
+      static SpatialParams nearParams;  /**< Of the ones near to score */
+      static std::vector<ALfloat> nearScores; /**< Their scores */
+      /*! Emitters heard, loudest ones selected first */
+      static std::vector<EmitterScore> rankedEmitters;
+      static int emitterVoices;         /**< Max emitters created */
+      static std::vector<EmitterId> freeEmitters; /**< Unused slots */
+      /*! Emitters with a SndFx created */
+      static std::vector<EmitterId> activeEmitters;
+      static EmitterGrid emitterGrid;   /**< Emitters by position */
+      static std::vector<EmitterId> nearEmitters; /**< Got from the grid */
+      static ALfloat maxEmitterRange;   /**< Greatest range of them all */
+      static bool emittersChanged;      /**< If must check them again */
+      static ALfloat cullX;             /**< Listener X at last check */
+      static ALfloat cullY;             /**< Listener Y at last check */
+      static ALfloat cullZ;             /**< Listener Z at last check */
+
+      static std::vector<SoundAsset*> assets; /**< Registered assets */
+      static VoicePool* voicePool;            /**< Voices for one-shots */
+      /*! Playback limits, by file name */
+      static std::map<Kobold::String, SoundPolicy*> policies;
+      /*! Instances of a full policy, when admitting a request */
+      static std::vector<PolicyInstance> candidates;
+      static int totalVoices;                 /**< Voices at voicePool */
+
+      static bool useEvents;            /**< If should use AL events */
+      static bool eventDriven;          /**< If using AL events now */
+      static bool pollAll;              /**< Update all at this flush */
+      static MpscQueue<ALuint> events;  /**< Sources got by onEvent */
+      static std::atomic<bool> eventsOverflow; /**< If events were lost */
+      /*! Sources with events to process at this flush (sorted) */
+      static std::vector<ALuint> eventSources;
+      /*! Sound effects of sndList by source (sorted), for the events */
+      static std::vector<StreamSource> streamSources;
+      /*! Their update deadlines (a heap: earliest at front) */
+      static std::vector<StreamDeadline> deadlines;
+
+      static DecodePool* decodePool;          /**< Parallel decode, if any */
+      static std::vector<DecodeJob> decodeJobs; /**< Jobs of the flush */
+      static unsigned long decodeBudget; /**< Per flush (us), 0 for none */
+      static DecodeBudgetStats budgetStats; /**< Decode budget stats */
 };
    
 }
@@ -0,0 +1,213 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "soundasset.h"
+#include "sndfx.h"
+#include "pcmcodec.h"
+#include "openalext.h"
+#include <kobold/log.h>
+
+using namespace Kosound;
+
+/*************************************************************************
+ *                             Constructor                               *
+ *************************************************************************/
+SoundAsset::SoundAsset(SoundAssetId id, const Kobold::String& fileName)
+{
+   this->id = id;
+   this->fileName = fileName;
+   this->buffer = 0;
+   this->loaded = false;
+   this->duration = 0.0;
+   this->encoding = ENCODING_PCM16;
+   this->size = 0;
+   this->format = AL_FORMAT_MONO16;
+   this->frequency = 0;
+   this->policy = NULL;
+   this->bus = NULL;
+}
+
+/*************************************************************************
+ *                              Destructor                               *
+ *************************************************************************/
+SoundAsset::~SoundAsset()
+{
+   clearIdleEffects();
+   if(loaded)
+   {
+      alDeleteBuffers(1, &buffer);
+   }
+}
+
+/*************************************************************************
+ *                                 load                                  *
+ *************************************************************************/
+bool SoundAsset::load(Kobold::FileReader* fileReader, bool keepData,
+      bool mono, Encoding encoding)
+{
+   std::vector<char> pcm;
+   SoundStream* stream;
+   size_t frames;
+   int channels;
+   bool res;
+
+   stream = SndFx::createStream(fileName, fileReader);
+   if(stream == NULL)
+   {
+      return false;
+   }
+
+   /* Just decode it, to encode (or not) and upload here */
+   stream->setDownmix(mono);
+   res = stream->load(fileName, 0, &pcm);
+   format = stream->getFormat();
+   frequency = stream->getSampleRate();
+   delete stream;
+
+   if( (!res) || (frequency <= 0) )
+   {
+      return false;
+   }
+
+   channels = (format == AL_FORMAT_STEREO16) ? 2 : 1;
+   frames = pcm.size() / (2 * channels);
+   duration = frames / (double)frequency;
+
+   /* Encode it, if supported by the current OpenAL */
+   this->encoding = ENCODING_PCM16;
+#ifdef AL_EXT_IMA4
+   if( (encoding == ENCODING_IMA4) && (OpenALExt::hasIma4()) )
+   {
+      PcmCodec::encodeIma4((const int16_t*)&pcm[0], frames, channels, 
+            data);
+      format = (channels == 2) ? AL_FORMAT_STEREO_IMA4 : 
+                                 AL_FORMAT_MONO_IMA4;
+      this->encoding = ENCODING_IMA4;
+   }
+#endif
+#ifdef AL_EXT_MULAW
+   if( (encoding != ENCODING_PCM16) && 
+       (this->encoding == ENCODING_PCM16) && (OpenALExt::hasMulaw()) )
+   {
+      /* Mu-law is also the fallback of an unsupported IMA4 */
+      PcmCodec::encodeMulaw((const int16_t*)&pcm[0], frames * channels,
+            data);
+      format = (channels == 2) ? AL_FORMAT_STEREO_MULAW : 
+                                 AL_FORMAT_MONO_MULAW;
+      this->encoding = ENCODING_MULAW;
+   }
+#endif
+   if(this->encoding == ENCODING_PCM16)
+   {
+      if(encoding != ENCODING_PCM16)
+      {
+         Kobold::Log::add(Kobold::LOG_LEVEL_NORMAL,
+               "SoundAsset: no compressed buffer support, '%s' kept as "
+               "16-bit PCM", fileName.c_str());
+      }
+      data.swap(pcm);
+   }
+
+   alGenBuffers(1, &buffer);
+   alBufferData(buffer, format, &data[0], data.size(), frequency);
+   loaded = true;
+   size = data.size();
+
+   if(!keepData)
+   {
+      /* Only needed to reload */
+      std::vector<char>().swap(data);
+   }
+
+   return true;
+}
+
+/*************************************************************************
+ *                                unload                                 *
+ *************************************************************************/
+void SoundAsset::unload()
+{
+   /* Their AL objects are at the current device too */
+   clearIdleEffects();
+   if(loaded)
+   {
+      alDeleteBuffers(1, &buffer);
+      buffer = 0;
+      loaded = false;
+   }
+}
+
+/*************************************************************************
+ *                                reload                                 *
+ *************************************************************************/
+bool SoundAsset::reload()
+{
+   if(data.empty())
+   {
+      return false;
+   }
+
+   unload();
+   alGenBuffers(1, &buffer);
+   alBufferData(buffer, format, &data[0], data.size(), frequency);
+   loaded = true;
+
+   return true;
+}
+
+
+/*************************************************************************
+ *                            takeIdleEffect                             *
+ *************************************************************************/
+SndFx* SoundAsset::takeIdleEffect()
+{
+   SndFx* snd;
+
+   if(idleEffects.empty())
+   {
+      return NULL;
+   }
+
+   snd = idleEffects.back();
+   idleEffects.pop_back();
+   return snd;
+}
+
+/*************************************************************************
+ *                            putIdleEffect                              *
+ *************************************************************************/
+void SoundAsset::putIdleEffect(SndFx* snd)
+{
+   idleEffects.push_back(snd);
+}
+
+/*************************************************************************
+ *                           clearIdleEffects                            *
+ *************************************************************************/
+void SoundAsset::clearIdleEffects()
+{
+   size_t i;
+
+   for(i = 0; i < idleEffects.size(); i++)
+   {
+      delete idleEffects[i];
+   }
+   idleEffects.clear();
+}
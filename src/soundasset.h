@@ -0,0 +1,175 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kosound_sound_asset_h
+#define _kosound_sound_asset_h
+
+#include "kosoundconfig.h"
+#include <kobold/platform.h>
+#include <kobold/kstring.h>
+#include <kobold/filereader.h>
+
+#include <vector>
+
+#if KOBOLD_PLATFORM == KOBOLD_PLATFORM_IOS || \
+    KOBOLD_PLATFORM == KOBOLD_PLATFORM_MACOS
+   #include <OpenAL/al.h>
+#else
+   #include <AL/al.h>
+#endif
+
+namespace Kosound
+{
+
+class SoundPolicy;
+class SoundBus;
+class SndFx;
+
+/*! Identifier of a registered SoundAsset */
+typedef unsigned int SoundAssetId;
+
+#define SOUND_INVALID_ASSET  0
+
+/*! A sound registered to be played as one-shots (see Sound::playOneShot):
+ * its file is decoded once, at registration, to an AL buffer shared by
+ * all of its plays. When its decoded PCM is kept, it could also be played
+ * as sound effects streamed from it (see AssetStream), which are kept
+ * here when removed, to be recycled by its next plays. */
+class SoundAsset
+{
+   public:
+      /*! How its decoded samples are kept at its AL buffer */
+      enum Encoding
+      {
+         /*! As decoded: 16-bit PCM */
+         ENCODING_PCM16=0,
+         /*! G.711 mu-law, at half the size (needs AL_EXT_MULAW) */
+         ENCODING_MULAW,
+         /*! IMA ADPCM, at about a quarter of the size (needs 
+          * AL_EXT_IMA4) */
+         ENCODING_IMA4
+      };
+
+      /*! Constructor
+       * \param id -> identifier of the asset
+       * \param fileName -> its file name */
+      SoundAsset(SoundAssetId id, const Kobold::String& fileName);
+      /*! Destructor: delete its buffer and idle sound effects (must not
+       * be in use anymore) */
+      ~SoundAsset();
+
+      /*! Load the asset, decoding its whole file.
+       * \param fileReader -> FileReader to use. Will be deleted here.
+       * \param keepData -> if will keep its decoded data in memory, to 
+       *                    be able to reload it (see reload).
+       * \param mono -> if a stereo file is downmixed to mono (needed to 
+       *                be positioned), halving its memory.
+       * \param encoding -> how to keep its samples. When the current 
+       *                    OpenAL can't play it, 16-bit PCM is used.
+       * \return true if loaded */
+      bool load(Kobold::FileReader* fileReader, bool keepData=false,
+            bool mono=false, Encoding encoding=ENCODING_PCM16);
+
+      /*! Delete its AL buffer and idle sound effects (as before closing 
+       * the device), but not its kept decoded data, if any. */
+      void unload();
+
+      /*! Create again its AL buffer (at the now current device), from 
+       * its kept decoded data, without reading its file again.
+       * \return false if no data was kept */
+      bool reload();
+
+      /*! \return its identifier */
+      SoundAssetId getId() const { return id; };
+
+      /*! \return its file name */
+      const Kobold::String& getFileName() const { return fileName; };
+
+      /*! \return AL buffer with its decoded data */
+      ALuint getBuffer() const { return buffer; };
+
+      /*! \return its duration, in seconds */
+      double getDuration() const { return duration; };
+
+      /*! \return how its samples are kept (after load) */
+      Encoding getEncoding() const { return encoding; };
+
+      /*! \return size, in bytes, of its buffer data */
+      size_t getSize() const { return size; };
+
+      /*! \return OpenAL format of its buffer data */
+      ALenum getFormat() const { return format; };
+
+      /*! \return sample rate of its buffer data */
+      ALsizei getFrequency() const { return frequency; };
+
+      /*! \return its kept data (empty if not kept) */
+      const std::vector<char>& getData() const { return data; };
+
+      /*! \return if its decoded 16-bit PCM is kept, so it could be 
+       * streamed as sound effects (see AssetStream) */
+      bool hasPcm() const 
+      { 
+         return (encoding == ENCODING_PCM16) && (!data.empty()); 
+      };
+
+      /*! Take one of its idle sound effects, to play it again
+       * \return a stopped sound effect of the asset, or NULL if none */
+      SndFx* takeIdleEffect();
+
+      /*! Keep a stopped sound effect of the asset, to be recycled
+       * \param snd -> sound effect (see SndFx::recycle) */
+      void putIdleEffect(SndFx* snd);
+
+      /*! Set the bus its one-shots play at */
+      void setBus(SoundBus* bus) { this->bus = bus; };
+
+      /*! \return the bus its one-shots play at */
+      SoundBus* getBus() const { return bus; };
+
+      /*! Set the playback limits of its file (NULL for none) */
+      void setPolicy(SoundPolicy* policy) { this->policy = policy; };
+
+      /*! \return playback limits of its file, if any */
+      SoundPolicy* getPolicy() const { return policy; };
+
+   private:
+      SoundAssetId id;          /**< Its identifier */
+      Kobold::String fileName;  /**< File loaded */
+      ALuint buffer;            /**< Decoded data */
+      bool loaded;              /**< If buffer was created */
+      double duration;          /**< Duration, in seconds */
+      Encoding encoding;        /**< How its samples are kept */
+      size_t size;              /**< Size of its buffer data */
+      std::vector<char> data;   /**< Kept decoded data, if any */
+      ALenum format;            /**< Format of its buffer data */
+      ALsizei frequency;        /**< Sample rate of its buffer data */
+      SoundPolicy* policy;      /**< Limits of its file, if any */
+      SoundBus* bus;            /**< Bus of its one-shots */
+      std::vector<SndFx*> idleEffects; /**< Recycled sound effects */
+
+      /*! Delete all its idle sound effects */
+      void clearIdleEffects();
+};
+
+}
+
+#endif
+
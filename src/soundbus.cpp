@@ -0,0 +1,225 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "soundbus.h"
+
+#include <algorithm>
+
+using namespace Kosound;
+
+/*************************************************************************
+ *                       SoundBusMember Constructor                      *
+ *************************************************************************/
+SoundBusMember::SoundBusMember()
+{
+   bus = NULL;
+   busIndex = 0;
+}
+
+/*************************************************************************
+ *                       SoundBusMember Destructor                       *
+ *************************************************************************/
+SoundBusMember::~SoundBusMember()
+{
+   if(bus != NULL)
+   {
+      bus->removeMember(this);
+   }
+}
+
+/*************************************************************************
+ *                                setBus                                 *
+ *************************************************************************/
+void SoundBusMember::setBus(SoundBus* bus)
+{
+   if(this->bus != bus)
+   {
+      if(this->bus != NULL)
+      {
+         this->bus->removeMember(this);
+      }
+      if(bus != NULL)
+      {
+         bus->addMember(this);
+      }
+   }
+   applyBusGain(getBusGain());
+}
+
+/*************************************************************************
+ *                              getBusGain                               *
+ *************************************************************************/
+ALfloat SoundBusMember::getBusGain() const
+{
+   return (bus != NULL) ? bus->getEffectiveGain() : 1.0f;
+}
+
+/*************************************************************************
+ *                         SoundBus Constructor                          *
+ *************************************************************************/
+SoundBus::SoundBus(const Kobold::String& name, SoundBus* parent)
+{
+   this->name = name;
+   this->parent = parent;
+   gain = 1.0f;
+   effectiveGain = (parent != NULL) ? parent->getEffectiveGain() : 1.0f;
+   version = 0;
+   dirty = false;
+   childDirty = false;
+
+   if(parent != NULL)
+   {
+      parent->children.push_back(this);
+   }
+}
+
+/*************************************************************************
+ *                          SoundBus Destructor                          *
+ *************************************************************************/
+SoundBus::~SoundBus()
+{
+   size_t i;
+   std::vector<SoundBus*>::iterator it;
+
+   for(i = 0; i < members.size(); i++)
+   {
+      members[i]->bus = NULL;
+   }
+   for(i = 0; i < children.size(); i++)
+   {
+      children[i]->parent = NULL;
+   }
+   if(parent != NULL)
+   {
+      it = std::find(parent->children.begin(), parent->children.end(), this);
+      if(it != parent->children.end())
+      {
+         parent->children.erase(it);
+      }
+   }
+}
+
+/*************************************************************************
+ *                                setGain                                *
+ *************************************************************************/
+void SoundBus::setGain(ALfloat gain)
+{
+   if(gain != this->gain)
+   {
+      this->gain = gain;
+      dirty = true;
+      if(parent != NULL)
+      {
+         parent->markDirty();
+      }
+   }
+}
+
+/*************************************************************************
+ *                               markDirty                               *
+ *************************************************************************/
+void SoundBus::markDirty()
+{
+   SoundBus* bus = this;
+
+   /* Stop at the first already marked */
+   while( (bus != NULL) && (!bus->childDirty) )
+   {
+      bus->childDirty = true;
+      bus = bus->parent;
+   }
+}
+
+/*************************************************************************
+ *                                update                                 *
+ *************************************************************************/
+void SoundBus::update()
+{
+   update(false);
+}
+
+/*************************************************************************
+ *                                update                                 *
+ *************************************************************************/
+void SoundBus::update(bool parentChanged)
+{
+   bool changed = (dirty) || (parentChanged);
+   ALfloat newGain;
+   size_t i;
+
+   if(changed)
+   {
+      newGain = gain * ((parent != NULL) ? parent->effectiveGain : 1.0f);
+      if(newGain != effectiveGain)
+      {
+         effectiveGain = newGain;
+         version++;
+         for(i = 0; i < members.size(); i++)
+         {
+            members[i]->applyBusGain(effectiveGain);
+         }
+      }
+      else
+      {
+         /* Nothing changed for the subtree */
+         changed = false;
+      }
+   }
+
+   /* Only visit the subtrees needing it */
+   if( (changed) || (childDirty) )
+   {
+      for(i = 0; i < children.size(); i++)
+      {
+         if( (changed) || (children[i]->needsUpdate()) )
+         {
+            children[i]->update(changed);
+         }
+      }
+   }
+
+   dirty = false;
+   childDirty = false;
+}
+
+/*************************************************************************
+ *                               addMember                               *
+ *************************************************************************/
+void SoundBus::addMember(SoundBusMember* member)
+{
+   member->bus = this;
+   member->busIndex = members.size();
+   members.push_back(member);
+}
+
+/*************************************************************************
+ *                             removeMember                              *
+ *************************************************************************/
+void SoundBus::removeMember(SoundBusMember* member)
+{
+   size_t index = member->busIndex;
+
+   /* Swap with the last one */
+   members[index] = members.back();
+   members[index]->busIndex = index;
+   members.pop_back();
+   member->bus = NULL;
+}
+
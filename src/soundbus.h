@@ -0,0 +1,146 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kosound_sound_bus_h
+#define _kosound_sound_bus_h
+
+#include "kosoundconfig.h"
+#include <kobold/platform.h>
+#include <kobold/kstring.h>
+
+#if KOBOLD_PLATFORM == KOBOLD_PLATFORM_IOS || \
+    KOBOLD_PLATFORM == KOBOLD_PLATFORM_MACOS
+   #include <OpenAL/al.h>
+#else
+   #include <AL/al.h>
+#endif
+
+#include <vector>
+
+namespace Kosound
+{
+
+/* Names of the default buses */
+#define KOSOUND_BUS_MASTER  "master"
+#define KOSOUND_BUS_MUSIC   "music"
+#define KOSOUND_BUS_SFX     "sfx"
+#define KOSOUND_BUS_VOICE   "voice"
+#define KOSOUND_BUS_UI      "ui"
+
+class SoundBus;
+
+/*! Something whose gain is controlled by a SoundBus */
+class SoundBusMember
+{
+   public:
+      /*! Constructor: without bus */
+      SoundBusMember();
+      /*! Destructor: leave its bus */
+      virtual ~SoundBusMember();
+
+      /*! Move to a bus, applying its gain
+       * \param bus -> new bus, or NULL for none */
+      void setBus(SoundBus* bus);
+
+      /*! \return its bus, if any */
+      SoundBus* getBus() const { return bus; };
+
+      /*! \return current effective gain of its bus (1 if none) */
+      ALfloat getBusGain() const;
+
+      /*! Apply a new effective gain of its bus */
+      virtual void applyBusGain(ALfloat busGain)=0;
+
+   private:
+      friend class SoundBus;
+
+      SoundBus* bus;      /**< Its bus */
+      size_t busIndex;    /**< Its index at the bus members */
+};
+
+/*! A node of the mix bus tree (master -> music, sfx, voice, ui -> any
+ * user defined subgroup). The gain heard from a bus is its own gain
+ * times its parent effective gain. Changing a gain only marks the bus as
+ * dirty: effective gains are recomputed and applied to the members of
+ * the changed subtrees, and just to those, at the next Sound::flush(). */
+class SoundBus
+{
+   public:
+      /*! Constructor
+       * \param name -> bus name
+       * \param parent -> its parent, or NULL if the root */
+      SoundBus(const Kobold::String& name, SoundBus* parent);
+      /*! Destructor: its members are left without a bus */
+      ~SoundBus();
+
+      /*! \return its name */
+      const Kobold::String& getName() const { return name; };
+
+      /*! \return its parent, or NULL if the root */
+      SoundBus* getParent() const { return parent; };
+
+      /*! Define its own gain (applied only at the next update)
+       * \param gain -> new gain [0, 1] */
+      void setGain(ALfloat gain);
+
+      /*! \return its own gain */
+      ALfloat getGain() const { return gain; };
+
+      /*! \return gain heard from it, as of the last update */
+      ALfloat getEffectiveGain() const { return effectiveGain; };
+
+      /*! \return incremented each time its effective gain changes */
+      unsigned long getVersion() const { return version; };
+
+      /*! \return if it or some descendant has a changed gain */
+      bool needsUpdate() const { return (dirty) || (childDirty); };
+
+      /*! Recompute effective gains of the changed subtrees, applying
+       * them to their members. Usually called on the root. */
+      void update();
+
+   private:
+      friend class SoundBusMember;
+
+      /*! Update, knowing if the parent effective gain changed */
+      void update(bool parentChanged);
+
+      /*! Mark it, and all its ancestors, as needing update */
+      void markDirty();
+
+      void addMember(SoundBusMember* member);
+      void removeMember(SoundBusMember* member);
+
+      Kobold::String name;             /**< Its name */
+      SoundBus* parent;                /**< Parent bus */
+      std::vector<SoundBus*> children; /**< Its subgroups */
+      std::vector<SoundBusMember*> members; /**< Controlled members */
+
+      ALfloat gain;           /**< Own gain */
+      ALfloat effectiveGain;  /**< Gain times parents ones */
+      unsigned long version;  /**< Changes of effectiveGain */
+      bool dirty;             /**< If own gain changed */
+      bool childDirty;        /**< If some descendant is dirty */
+};
+
+}
+
+#endif
+
@@ -0,0 +1,80 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kosound_sound_command_h
+#define _kosound_sound_command_h
+
+#include <kobold/platform.h>
+#include <kobold/kstring.h>
+#include <kobold/filereader.h>
+
+#if KOBOLD_PLATFORM == KOBOLD_PLATFORM_IOS || \
+    KOBOLD_PLATFORM == KOBOLD_PLATFORM_MACOS
+   #include <OpenAL/al.h>
+#else
+   #include <AL/al.h>
+#endif
+
+namespace Kosound
+{
+
+/*! Handle to a sound effect posted from any thread. It's valid as soon as
+ * it's returned by the post, even before its sound is really created. */
+typedef unsigned int SoundHandle;
+
+#define SOUND_INVALID_HANDLE  0
+
+/*! A command posted to Sound from any thread, to be executed later by the
+ * thread calling Sound::flush(). */
+class SoundCommand
+{
+   public:
+      enum CommandType
+      {
+         /*! Create and play a sound effect (handle, loop, fileName,
+          * fileReader and, if positional, x, y, z) */
+         COMMAND_PLAY=0,
+         /*! Stop and remove a sound effect (handle) */
+         COMMAND_STOP,
+         /*! Redefine sound effect position (handle, x, y, z) */
+         COMMAND_MOVE,
+         /*! Change overall volumes (music, sndfx) */
+         COMMAND_VOLUME,
+         /*! Load and play a music (fileName, fileReader) */
+         COMMAND_MUSIC
+      };
+
+      CommandType type;     /**< The command */
+      SoundHandle handle;   /**< Target sound effect */
+      bool positional;      /**< If COMMAND_PLAY is positional */
+      ALfloat x;            /**< X position */
+      ALfloat y;            /**< Y position */
+      ALfloat z;            /**< Z position */
+      int loop;             /**< Loop interval */
+      int music;            /**< Music volume */
+      int sndfx;            /**< Sound effects volume */
+      Kobold::String fileName;          /**< File to play */
+      Kobold::FileReader* fileReader;   /**< Reader of the file */
+};
+
+}
+
+#endif
+
@@ -0,0 +1,211 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "soundemitter.h"
+
+#include <math.h>
+#include <algorithm>
+
+using namespace Kosound;
+
+/* Bits of each cell coordinate at a key */
+#define KOSOUND_CELL_BITS  21
+#define KOSOUND_CELL_MASK  ((1ull << KOSOUND_CELL_BITS) - 1)
+
+/*************************************************************************
+ *                             EmitterReader                             *
+ *************************************************************************/
+EmitterReader::EmitterReader(Kobold::FileReader* reader)
+{
+   this->reader = reader;
+}
+
+/*************************************************************************
+ *                            ~EmitterReader                             *
+ *************************************************************************/
+EmitterReader::~EmitterReader()
+{
+   /* Not ours: kept by its emitter */
+}
+
+/*************************************************************************
+ *                                 open                                  *
+ *************************************************************************/
+bool EmitterReader::open(const Kobold::String& fileName)
+{
+   return reader->open(fileName);
+}
+
+/*************************************************************************
+ *                                 close                                 *
+ *************************************************************************/
+void EmitterReader::close()
+{
+   reader->close();
+}
+
+/*************************************************************************
+ *                                  eof                                  *
+ *************************************************************************/
+bool EmitterReader::eof()
+{
+   return reader->eof();
+}
+
+/*************************************************************************
+ *                                 read                                  *
+ *************************************************************************/
+size_t EmitterReader::read(char* buffer, size_t size)
+{
+   return reader->read(buffer, size);
+}
+
+/*************************************************************************
+ *                                 seek                                  *
+ *************************************************************************/
+void EmitterReader::seek(size_t offset)
+{
+   reader->seek(offset);
+}
+
+/*************************************************************************
+ *                                 tell                                  *
+ *************************************************************************/
+size_t EmitterReader::tell()
+{
+   return reader->tell();
+}
+
+/*************************************************************************
+ *                              EmitterGrid                              *
+ *************************************************************************/
+EmitterGrid::EmitterGrid(ALfloat cellSize)
+{
+   this->cellSize = cellSize;
+}
+
+/*************************************************************************
+ *                                getCell                                *
+ *************************************************************************/
+int32_t EmitterGrid::getCell(ALfloat coord)
+{
+   return (int32_t)floorf(coord / cellSize);
+}
+
+/*************************************************************************
+ *                                getKey                                 *
+ *************************************************************************/
+uint64_t EmitterGrid::getKey(int32_t cx, int32_t cy, int32_t cz)
+{
+   /* Each coordinate wraps at 2^21 cells: far enough for any world */
+   return ( ((uint64_t)cx & KOSOUND_CELL_MASK) << (2 * KOSOUND_CELL_BITS) ) |
+          ( ((uint64_t)cy & KOSOUND_CELL_MASK) << KOSOUND_CELL_BITS ) |
+          ( (uint64_t)cz & KOSOUND_CELL_MASK );
+}
+
+/*************************************************************************
+ *                                insert                                 *
+ *************************************************************************/
+void EmitterGrid::insert(EmitterId id, ALfloat x, ALfloat y, ALfloat z)
+{
+   cells[getKey(getCell(x), getCell(y), getCell(z))].push_back(id);
+}
+
+/*************************************************************************
+ *                                remove                                 *
+ *************************************************************************/
+void EmitterGrid::remove(EmitterId id, ALfloat x, ALfloat y, ALfloat z)
+{
+   std::unordered_map<uint64_t, std::vector<EmitterId> >::iterator it;
+   std::vector<EmitterId>::iterator pos;
+
+   it = cells.find(getKey(getCell(x), getCell(y), getCell(z)));
+   if(it == cells.end())
+   {
+      return;
+   }
+
+   pos = std::find(it->second.begin(), it->second.end(), id);
+   if(pos != it->second.end())
+   {
+      /* Order at the cell doesn't matter. An emptied cell is kept, so
+       * emitters moving around don't allocate it again. */
+      *pos = it->second.back();
+      it->second.pop_back();
+   }
+}
+
+/*************************************************************************
+ *                                 move                                  *
+ *************************************************************************/
+void EmitterGrid::move(EmitterId id, ALfloat fromX, ALfloat fromY, 
+      ALfloat fromZ, ALfloat toX, ALfloat toY, ALfloat toZ)
+{
+   if( (getCell(fromX) != getCell(toX)) || (getCell(fromY) != getCell(toY)) ||
+       (getCell(fromZ) != getCell(toZ)) )
+   {
+      remove(id, fromX, fromY, fromZ);
+      insert(id, toX, toY, toZ);
+   }
+}
+
+/*************************************************************************
+ *                                 query                                 *
+ *************************************************************************/
+void EmitterGrid::query(ALfloat x, ALfloat y, ALfloat z, ALfloat radius,
+      std::vector<EmitterId>& result)
+{
+   std::unordered_map<uint64_t, std::vector<EmitterId> >::iterator it;
+   int32_t minX = getCell(x - radius), maxX = getCell(x + radius);
+   int32_t minY = getCell(y - radius), maxY = getCell(y + radius);
+   int32_t minZ = getCell(z - radius), maxZ = getCell(z + radius);
+   int32_t cx, cy, cz;
+
+   result.clear();
+   if(cells.empty())
+   {
+      return;
+   }
+
+   for(cx = minX; cx <= maxX; cx++)
+   {
+      for(cy = minY; cy <= maxY; cy++)
+      {
+         for(cz = minZ; cz <= maxZ; cz++)
+         {
+            it = cells.find(getKey(cx, cy, cz));
+            if(it != cells.end())
+            {
+               result.insert(result.end(), it->second.begin(), 
+                     it->second.end());
+            }
+         }
+      }
+   }
+}
+
+/*************************************************************************
+ *                                 clear                                 *
+ *************************************************************************/
+void EmitterGrid::clear()
+{
+   cells.clear();
+}
+
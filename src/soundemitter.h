@@ -0,0 +1,181 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kosound_sound_emitter_h
+#define _kosound_sound_emitter_h
+
+#include "kosoundconfig.h"
+#include <kobold/platform.h>
+#include <kobold/kstring.h>
+#include <kobold/filereader.h>
+
+#if KOBOLD_PLATFORM == KOBOLD_PLATFORM_IOS || \
+    KOBOLD_PLATFORM == KOBOLD_PLATFORM_MACOS
+   #include <OpenAL/al.h>
+#else
+   #include <AL/al.h>
+#endif
+
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+namespace Kosound
+{
+
+class SndFx;
+
+/*! Identifier of an emitter. Invalid after its removal. */
+typedef unsigned int EmitterId;
+
+#define SOUND_INVALID_EMITTER  0
+
+/*! Default audible range of an emitter. With the sound effects
+ * reference distance (160) and rolloff (1), AL_EXPONENT_DISTANCE is 
+ * already at 1/20 of its gain (-26 dB) there. */
+#define KOSOUND_DEFAULT_EMITTER_RANGE      3200.0f
+/*! Emitters are only released past this factor of their range, so one
+ * near its range limit isn't created and released at each move */
+#define KOSOUND_EMITTER_HYSTERESIS         1.1f
+/*! Default cell size of the emitters grid */
+#define KOSOUND_DEFAULT_EMITTER_CELL_SIZE  4096.0f
+/*! Min listener move to check the emitters again */
+#define KOSOUND_EMITTER_CULL_DISTANCE      16.0f
+/*! Default max emitters with a SndFx at once */
+#define KOSOUND_DEFAULT_EMITTER_VOICES     32
+/*! Advantage of an emitter already created over the ones that would 
+ * replace it, so two about as loud don't keep replacing each other */
+#define KOSOUND_EMITTER_KEEP_FACTOR        1.25f
+
+/*! A FileReader just forwarding to another one, without owning it: each
+ * instance of an emitter is created with one of those, as its stream 
+ * deletes the reader it got, but the emitter must keep its own. */
+class EmitterReader: public Kobold::FileReader
+{
+   public:
+      /*! Constructor
+       * \param reader -> reader to forward to. Not deleted here. */
+      EmitterReader(Kobold::FileReader* reader);
+      /*! Destructor */
+      ~EmitterReader();
+
+      bool open(const Kobold::String& fileName);
+      void close();
+      bool eof();
+      size_t read(char* buffer, size_t size);
+      void seek(size_t offset);
+      size_t tell();
+
+   private:
+      Kobold::FileReader* reader; /**< Reader forwarded to */
+};
+
+/*! A positional looping (or not) sound placed on the world. It's just
+ * its file until the listener gets inside its range (and it's among the
+ * loudest ones), when a SndFx is created for it. Out of range again, 
+ * the SndFx is released, keeping the emitter virtual: its playback time
+ * still runs, so it continues where it would be if created again. Its
+ * spatial parameters are kept apart, as structure of arrays (see 
+ * SpatialParams), to be scored at once. */
+class SoundEmitter
+{
+   public:
+      int loop;         /**< Loop interval (see SndFx::setLoop) */
+      ALfloat innerAngle; /**< Cone inner angle, if directional */
+      ALfloat outerAngle; /**< Cone outer angle, if directional */
+      Kobold::String fileName;        /**< Its sound file */
+      Kobold::FileReader* fileReader; /**< Reader of its file (owned) */
+      SndFx* sndFx;     /**< Its sound effect, if created (not virtual) */
+      double time;      /**< Playback position when made virtual */
+      unsigned long virtualSince; /**< Sound clock time made virtual */
+      bool used;        /**< If its slot is in use */
+      bool done;        /**< If not looping and already ended */
+      bool selected;    /**< If among the loudest, at the current check */
+};
+
+/*! Estimated gain of an emitter, to select the loudest ones */
+class EmitterScore
+{
+   public:
+      ALfloat score;    /**< Its estimated gain */
+      EmitterId id;     /**< The emitter */
+
+      /*! Compare by score (loudest first) */
+      bool operator<(const EmitterScore& other) const
+      {
+         return score > other.score;
+      };
+};
+
+/*! A uniform grid of emitter positions, as a hash of its non-empty 
+ * cells, so the ones near the listener are found without visiting all 
+ * the emitters of the world. */
+class EmitterGrid
+{
+   public:
+      /*! Constructor
+       * \param cellSize -> size of each (cubic) cell */
+      EmitterGrid(ALfloat cellSize);
+
+      /*! Define the size of the cells. Must be done when empty. */
+      void setCellSize(ALfloat size) { cellSize = size; };
+
+      /*! \return size of each cell */
+      ALfloat getCellSize() const { return cellSize; };
+
+      /*! Insert an emitter at a position */
+      void insert(EmitterId id, ALfloat x, ALfloat y, ALfloat z);
+
+      /*! Remove an emitter inserted at a position */
+      void remove(EmitterId id, ALfloat x, ALfloat y, ALfloat z);
+
+      /*! Move an emitter from a position to another */
+      void move(EmitterId id, ALfloat fromX, ALfloat fromY, ALfloat fromZ,
+            ALfloat toX, ALfloat toY, ALfloat toZ);
+
+      /*! Get the emitters of all cells touched by a sphere (so some 
+       * could be a bit outside it).
+       * \param x -> X center of the sphere
+       * \param y -> Y center of the sphere
+       * \param z -> Z center of the sphere
+       * \param radius -> radius of the sphere
+       * \param result -> cleared and filled with the emitters found */
+      void query(ALfloat x, ALfloat y, ALfloat z, ALfloat radius,
+            std::vector<EmitterId>& result);
+
+      /*! Remove all emitters */
+      void clear();
+
+   private:
+      /*! \return cell coordinate of a position coordinate */
+      int32_t getCell(ALfloat coord);
+
+      /*! \return key of a cell */
+      uint64_t getKey(int32_t cx, int32_t cy, int32_t cz);
+
+      ALfloat cellSize;  /**< Size of each cell */
+      /*! Emitters of each non-empty cell, by its key */
+      std::unordered_map<uint64_t, std::vector<EmitterId> > cells;
+};
+
+}
+
+#endif
+
@@ -0,0 +1,94 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "soundpolicy.h"
+
+using namespace Kosound;
+
+/*************************************************************************
+ *                             Constructor                               *
+ *************************************************************************/
+SoundPolicy::SoundPolicy()
+{
+   maxInstances = 0;
+   stealMode = STEAL_NONE;
+   minRetrigger = 0;
+   instances = 0;
+   lastOrder = 0;
+   triggered = false;
+}
+
+/*************************************************************************
+ *                                define                                 *
+ *************************************************************************/
+void SoundPolicy::define(int maxInstances, StealMode mode,
+      unsigned long minRetrigger)
+{
+   this->maxInstances = maxInstances;
+   this->stealMode = mode;
+   this->minRetrigger = minRetrigger;
+}
+
+/*************************************************************************
+ *                             isCoolingDown                             *
+ *************************************************************************/
+bool SoundPolicy::isCoolingDown()
+{
+   return (triggered) && (minRetrigger > 0) &&
+          (triggerTimer.getMilliseconds() < minRetrigger);
+}
+
+/*************************************************************************
+ *                                trigger                                *
+ *************************************************************************/
+void SoundPolicy::trigger()
+{
+   triggered = true;
+   triggerTimer.reset();
+}
+
+/*************************************************************************
+ *                                isFull                                 *
+ *************************************************************************/
+bool SoundPolicy::isFull() const
+{
+   return (maxInstances > 0) && (instances >= maxInstances);
+}
+
+/*************************************************************************
+ *                              addInstance                              *
+ *************************************************************************/
+unsigned long SoundPolicy::addInstance()
+{
+   instances++;
+   return ++lastOrder;
+}
+
+/*************************************************************************
+ *                            removeInstance                             *
+ *************************************************************************/
+void SoundPolicy::removeInstance()
+{
+   if(instances > 0)
+   {
+      instances--;
+   }
+}
+
@@ -0,0 +1,118 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kosound_sound_policy_h
+#define _kosound_sound_policy_h
+
+#include "kosoundconfig.h"
+#include <kobold/platform.h>
+#include <kobold/timer.h>
+
+#if KOBOLD_PLATFORM == KOBOLD_PLATFORM_IOS || \
+    KOBOLD_PLATFORM == KOBOLD_PLATFORM_MACOS
+   #include <OpenAL/al.h>
+#else
+   #include <AL/al.h>
+#endif
+
+namespace Kosound
+{
+
+class SndFx;
+
+/*! Playback limits of a sound file (for both its SndFx streams and its
+ * one-shots): how many instances could play at once, what to do when
+ * another is requested, and the min interval between two requests.
+ * Requests are checked against it before any stream is created. */
+class SoundPolicy
+{
+   public:
+      /*! What to do with a request when maxInstances are playing */
+      enum StealMode
+      {
+         /*! Reject the request */
+         STEAL_NONE=0,
+         /*! Stop the oldest instance, playing the new one */
+         STEAL_OLDEST,
+         /*! Stop the quietest instance (or reject the request, if it
+          * would be the quietest one) */
+         STEAL_QUIETEST,
+         /*! Stop the newest instance, playing the new one */
+         STEAL_NEWEST
+      };
+
+      /*! Constructor: no limits */
+      SoundPolicy();
+
+      /*! Define the limits
+       * \param maxInstances -> max instances at once (0 for no limit)
+       * \param mode -> what to do at a request when at maxInstances
+       * \param minRetrigger -> min milliseconds between two requests
+       *                        (0 for no limit) */
+      void define(int maxInstances, StealMode mode,
+            unsigned long minRetrigger);
+
+      /*! \return if a request now is too soon after the last one */
+      bool isCoolingDown();
+
+      /*! Mark a request as done now */
+      void trigger();
+
+      /*! \return if maxInstances are playing */
+      bool isFull() const;
+
+      /*! Count a new instance
+       * \return its order (greater is newer) */
+      unsigned long addInstance();
+
+      /*! Discount an ended instance */
+      void removeInstance();
+
+      /*! \return number of instances playing */
+      int getInstances() const { return instances; };
+
+      /*! \return current steal mode */
+      StealMode getStealMode() const { return stealMode; };
+
+   private:
+      int maxInstances;            /**< Max at once, 0 for no limit */
+      StealMode stealMode;         /**< Action when at the limit */
+      unsigned long minRetrigger;  /**< Min ms between requests */
+
+      int instances;               /**< Instances playing now */
+      unsigned long lastOrder;     /**< Order of the last instance */
+      bool triggered;              /**< If was ever requested */
+      Kobold::Timer triggerTimer;  /**< Since the last request */
+};
+
+/*! A playing instance of a SoundPolicy, candidate to be stolen */
+class PolicyInstance
+{
+   public:
+      unsigned long order;  /**< Its order (greater is newer) */
+      ALuint source;        /**< AL source playing it */
+      SndFx* sndFx;         /**< The SndFx, if a stream */
+      unsigned int oneShot; /**< The OneShotHandle, if a one-shot */
+};
+
+}
+
+#endif
+
@@ -19,8 +19,13 @@
  */
 
 #include "soundstream.h"
+#include "downmix.h"
+#include "profiler.h"
 #include <kobold/log.h>
 
+#include <string.h>
+#include <vector>
+
 using namespace Kosound;
 
 /***********************************************************************
@@ -29,15 +34,29 @@ using namespace Kosound;
 SoundStream::SoundStream(const SoundStreamType& t, unsigned long bufSize)
 {
    type = t;
+   id = ++lastId;
 
-   bufferSize = bufSize;
-   bufferData = new char[bufferSize];
+   /* Decoded to a scratch of the updating thread: no allocation */
+   bufferSize = (bufSize < KOSOUND_MAX_STREAM_BUFFER_SIZE) ? 
+                bufSize : KOSOUND_MAX_STREAM_BUFFER_SIZE;
    
    sampleRate = 44100;
    format = AL_FORMAT_STEREO16;
 
    opened = false;
    ended = false;
+   downmix = false;
+   mixing = false;
+
+   frontBuffer = 0;
+   frontStart = 0;
+   bufferFrames[0] = 0;
+   bufferFrames[1] = 0;
+   bufferWrap[0] = -1;
+   bufferWrap[1] = -1;
+   silenceBuffer = 0;
+   silenceFrames = 0;
+   preparedBuffers = 0;
 }
 
 /***********************************************************************
@@ -46,7 +65,6 @@ SoundStream::SoundStream(const SoundStreamType& t, unsigned long bufSize)
 SoundStream::~SoundStream()
 {
    release();
-   delete []bufferData;
 }
 
 /*************************************************************************
@@ -54,6 +72,8 @@ SoundStream::~SoundStream()
  *************************************************************************/
 bool SoundStream::open(const Kobold::String& fName)
 {
+   KOSOUND_PROFILE_ZONE("SoundStream::open");
+
    if(opened)
    {
       /* Must avoid double opens */
@@ -66,12 +86,17 @@ bool SoundStream::open(const Kobold::String& fName)
    if(_open(fName, &format, &sampleRate))
    {
       opened = true;
+      mixing = (downmix) && (format == AL_FORMAT_STEREO16);
+      if(mixing)
+      {
+         format = AL_FORMAT_MONO16;
+      }
 
       /* Create the OpenAL Buffers */
       alGenBuffers(2, buffers);
-      check("::open() -> alGenBuffers");
+      check("SoundStream::open() -> alGenBuffers");
       alGenSources(1, &source);
-      check("::open() -> alGenSouces");
+      check("SoundStream::open() -> alGenSouces");
 
       return true;
    }
@@ -79,6 +104,84 @@ bool SoundStream::open(const Kobold::String& fName)
    return false;
 }
 
+/*************************************************************************
+ *                                 load                                  *
+ *************************************************************************/
+bool SoundStream::load(const Kobold::String& fName, ALuint buffer,
+      std::vector<char>* keep)
+{
+   std::vector<char> pcm;
+   const char* data = NULL;
+   unsigned long bytesReaded = 0;
+   size_t cur;
+   bool gotEof = false;
+   bool ok = true;
+
+   KOSOUND_PROFILE_ZONE("SoundStream::load");
+
+   if(opened)
+   {
+      return false;
+   }
+
+   fileName = fName;
+   if(!_open(fName, &format, &sampleRate))
+   {
+      return false;
+   }
+
+   /* Decode it all */
+   while( (ok) && (!gotEof) )
+   {
+      if(_canMapBuffer())
+      {
+         ok = _mapBuffer(bufferSize, &data, &bytesReaded, &gotEof);
+         if(ok)
+         {
+            pcm.insert(pcm.end(), data, data + bytesReaded);
+         }
+      }
+      else
+      {
+         cur = pcm.size();
+         pcm.resize(cur + bufferSize);
+         ok = _getBuffer(&pcm[cur], bufferSize, &bytesReaded, &gotEof);
+         pcm.resize(cur + ((ok) ? bytesReaded : 0));
+      }
+   }
+   _release();
+
+   if( (!ok) || (pcm.empty()) )
+   {
+      Kobold::Log::add(Kobold::LOG_LEVEL_ERROR,
+            "SoundStream::load(): couldn't decode '%s'", fName.c_str());
+      return false;
+   }
+
+   if( (downmix) && (format == AL_FORMAT_STEREO16) )
+   {
+      /* In place, then drop the second half */
+      Downmix::stereoToMono((const int16_t*)&pcm[0], (int16_t*)&pcm[0],
+            pcm.size() / 4);
+      pcm.resize((pcm.size() / 4) * 2);
+      format = AL_FORMAT_MONO16;
+   }
+
+   if(buffer != 0)
+   {
+      KOSOUND_PROFILE_ZONE("alBufferData");
+      alBufferData(buffer, format, &pcm[0], pcm.size(), sampleRate);
+      check("SoundStream::load() alBufferData");
+   }
+
+   if(keep != NULL)
+   {
+      keep->swap(pcm);
+   }
+
+   return true;
+}
+
 /*************************************************************************
  *                             defineAsMusic                             *
  *************************************************************************/
@@ -113,7 +216,7 @@ void SoundStream::release()
       if(!ended)
       {
          alSourceStop(source);
-         check("::release() alSourceStop");
+         check("SoundStream::release() alSourceStop");
       }
       
       /* Empty the remaining buffers */
@@ -121,9 +224,9 @@ void SoundStream::release()
       
       /* Delete Sources And Buffers */
       alDeleteSources(1, &source);
-      check("::release() alDeleteSources");
+      check("SoundStream::release() alDeleteSources");
       alDeleteBuffers(2, &buffers[0]);
-      check("::release() alDeleteBuffers");
+      check("SoundStream::release() alDeleteBuffers");
   
       /* Release internal elements */
       _release();
@@ -136,6 +239,14 @@ void SoundStream::release()
  *                              playBack                                 *
  *************************************************************************/
 bool SoundStream::playback(bool rw)
+{
+   return startPlayback(rw, callerScratch);
+}
+
+/*************************************************************************
+ *                            startPlayback                              *
+ *************************************************************************/
+bool SoundStream::startPlayback(bool rw, char* scratch)
 {
    int numBuffers = 2;
    if(opened)
@@ -149,29 +260,135 @@ bool SoundStream::playback(bool rw)
       {
          /* Must stop Buffer */
          alSourceStop(source);
-         check("::playBack() alSourceStop");
+         check("SoundStream::playBack() alSourceStop");
          empty();
       }
       
-      if(!stream(buffers[0], rw))
+      if(!stream(buffers[0], scratch, rw))
       {
          return false;
       }
       
-      if(!stream(buffers[1]))
+      if(!stream(buffers[1], scratch))
       {
          /* Only needed a single buffer. */
          numBuffers = 1;
       }
       
+      submitMutex.lock();
       alSourceQueueBuffers(source, numBuffers, buffers);
       alSourcePlay(source);
+      submitMutex.unlock();
+      frontBuffer = 0;
       
       return true;
    }
    return false;
 }
 
+/*************************************************************************
+ *                                prepare                                *
+ *************************************************************************/
+bool SoundStream::prepare()
+{
+   if( (!opened) || (isPlaying()) )
+   {
+      return false;
+   }
+
+   empty();
+   if(!stream(buffers[0], callerScratch))
+   {
+      return false;
+   }
+   preparedBuffers = (stream(buffers[1], callerScratch)) ? 2 : 1;
+   frontBuffer = 0;
+
+   return true;
+}
+
+/*************************************************************************
+ *                                enqueue                                *
+ *************************************************************************/
+bool SoundStream::enqueue(double silence)
+{
+   ALuint queue[3];
+   int total = 0;
+   ALint frameSize = (format == AL_FORMAT_MONO16) ? 2 : 4;
+   ALint maxFrames = KOSOUND_MAX_STREAM_BUFFER_SIZE / frameSize;
+   ALint frames = (ALint)(silence * sampleRate);
+
+   if( (!opened) || (preparedBuffers == 0) )
+   {
+      return false;
+   }
+
+   if(frames > 0)
+   {
+      /* Queued before the stream, delaying its start */
+      silenceFrames = (frames < maxFrames) ? frames : maxFrames;
+      memset(callerScratch, 0, silenceFrames * frameSize);
+      alGenBuffers(1, &silenceBuffer);
+      alBufferData(silenceBuffer, format, callerScratch, 
+            silenceFrames * frameSize, sampleRate);
+      check("SoundStream::enqueue() alBufferData");
+      queue[total++] = silenceBuffer;
+   }
+   queue[total++] = buffers[0];
+   if(preparedBuffers > 1)
+   {
+      queue[total++] = buffers[1];
+   }
+   preparedBuffers = 0;
+
+   submitMutex.lock();
+   alSourceQueueBuffers(source, total, queue);
+   check("SoundStream::enqueue() alSourceQueueBuffers");
+   submitMutex.unlock();
+
+   return true;
+}
+
+/*************************************************************************
+ *                                 start                                 *
+ *************************************************************************/
+void SoundStream::start()
+{
+   if(opened)
+   {
+      submitMutex.lock();
+      alSourcePlay(source);
+      submitMutex.unlock();
+   }
+}
+
+/*************************************************************************
+ *                                 stop                                  *
+ *************************************************************************/
+void SoundStream::stop()
+{
+   if(opened)
+   {
+      alSourceStop(source);
+      check("SoundStream::stop() alSourceStop");
+      empty();
+      preparedBuffers = 0;
+   }
+}
+
+/*************************************************************************
+ *                            releaseSilence                             *
+ *************************************************************************/
+void SoundStream::releaseSilence()
+{
+   if(silenceBuffer != 0)
+   {
+      alDeleteBuffers(1, &silenceBuffer);
+      silenceBuffer = 0;
+      silenceFrames = 0;
+   }
+}
+
 /*************************************************************************
  *                               playing                                 *
  *************************************************************************/
@@ -199,13 +416,341 @@ bool SoundStream::rewind()
    return false;
 }
 
+/*************************************************************************
+ *                                 seek                                  *
+ *************************************************************************/
+bool SoundStream::seek(double seconds)
+{
+   ALint state = AL_INITIAL;
+   int64_t frame;
+
+   if( (!opened) || (seconds < 0.0) )
+   {
+      return false;
+   }
+
+   /* Discard anything already queued */
+   alGetSourcei(source, AL_SOURCE_STATE, &state);
+   alSourceStop(source);
+   check("SoundStream::seek() alSourceStop");
+   empty();
+
+   frame = (int64_t)(seconds * sampleRate);
+   if(!_seek(frame))
+   {
+      logError(StreamLog::ERROR_SEEK, (int)(seconds * 1000.0));
+      return false;
+   }
+   ended = false;
+   frontStart = frame;
+
+   if( (state == AL_PLAYING) || (state == AL_PAUSED) )
+   {
+      /* Requeue it from the new position */
+      if(!playback())
+      {
+         return false;
+      }
+      if(state == AL_PAUSED)
+      {
+         /* And keep it paused (as by Sound::suspend) */
+         alSourcePause(source);
+         check("SoundStream::seek() alSourcePause");
+      }
+   }
+
+   return true;
+}
+
+/*************************************************************************
+ *                                resume                                 *
+ *************************************************************************/
+bool SoundStream::resume()
+{
+   ALint state = AL_STOPPED;
+
+   if( (!opened) || (ended) )
+   {
+      return true;
+   }
+
+   alGetSourcei(source, AL_SOURCE_STATE, &state);
+   if(state != AL_STOPPED)
+   {
+      return true;
+   }
+
+   /* Note: offset of a stopped source is lost, so it restarts from its
+    * front buffer start. */
+   return (seek(tell())) && (playback());
+}
+
+/*************************************************************************
+ *                             detachSource                              *
+ *************************************************************************/
+void SoundStream::detachSource(SourceState& state)
+{
+   state.active = false;
+   state.sourceState = AL_INITIAL;
+   if(!opened)
+   {
+      return;
+   }
+
+   alGetSourcefv(source, AL_POSITION, state.position);
+   alGetSourcefv(source, AL_VELOCITY, state.velocity);
+   alGetSourcefv(source, AL_DIRECTION, state.direction);
+   alGetSourcef(source, AL_GAIN, &state.gain);
+   alGetSourcef(source, AL_PITCH, &state.pitch);
+   alGetSourcef(source, AL_REFERENCE_DISTANCE, &state.referenceDistance);
+   alGetSourcef(source, AL_ROLLOFF_FACTOR, &state.rolloff);
+   alGetSourcef(source, AL_CONE_INNER_ANGLE, &state.innerAngle);
+   alGetSourcef(source, AL_CONE_OUTER_ANGLE, &state.outerAngle);
+   alGetSourcei(source, AL_SOURCE_RELATIVE, &state.relative);
+   alGetSourcei(source, AL_SOURCE_STATE, &state.sourceState);
+   state.time = tell();
+   state.active = !ended;
+
+   alSourceStop(source);
+   check("SoundStream::detachSource() alSourceStop");
+   empty();
+   alDeleteSources(1, &source);
+   check("SoundStream::detachSource() alDeleteSources");
+   alDeleteBuffers(2, &buffers[0]);
+   check("SoundStream::detachSource() alDeleteBuffers");
+}
+
+/*************************************************************************
+ *                             attachSource                              *
+ *************************************************************************/
+bool SoundStream::attachSource(const SourceState& state)
+{
+   int64_t frame;
+
+   if(!opened)
+   {
+      return false;
+   }
+
+   alGenBuffers(2, buffers);
+   check("SoundStream::attachSource() -> alGenBuffers");
+   alGenSources(1, &source);
+   check("SoundStream::attachSource() -> alGenSouces");
+
+   alSourcefv(source, AL_POSITION, state.position);
+   alSourcefv(source, AL_VELOCITY, state.velocity);
+   alSourcefv(source, AL_DIRECTION, state.direction);
+   alSourcef(source, AL_GAIN, state.gain);
+   alSourcef(source, AL_PITCH, state.pitch);
+   alSourcef(source, AL_REFERENCE_DISTANCE, state.referenceDistance);
+   alSourcef(source, AL_ROLLOFF_FACTOR, state.rolloff);
+   alSourcef(source, AL_CONE_INNER_ANGLE, state.innerAngle);
+   alSourcef(source, AL_CONE_OUTER_ANGLE, state.outerAngle);
+   alSourcei(source, AL_SOURCE_RELATIVE, state.relative);
+
+   frontBuffer = 0;
+   bufferFrames[0] = 0;
+   bufferFrames[1] = 0;
+   bufferWrap[0] = -1;
+   bufferWrap[1] = -1;
+
+   if(!state.active)
+   {
+      /* Ended (maybe waiting to loop): nothing to play now */
+      return true;
+   }
+
+   /* Continue from where it was, without reopening the file */
+   frame = (int64_t)(state.time * sampleRate);
+   if(!_seek(frame))
+   {
+      if(!_rewind())
+      {
+         return false;
+      }
+      frame = 0;
+   }
+   frontStart = frame;
+
+   if(state.sourceState == AL_INITIAL)
+   {
+      /* Never started: must be prepared again, not played */
+      return true;
+   }
+
+   if(!playback())
+   {
+      return false;
+   }
+   if(state.sourceState == AL_PAUSED)
+   {
+      alSourcePause(source);
+      check("SoundStream::attachSource() alSourcePause");
+   }
+
+   return true;
+}
+
+/*************************************************************************
+ *                                 tell                                  *
+ *************************************************************************/
+double SoundStream::tell()
+{
+   ALint offset = 0;
+   int64_t start = frontStart;
+   int index = frontBuffer;
+   int i;
+
+   if(!opened)
+   {
+      return 0.0;
+   }
+
+   /* The offset is relative to the first still queued buffer */
+   alGetSourcei(source, AL_SAMPLE_OFFSET, &offset);
+   if(silenceBuffer != 0)
+   {
+      /* Leading silence isn't part of the stream */
+      offset -= silenceFrames;
+      if(offset < 0)
+      {
+         return frontStart / (double) sampleRate;
+      }
+   }
+   for(i = 0; i < 2; i++)
+   {
+      if(offset < bufferFrames[index])
+      {
+         if( (bufferWrap[index] >= 0) && (offset >= bufferWrap[index]) )
+         {
+            /* Already looped to the start */
+            return (offset - bufferWrap[index]) / (double) sampleRate;
+         }
+         return (start + offset) / (double) sampleRate;
+      }
+      offset -= bufferFrames[index];
+      start = getBufferEnd(index, start);
+      index = 1 - index;
+   }
+
+   return start / (double) sampleRate;
+}
+
+/*************************************************************************
+ *                             getQueuedTime                             *
+ *************************************************************************/
+double SoundStream::getQueuedTime()
+{
+   ALint queued = 0;
+   ALint offset = 0;
+   int64_t frames = 0;
+   int i;
+
+   if(!opened)
+   {
+      return 0.0;
+   }
+
+   alGetSourcei(source, AL_BUFFERS_QUEUED, &queued);
+   alGetSourcei(source, AL_SAMPLE_OFFSET, &offset);
+   if(silenceBuffer != 0)
+   {
+      /* Leading silence is queued too */
+      frames = silenceFrames;
+      queued--;
+   }
+   for(i = 0; (i < queued) && (i < 2); i++)
+   {
+      frames += bufferFrames[(frontBuffer + i) % 2];
+   }
+   frames -= offset;
+
+   return (frames > 0) ? frames / (double) sampleRate : 0.0;
+}
+
+/*************************************************************************
+ *                            getRefillDelay                             *
+ *************************************************************************/
+double SoundStream::getRefillDelay(double margin)
+{
+   ALint queued = 0;
+   ALint offset = 0;
+   int64_t frames;
+   double front, all;
+
+   if(!opened)
+   {
+      return 0.0;
+   }
+
+   alGetSourcei(source, AL_BUFFERS_QUEUED, &queued);
+   if(queued == 0)
+   {
+      if(isWaitingLoop())
+      {
+         /* Nothing to do until its loop interval ends */
+         all = loopInterval - (loopTimer.getMilliseconds() / 1000.0);
+         return (all > 0.0) ? all : 0.0;
+      }
+      return 0.0;
+   }
+
+   /* Note: offset is from the first queued, even if already processed */
+   alGetSourcei(source, AL_SAMPLE_OFFSET, &offset);
+   if(silenceBuffer != 0)
+   {
+      offset -= silenceFrames;
+      queued--;
+   }
+   frames = bufferFrames[frontBuffer] - offset;
+   front = frames / (double) sampleRate;
+   if(queued > 1)
+   {
+      frames += bufferFrames[1 - frontBuffer];
+   }
+   all = frames / (double) sampleRate - margin;
+
+   all = (all > front) ? all : front;
+   return (all > 0.0) ? all : 0.0;
+}
+
+/*************************************************************************
+ *                            getBufferIndex                             *
+ *************************************************************************/
+int SoundStream::getBufferIndex(ALuint buffer)
+{
+   return (buffer == buffers[0]) ? 0 : 1;
+}
+
+/*************************************************************************
+ *                             getBufferEnd                              *
+ *************************************************************************/
+int64_t SoundStream::getBufferEnd(int index, int64_t start)
+{
+   if(bufferWrap[index] >= 0)
+   {
+      return bufferFrames[index] - bufferWrap[index];
+   }
+   return start + bufferFrames[index];
+}
+
 /*************************************************************************
  *                               update                                  *
  *************************************************************************/
 bool SoundStream::update()
+{
+   return update(callerScratch);
+}
+
+/*************************************************************************
+ *                               update                                  *
+ *************************************************************************/
+bool SoundStream::update(char* scratch)
 {
    int processed;
    bool active = true;
+
+   KOSOUND_PROFILE_ZONE("SoundStream::update");
    
    if(opened)
    {
@@ -220,7 +765,7 @@ bool SoundStream::update()
             if( (int) (loopTimer.getMilliseconds() / 1000) >= loopInterval)
             {
                /* Reinit the play, rewinding the file */
-               active = playback(true);
+               active = startPlayback(true, scratch);
             }
          }
       }
@@ -231,19 +776,33 @@ bool SoundStream::update()
          ALuint buffer;
          
          alSourceUnqueueBuffers(source, 1, &buffer);
-         check("::update() alSourceUnqueueBuffers");
+         check("SoundStream::update() alSourceUnqueueBuffers");
+
+         if(buffer == silenceBuffer)
+         {
+            /* Leading silence played: not a stream buffer */
+            releaseSilence();
+            continue;
+         }
+
+         /* Its playback is done: the next one is now the front */
+         int index = getBufferIndex(buffer);
+         frontStart = getBufferEnd(index, frontStart);
+         frontBuffer = 1 - index;
          
          /* Only stream if active (sometimes the previous buffer already
           * inactive the stream). */
          if(active)
          {
-            active = stream(buffer);
+            active = stream(buffer, scratch);
          
             if( (active) && (!ended))
             {
                /* Only Queue if stream is active, and not waiting */
+               submitMutex.lock();
                alSourceQueueBuffers(source, 1, &buffer);
-               check("::update() alSourceQueueBuffers");
+               check("SoundStream::update() alSourceQueueBuffers");
+               submitMutex.unlock();
             }
          }
       }
@@ -257,17 +816,27 @@ bool SoundStream::update()
 /*************************************************************************
  *                               stream                                  *
  *************************************************************************/
-bool SoundStream::stream(ALuint buffer, bool rw)
+bool SoundStream::stream(ALuint buffer, char* scratch, bool rw)
 {
    bool gotEof = false;
    unsigned long bytesReaded=0;
    unsigned long totalBytesReaded=0;
    unsigned long readBytes;
+   const char* data = NULL;
+   int index = getBufferIndex(buffer);
+   ALint wrap = -1;
+   /* Of the decoded data (stereo, even if downmixing) */
+   ALint frameSize = ( (format == AL_FORMAT_MONO16) && (!mixing) ) ? 2 : 4;
+   ALint frames;
+   bool ok;
+
+   KOSOUND_PROFILE_ZONE("SoundStream::stream");
 
    if(rw)
    {
       /* Must restart the stream */
       ended = false;
+      frontStart = 0;
 
       /* Rewind the file */
       if(!_rewind())
@@ -280,64 +849,130 @@ bool SoundStream::stream(ALuint buffer, bool rw)
       if(isPlaying())
       {
          alSourceStop(source);
-         check("::playBack() alSourceStop");
+         check("SoundStream::playBack() alSourceStop");
       }
       /* Must only wait. Done if no more plays */
       return loopInterval >= 0;
    }
 
-   /* Get the buffer */
-   readBytes = bufferSize;
-
-   while( (totalBytesReaded < bufferSize) && (!ended) )
+   if(_canMapBuffer())
    {
-      if(!_getBuffer(totalBytesReaded, readBytes, &bytesReaded, &gotEof))
+      /* Use directly the decoded data, without any copy */
+      while( (totalBytesReaded == 0) && (!ended) )
       {
-         Kobold::Log::add(Kobold::String("SoundStream::stream(): ") +
-               Kobold::String("Couldn't _getBuffer()."));
-         return false;
+         {
+            KOSOUND_PROFILE_ZONE("SoundStream::_mapBuffer");
+            ok = _mapBuffer(bufferSize, &data, &totalBytesReaded, &gotEof);
+         }
+         if(!ok)
+         {
+            logError(StreamLog::ERROR_MAP_BUFFER);
+            return false;
+         }
+         if( (gotEof) && (loopInterval == 0) )
+         {
+            /* Will loop: next data is from the start */
+            wrap = totalBytesReaded / frameSize;
+         }
+         if( (gotEof) && (!processEof()) )
+         {
+            return false;
+         }
       }
+   }
+   else
+   {
+      /* Get the buffer */
+      data = scratch;
+      readBytes = bufferSize;
 
-      totalBytesReaded += bytesReaded;
-      readBytes = bufferSize - totalBytesReaded;
-      if(gotEof)
+      while( (totalBytesReaded < bufferSize) && (!ended) )
       {
-         if(loopInterval == 0)
          {
-            /* Auto Rewind file */
-            if(!_rewind())
-            {
-               return false;
-            }
+            KOSOUND_PROFILE_ZONE("SoundStream::_getBuffer");
+            ok = _getBuffer(scratch + totalBytesReaded, readBytes, 
+                  &bytesReaded, &gotEof);
          }
-         else if(loopInterval > 0)
+         if(!ok)
          {
-            /* Start timer before reload */
-            ended = true;
-            loopTimer.reset();
+            logError(StreamLog::ERROR_GET_BUFFER);
+            return false;
          }
-         else
+
+         totalBytesReaded += bytesReaded;
+         readBytes = bufferSize - totalBytesReaded;
+         if( (gotEof) && (loopInterval == 0) )
          {
-            /* Never loop */
-            ended = true;
+            /* Will loop: next data is from the start */
+            wrap = totalBytesReaded / frameSize;
+         }
+         if( (gotEof) && (!processEof()) )
+         {
+            return false;
          }
       }
    }
   
    if(totalBytesReaded > 0)
    {
-      alBufferData(buffer, format, bufferData, totalBytesReaded, sampleRate);
-      check("::stream() alBufferData");
+      frames = totalBytesReaded / frameSize;
+      if(mixing)
+      {
+         /* To the scratch (in-place, if not mapped), halving the upload */
+         Downmix::stereoToMono((const int16_t*)data, (int16_t*)scratch,
+               frames);
+         data = scratch;
+         totalBytesReaded = frames * 2;
+      }
+
+      /* Decode is done in parallel, but the submission is serialized */
+      submitMutex.lock();
+      {
+         KOSOUND_PROFILE_ZONE("alBufferData");
+         alBufferData(buffer, format, data, totalBytesReaded, sampleRate);
+      }
+      check("SoundStream::stream() alBufferData");
+      submitMutex.unlock();
+      bufferFrames[index] = frames;
+      bufferWrap[index] = wrap;
    }
    else if(ended)
    {
       alSourceStop(source);
-      check("::playBack() alSourceStop");
+      check("SoundStream::playBack() alSourceStop");
    }
    
    return true;
 }
 
+/*************************************************************************
+ *                              processEof                               *
+ *************************************************************************/
+bool SoundStream::processEof()
+{
+   if(loopInterval == 0)
+   {
+      /* Auto Rewind file */
+      if(!_rewind())
+      {
+         return false;
+      }
+   }
+   else if(loopInterval > 0)
+   {
+      /* Start timer before reload */
+      ended = true;
+      loopTimer.reset();
+   }
+   else
+   {
+      /* Never loop */
+      ended = true;
+   }
+
+   return true;
+}
+
 /*************************************************************************
  *                            changeVolume                               *
  *************************************************************************/
@@ -365,50 +1000,26 @@ void SoundStream::empty()
       int queued;
       
       alGetSourcei(source, AL_BUFFERS_QUEUED, &queued);
-      check("::empty() AL_BUFFERS_QUEUED");
+      check("SoundStream::empty() AL_BUFFERS_QUEUED");
       
       while(queued--)
       {
          ALuint buffer;
          
          alSourceUnqueueBuffers(source, 1, &buffer);
-         check("::empty() alSourceUnqueueBuffers");
+         check("SoundStream::empty() alSourceUnqueueBuffers");
       }
+      releaseSilence();
    }
 }
 
 /*************************************************************************
- *                                 check                                 *
+ *                            static members                             *
  *************************************************************************/
-void SoundStream::check(const Kobold::String& where)
-{
-    int error = alGetError();
- 
-    if(error != AL_NO_ERROR)
-    {
-        Kobold::Log::add(Kobold::LOG_LEVEL_ERROR, 
-              "SoundStream: OpenAL error was raised!");
-        switch(error)
-        {
-           case AL_INVALID_NAME: 
-              Kobold::Log::add("Invalid name parameter");
-           break;
-           case AL_INVALID_ENUM: 
-              Kobold::Log::add("Invalid parameter");
-           break;
-           case AL_INVALID_VALUE: 
-              Kobold::Log::add("Invalid enum parameter value");
-           break;
-           case AL_INVALID_OPERATION: 
-              Kobold::Log::add("Illegal call");
-           break;
-           case AL_OUT_OF_MEMORY: 
-              Kobold::Log::add("Unable to allocate memory");
-           break;
-        }
-       Kobold::Log::add(Kobold::String("At: ")+where);
-    }
-}
+std::mutex SoundStream::submitMutex;
+std::atomic<unsigned int> SoundStream::lastId(0);
+char SoundStream::callerScratch[KOSOUND_MAX_STREAM_BUFFER_SIZE];
+
 
 
 
@@ -35,9 +35,40 @@
 
 #include <kobold/timer.h>
 
+#include "alcheck.h"
+#include "streamlog.h"
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
 namespace Kosound
 {
 
+/*! Max buffer size of any stream (the size of per thread scratch buffers) */
+#define KOSOUND_MAX_STREAM_BUFFER_SIZE (4096 * 16)
+
+/*! Logical state of a stream source, saved to recreate it on another
+ * device (see SoundStream::detachSource) */
+class SourceState
+{
+   public:
+      ALfloat position[3];       /**< AL_POSITION */
+      ALfloat velocity[3];       /**< AL_VELOCITY */
+      ALfloat direction[3];      /**< AL_DIRECTION */
+      ALfloat gain;              /**< AL_GAIN */
+      ALfloat pitch;             /**< AL_PITCH */
+      ALfloat referenceDistance; /**< AL_REFERENCE_DISTANCE */
+      ALfloat rolloff;           /**< AL_ROLLOFF_FACTOR */
+      ALfloat innerAngle;        /**< AL_CONE_INNER_ANGLE */
+      ALfloat outerAngle;        /**< AL_CONE_OUTER_ANGLE */
+      ALint relative;            /**< AL_SOURCE_RELATIVE */
+      double time;               /**< Playback position, in seconds */
+      ALint sourceState;         /**< AL_SOURCE_STATE */
+      bool active;               /**< If was still streaming */
+};
+
 /*! The SoundStream class is a generic implementation of a sound stream.
  * All specific sound formats must derive from this one. */
 class SoundStream
@@ -46,12 +77,15 @@ class SoundStream
       enum SoundStreamType
       {
          TYPE_CAF=0,
-         TYPE_OGG
+         TYPE_OGG,
+         TYPE_KOSND,
+         TYPE_ASSET
       };
 
       /*! Constructor
        * \param t -> SoundStream type constant
-       * \param bufSize -> size of the read buffer */ 
+       * \param bufSize -> size of each streamed buffer (up to 
+       *                   KOSOUND_MAX_STREAM_BUFFER_SIZE) */ 
       SoundStream(const SoundStreamType& t, unsigned long bufSize);
       /*! Destructor
        * \note -> the destructor will call _release() */
@@ -62,6 +96,17 @@ class SoundStream
        * \return true if successfully loaded, false otherwise */
       bool open(const Kobold::String& fName);
 
+      /*! Decode the whole file to a single AL buffer, instead of 
+       * streaming it (for short sounds played many times). No source is
+       * created, and the stream is closed on return.
+       * \param fName -> name of sound file to load
+       * \param buffer -> AL buffer to load to (0 to just decode, to
+       *                 keep, see getFormat and getSampleRate)
+       * \param keep -> if not NULL, receives the decoded data
+       * \return true if successfully loaded */
+      bool load(const Kobold::String& fName, ALuint buffer, 
+            std::vector<char>* keep=NULL);
+
       /*! Define the stream as Music (no position and no atenuation) */
       void defineAsMusic();
 
@@ -81,8 +126,75 @@ class SoundStream
        * \return false if stream is over */
       bool update();
 
+      /*! Update the stream to OpenAL buffers, decoding into a scratch
+       * buffer owned by the caller (usually by a decode worker thread).
+       * \param scratch -> buffer with at least getBufferSize() bytes
+       * \return false if stream is over */
+      bool update(char* scratch);
+
+      /*! Prepare its playback, decoding its first buffers ahead of time,
+       * to later start it at a precise time (see enqueue and start).
+       * \return false on error */
+      bool prepare();
+
+      /*! Queue the prepared buffers, without starting the source.
+       * \param silence -> seconds of silence to play before the stream
+       *        start (limited to KOSOUND_MAX_STREAM_BUFFER_SIZE bytes)
+       * \return false if not prepared */
+      bool enqueue(double silence);
+
+      /*! Start the source of a prepared and queued playback */
+      void start();
+
+      /*! Stop the playback, discarding its queued buffers, but keeping
+       * the stream opened, to play it again (see playback(true)). */
+      void stop();
+
+      /*! Restart, from where it stopped, a stream whose source was 
+       * stopped by a device loss (no-op if not stopped or ended).
+       * \return false on error */
+      bool resume();
+
+      /*! Save the state of its source, then delete its AL source and 
+       * buffers (but keep its decoder), as before closing the device.
+       * \param state -> where to save the state */
+      void detachSource(SourceState& state);
+
+      /*! Create again its AL source and buffers (at the now current
+       * device), restoring a state saved by detachSource and continuing
+       * its playback from there. A never started source (AL_INITIAL) is
+       * only positioned, to be prepared again (see prepare).
+       * \param state -> state to restore
+       * \return false on error */
+      bool attachSource(const SourceState& state);
+
+      /*! \return size of the buffers used to stream */
+      unsigned long getBufferSize() const { return bufferSize; };
+
+      /*! \return time, in seconds, of the audio queued and not yet 
+       * played: the time before the stream underruns. */
+      double getQueuedTime();
+
+      /*! \return time, in seconds, until the stream must be updated
+       * again: when its queued audio runs out minus a safety margin, but
+       * never before its front buffer ends (when a refill is first 
+       * possible). 0 if it needs an update now.
+       * \param margin -> safety margin, in seconds */
+      double getRefillDelay(double margin);
+
       /*! Rewind the sound to play again */
       bool rewind();
+
+      /*! Seek the stream to a position, sample-accurate. If the stream
+       * was playing, it continues from there.
+       * \param seconds -> position (from the start) to seek to
+       * \return true on success */
+      bool seek(double seconds);
+
+      /*! Get current playback position (that being played now, not the
+       * one decoded)
+       * \return position, in seconds, from the start */
+      double tell();
       
       /*! Get The Source
        * \return AL source of the caf */
@@ -97,15 +209,43 @@ class SoundStream
        *              the EOF, >0 wait lp seconds before loop) */
       void setLoop(int lp);
 
+      /*! Define if a stereo file is downmixed to mono as it's decoded
+       * (OpenAL only spatializes mono buffers), halving its buffers. 
+       * Must be called before open (or load).
+       * \param enable -> true to downmix (default: false) */
+      void setDownmix(bool enable) { downmix = enable; };
+
+      /*! \return if ended, just waiting its loop interval to play again
+       * (the only state where it needs updates without AL activity). */
+      bool isWaitingLoop() const 
+      { 
+         return (opened) && (ended) && (loopInterval > 0); 
+      };
+
+      /*! \return its identifier (unique, as logged by StreamLog) */
+      unsigned int getId() const { return id; };
+
       /*! Get the stream type */
       const SoundStreamType& getType(){ return type; };
 
+      /*! \return OpenAL format of the decoded data (after open or load) */
+      ALenum getFormat() const { return format; };
+
+      /*! \return sample rate of the decoded data (after open or load) */
+      ALuint getSampleRate() const { return sampleRate; };
+
    protected:
       /*! Stream the file to the OpenAL buffer
        * \param buffer -> buffer to reload 
+       * \param scratch -> where to decode the data before the upload
        * \param rw -> if true, force a file rewind
        * \return false if stream is over, or error happened */
-      bool stream(ALuint buffer, bool rw=false);
+      bool stream(ALuint buffer, char* scratch, bool rw=false);
+
+      /*! Start the playback (see playback)
+       * \param rw -> if true, rewind the stream
+       * \param scratch -> where to decode the data before the upload */
+      bool startPlayback(bool rw, char* scratch);
 
       /*! Implementation of the open on the specific sound file
        * \note: Implementation must set the OpenAL format (f)
@@ -120,43 +260,109 @@ class SoundStream
        * \return true on success */
       virtual bool _rewind()=0;
 
-      /*! Read data to the internal buffer
-       * \param index -> first position on the buffer to fill
+      /*! Seek the stream to a frame (a sample for each channel)
+       * \param frame -> frame to seek to, from the start
+       * \return true on success, false on error or if not seekable */
+      virtual bool _seek(int64_t frame) { return false; };
+
+      /*! Read data to a buffer
+       * \param buffer -> where to put the readed data
        * \param readBytes -> total bytes to read (could read less)
        * \param bytesReaded -> return total bytes really readed on this call
        * \param gotEof -> return true if got EOF
        * \return false if some error occurred */
-      virtual bool _getBuffer(unsigned long index, unsigned long readBytes, 
+      virtual bool _getBuffer(char* buffer, unsigned long readBytes, 
             unsigned long* bytesReaded, bool* gotEof)=0;
 
+      /*! \return if the implementation could give direct pointers to its
+       * decoded data (see _mapBuffer), avoiding the copy to a scratch. */
+      virtual bool _canMapBuffer() { return false; };
+
+      /*! Get a pointer to the next decoded data, without copying it.
+       * \note only called if _canMapBuffer() returns true.
+       * \param readBytes -> max bytes wanted
+       * \param data -> return pointer to the data
+       * \param bytesReaded -> return total bytes available at data
+       * \param gotEof -> return true if got EOF
+       * \return false if some error occurred */
+      virtual bool _mapBuffer(unsigned long readBytes, const char** data,
+            unsigned long* bytesReaded, bool* gotEof) { return false; };
+
       /*! Empty the queue */
       void empty();      
 
-      /*! Check OpenAl errors
-       * \param where -> string with information about 
+      /*! Check OpenAL errors, as selected at build time (see alcheck.h)
+       * \param where -> string literal with information about 
        *                 where the check occurs */
-      void check(const Kobold::String& where); 
+      void check(const char* where) { KOSOUND_AL_CHECK(where); }; 
+
+      /*! Log an error of the stream, without blocking nor allocating 
+       * (see StreamLog), as could be at a decode thread.
+       * \param code -> error code
+       * \param detail -> its detail */
+      void logError(StreamLog::Code code, int detail=0)
+      {
+         StreamLog::add(code, id, fileName.c_str(), detail);
+      };
 
       Kobold::String fileName; /**< Filename of the sound stream */
 
-      char* bufferData;         /**< The buffer used to read */
       unsigned long bufferSize; /**< Size of the buffer */
 
+      /*! Decode scratch of the thread calling update() (the single one 
+       * calling Sound::flush()), while each decode worker has its own. 
+       * As alBufferData copies it, no stream keeps a buffer of its own. */
+      static char callerScratch[KOSOUND_MAX_STREAM_BUFFER_SIZE];
+
 
    private:
+      /*! Act on a got EOF, rewinding or ending the stream, 
+       * based on its loop interval.
+       * \return false on error */
+      bool processEof();
+
+      /*! Delete the leading silence buffer, if any (must be unqueued) */
+      void releaseSilence();
+
+      /*! \return the index of an AL buffer at the buffers array */
+      int getBufferIndex(ALuint buffer);
+
+      /*! \return the frame position just after the buffer ends
+       * \param index -> buffer index
+       * \param start -> frame position of the buffer start */
+      int64_t getBufferEnd(int index, int64_t start);
+
       SoundStreamType type;  /**< Sound stream type */
+      unsigned int id;       /**< Its identifier */
 
       bool opened;        /**< If caf was opened or not */
+      bool downmix;       /**< If should downmix a stereo file */
+      bool mixing;        /**< If decoding stereo, uploading mono */
       bool ended;         /**< If play ended or not */
 
       int loopInterval;   /**< Number of seconds before next loop */
       Kobold::Timer loopTimer;    /**< Timer to next loop */
 
       ALuint buffers[2]; /**< front and back buffers */
+      ALuint silenceBuffer; /**< Leading silence queued, if any */
+      ALint silenceFrames;  /**< Frames at silenceBuffer */
+      int preparedBuffers;  /**< Buffers filled by prepare, not queued */
       ALuint source;     /**< audio source */
       ALenum format;     /**< internal format */
       ALuint sampleRate; /**< input/output sample rate */
 
+      /* Playback position tracking */
+      int frontBuffer;        /**< Index of the first queued buffer */
+      int64_t frontStart;     /**< Frame position of front buffer start */
+      ALint bufferFrames[2];  /**< Frames at each buffer */
+      ALint bufferWrap[2];    /**< Frame each buffer looped to start, or -1 */
+
+      /*! Serialize buffer data submission and queueing, as streams could 
+       * be decoded in parallel. */
+      static std::mutex submitMutex;
+
+      static std::atomic<unsigned int> lastId; /**< Last identifier given */
+
       
 };
 
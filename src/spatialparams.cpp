@@ -0,0 +1,305 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "spatialparams.h"
+
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+   #include <emmintrin.h>
+   #define KOSOUND_SPATIAL_SSE2 1
+#endif
+
+using namespace Kosound;
+
+/* Polynomial approximations of 1 + log2 (at [1, 2)) and exp2 
+ * (at [0, 1)) */
+#define KOSOUND_LOG2_A  -0.34484843f
+#define KOSOUND_LOG2_B   2.02466578f
+#define KOSOUND_LOG2_C  -0.67487759f
+#define KOSOUND_EXP2_A   0.34428668f
+#define KOSOUND_EXP2_B   0.65571332f
+
+/*************************************************************************
+ *                                resize                                 *
+ *************************************************************************/
+void SpatialParams::resize(size_t total)
+{
+   x.resize(total, 0.0f);
+   y.resize(total, 0.0f);
+   z.resize(total, 0.0f);
+   gain.resize(total, 1.0f);
+   reference.resize(total, 1.0f);
+   rolloff.resize(total, 1.0f);
+   range.resize(total, 0.0f);
+   dirX.resize(total, 0.0f);
+   dirY.resize(total, 0.0f);
+   dirZ.resize(total, 0.0f);
+   cosInner.resize(total, 1.0f);
+   coneScale.resize(total, 0.0f);
+   outerGain.resize(total, 0.0f);
+}
+
+/*************************************************************************
+ *                                  set                                  *
+ *************************************************************************/
+void SpatialParams::set(size_t i, ALfloat px, ALfloat py, ALfloat pz, 
+      ALfloat g, ALfloat ref, ALfloat roll, ALfloat maxDistance)
+{
+   x[i] = px;
+   y[i] = py;
+   z[i] = pz;
+   gain[i] = g;
+   /* Without a reference distance, AL doesn't attenuate */
+   reference[i] = (ref > 0.0f) ? ref : 1.0f;
+   rolloff[i] = (ref > 0.0f) ? roll : 0.0f;
+   range[i] = maxDistance;
+}
+
+/*************************************************************************
+ *                              setPosition                              *
+ *************************************************************************/
+void SpatialParams::setPosition(size_t i, ALfloat px, ALfloat py, 
+      ALfloat pz)
+{
+   x[i] = px;
+   y[i] = py;
+   z[i] = pz;
+}
+
+/*************************************************************************
+ *                                setCone                                *
+ *************************************************************************/
+void SpatialParams::setCone(size_t i, ALfloat dx, ALfloat dy, ALfloat dz,
+      ALfloat innerAngle, ALfloat outerAngle, ALfloat outer)
+{
+   ALfloat len = sqrtf(dx * dx + dy * dy + dz * dz);
+   ALfloat cosOuter;
+
+   if( (len <= 0.0f) || (innerAngle >= 360.0f) )
+   {
+      /* Non-directional */
+      dirX[i] = 0.0f;
+      dirY[i] = 0.0f;
+      dirZ[i] = 0.0f;
+      cosInner[i] = 1.0f;
+      coneScale[i] = 0.0f;
+      outerGain[i] = 1.0f;
+      return;
+   }
+
+   dirX[i] = dx / len;
+   dirY[i] = dy / len;
+   dirZ[i] = dz / len;
+   /* AL angles are of the whole cone: compare with half of them */
+   cosInner[i] = cosf(innerAngle * (float)M_PI / 360.0f);
+   cosOuter = cosf(outerAngle * (float)M_PI / 360.0f);
+   coneScale[i] = (cosInner[i] > cosOuter) ? 
+      1.0f / (cosInner[i] - cosOuter) : 1.0e6f;
+   outerGain[i] = outer;
+}
+
+/*************************************************************************
+ *                                 copy                                  *
+ *************************************************************************/
+void SpatialParams::copy(size_t i, const SpatialParams& from, size_t index)
+{
+   x[i] = from.x[index];
+   y[i] = from.y[index];
+   z[i] = from.z[index];
+   gain[i] = from.gain[index];
+   reference[i] = from.reference[index];
+   rolloff[i] = from.rolloff[index];
+   range[i] = from.range[index];
+   dirX[i] = from.dirX[index];
+   dirY[i] = from.dirY[index];
+   dirZ[i] = from.dirZ[index];
+   cosInner[i] = from.cosInner[index];
+   coneScale[i] = from.coneScale[index];
+   outerGain[i] = from.outerGain[index];
+}
+
+/*************************************************************************
+ *                             kosound_log2                              *
+ *************************************************************************/
+static inline float kosound_log2(float v)
+{
+   uint32_t bits;
+   float m;
+
+   memcpy(&bits, &v, sizeof(bits));
+   /* Exponent, plus the log2 of the mantissa */
+   bits = (bits & 0x007FFFFFu) | 0x3F800000u;
+   memcpy(&m, &bits, sizeof(m));
+   memcpy(&bits, &v, sizeof(bits));
+
+   return (float)((int32_t)(bits >> 23) - 128) +
+      (KOSOUND_LOG2_A * m + KOSOUND_LOG2_B) * m + KOSOUND_LOG2_C;
+}
+
+/*************************************************************************
+ *                             kosound_exp2                              *
+ *************************************************************************/
+static inline float kosound_exp2(float v)
+{
+   float fl, f, res;
+   uint32_t bits;
+
+   /* Only attenuations are needed: v at [-126, 0] */
+   v = (v < -126.0f) ? -126.0f : ((v > 0.0f) ? 0.0f : v);
+   fl = floorf(v);
+   f = v - fl;
+
+   bits = (uint32_t)((int32_t)fl + 127) << 23;
+   memcpy(&res, &bits, sizeof(res));
+
+   return res * (1.0f + f * (KOSOUND_EXP2_B + f * KOSOUND_EXP2_A));
+}
+
+/*************************************************************************
+ *                            kosound_score                              *
+ *************************************************************************/
+static inline float kosound_score(const SpatialParams& p, size_t i,
+      ALfloat lx, ALfloat ly, ALfloat lz)
+{
+   float dx = p.x[i] - lx, dy = p.y[i] - ly, dz = p.z[i] - lz;
+   float d2 = dx * dx + dy * dy + dz * dz;
+   float ref = p.reference[i];
+   float att, cosA, t;
+
+   if(d2 > p.range[i] * p.range[i])
+   {
+      return 0.0f;
+   }
+
+   /* (d / ref) ^ -rolloff, as 2 ^ (-rolloff / 2 * log2(d^2 / ref^2)) */
+   att = kosound_exp2(-0.5f * p.rolloff[i] * 
+         kosound_log2(d2 / (ref * ref)));
+
+   /* Cone, from the angle between its direction and the listener */
+   cosA = -(dx * p.dirX[i] + dy * p.dirY[i] + dz * p.dirZ[i]) /
+          sqrtf((d2 > 1.0e-6f) ? d2 : 1.0e-6f);
+   t = (p.cosInner[i] - cosA) * p.coneScale[i];
+   t = (t < 0.0f) ? 0.0f : ((t > 1.0f) ? 1.0f : t);
+
+   return p.gain[i] * att * (1.0f + t * (p.outerGain[i] - 1.0f));
+}
+
+#ifdef KOSOUND_SPATIAL_SSE2
+/*************************************************************************
+ *                           kosound_log2_sse                            *
+ *************************************************************************/
+static inline __m128 kosound_log2_sse(__m128 v)
+{
+   __m128i bits = _mm_castps_si128(v);
+   __m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23),
+            _mm_set1_epi32(128)));
+   __m128 m = _mm_castsi128_ps(_mm_or_si128(
+            _mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)),
+            _mm_set1_epi32(0x3F800000)));
+
+   return _mm_add_ps(e, _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(
+                  _mm_set1_ps(KOSOUND_LOG2_A), m), 
+               _mm_set1_ps(KOSOUND_LOG2_B)), m), _mm_set1_ps(KOSOUND_LOG2_C)));
+}
+
+/*************************************************************************
+ *                           kosound_exp2_sse                            *
+ *************************************************************************/
+static inline __m128 kosound_exp2_sse(__m128 v)
+{
+   __m128 t, fl, f, p;
+   __m128i e;
+
+   v = _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(-126.0f)), _mm_setzero_ps());
+
+   /* Truncation is a ceil for negatives: make it a floor */
+   t = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+   fl = _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, v), _mm_set1_ps(1.0f)));
+   f = _mm_sub_ps(v, fl);
+
+   e = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(fl), 
+            _mm_set1_epi32(127)), 23);
+   p = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(f, _mm_add_ps(
+               _mm_set1_ps(KOSOUND_EXP2_B), 
+               _mm_mul_ps(f, _mm_set1_ps(KOSOUND_EXP2_A)))));
+
+   return _mm_mul_ps(_mm_castsi128_ps(e), p);
+}
+#endif
+
+/*************************************************************************
+ *                                 score                                 *
+ *************************************************************************/
+void SpatialParams::score(ALfloat lx, ALfloat ly, ALfloat lz, 
+      ALfloat* scores) const
+{
+   size_t i = 0, total = size();
+
+#ifdef KOSOUND_SPATIAL_SSE2
+   __m128 vlx = _mm_set1_ps(lx), vly = _mm_set1_ps(ly);
+   __m128 vlz = _mm_set1_ps(lz);
+   __m128 one = _mm_set1_ps(1.0f), zero = _mm_setzero_ps();
+   __m128 dx, dy, dz, d2, r, ref, att, cosA, t, cone, inRange;
+
+   for(; i + 4 <= total; i += 4)
+   {
+      dx = _mm_sub_ps(_mm_loadu_ps(&x[i]), vlx);
+      dy = _mm_sub_ps(_mm_loadu_ps(&y[i]), vly);
+      dz = _mm_sub_ps(_mm_loadu_ps(&z[i]), vlz);
+      d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+            _mm_mul_ps(dz, dz));
+      r = _mm_loadu_ps(&range[i]);
+      inRange = _mm_cmple_ps(d2, _mm_mul_ps(r, r));
+
+      /* Distance attenuation */
+      ref = _mm_loadu_ps(&reference[i]);
+      att = kosound_exp2_sse(_mm_mul_ps(
+               _mm_mul_ps(_mm_set1_ps(-0.5f), _mm_loadu_ps(&rolloff[i])),
+               kosound_log2_sse(_mm_div_ps(d2, _mm_mul_ps(ref, ref)))));
+
+      /* Cone */
+      cosA = _mm_add_ps(_mm_add_ps(
+               _mm_mul_ps(dx, _mm_loadu_ps(&dirX[i])),
+               _mm_mul_ps(dy, _mm_loadu_ps(&dirY[i]))),
+               _mm_mul_ps(dz, _mm_loadu_ps(&dirZ[i])));
+      cosA = _mm_sub_ps(zero, _mm_mul_ps(cosA, 
+               _mm_rsqrt_ps(_mm_max_ps(d2, _mm_set1_ps(1.0e-6f)))));
+      t = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&cosInner[i]), cosA),
+            _mm_loadu_ps(&coneScale[i]));
+      t = _mm_min_ps(_mm_max_ps(t, zero), one);
+      cone = _mm_add_ps(one, _mm_mul_ps(t, 
+               _mm_sub_ps(_mm_loadu_ps(&outerGain[i]), one)));
+
+      _mm_storeu_ps(&scores[i], _mm_and_ps(inRange, 
+               _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(&gain[i]), att), cone)));
+   }
+#endif
+
+   /* The remaining ones (or all, without SSE2) */
+   for(; i < total; i++)
+   {
+      scores[i] = kosound_score(*this, i, lx, ly, lz);
+   }
+}
+
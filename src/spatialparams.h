@@ -0,0 +1,115 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kosound_spatial_params_h
+#define _kosound_spatial_params_h
+
+#include "kosoundconfig.h"
+#include <kobold/platform.h>
+
+#if KOBOLD_PLATFORM == KOBOLD_PLATFORM_IOS || \
+    KOBOLD_PLATFORM == KOBOLD_PLATFORM_MACOS
+   #include <OpenAL/al.h>
+#else
+   #include <AL/al.h>
+#endif
+
+#include <vector>
+#include <stddef.h>
+
+namespace Kosound
+{
+
+/*! Spatial parameters of many positional sources, as a structure of
+ * arrays, to estimate how loud each one is heard with a single pass of
+ * a vectorized kernel (see score). */
+class SpatialParams
+{
+   public:
+      /*! Define the number of sources. New ones are non-directional, 
+       * with gain 1, reference distance 1 and rolloff 1. */
+      void resize(size_t total);
+
+      /*! \return number of sources */
+      size_t size() const { return x.size(); };
+
+      /*! Define the parameters of a source (keeping its cone)
+       * \param i -> its index
+       * \param px -> X position
+       * \param py -> Y position
+       * \param pz -> Z position
+       * \param g -> its gain
+       * \param ref -> AL_REFERENCE_DISTANCE
+       * \param roll -> AL_ROLLOFF_FACTOR
+       * \param maxDistance -> distance from which it's not heard at all */
+      void set(size_t i, ALfloat px, ALfloat py, ALfloat pz, ALfloat g,
+            ALfloat ref, ALfloat roll, ALfloat maxDistance);
+
+      /*! Redefine the position of a source */
+      void setPosition(size_t i, ALfloat px, ALfloat py, ALfloat pz);
+
+      /*! Define the directional cone of a source (as AL does)
+       * \param i -> its index
+       * \param dx -> X direction (all zero for non-directional)
+       * \param dy -> Y direction
+       * \param dz -> Z direction
+       * \param innerAngle -> AL_CONE_INNER_ANGLE, in degrees
+       * \param outerAngle -> AL_CONE_OUTER_ANGLE, in degrees
+       * \param outer -> AL_CONE_OUTER_GAIN */
+      void setCone(size_t i, ALfloat dx, ALfloat dy, ALfloat dz,
+            ALfloat innerAngle, ALfloat outerAngle, ALfloat outer);
+
+      /*! Copy a source of other params to this one (as when gathering
+       * some of them to score) */
+      void copy(size_t i, const SpatialParams& from, size_t index);
+
+      /*! Estimate, for each source, the gain it's heard with by a 
+       * listener: its gain, attenuated by AL_EXPONENT_DISTANCE (clamped
+       * to 1) and by its cone, or 0 when past its max distance. Uses
+       * approximate pow, square root and cone interpolation (done on 
+       * the cosine of the angle), vectorized when SSE2 is available: 
+       * about 2% of error, but 10k sources take tens of microseconds.
+       * \param lx -> listener X position
+       * \param ly -> listener Y position
+       * \param lz -> listener Z position
+       * \param scores -> where to write each estimated gain (size()) */
+      void score(ALfloat lx, ALfloat ly, ALfloat lz, ALfloat* scores) const;
+
+      std::vector<ALfloat> x;         /**< X positions */
+      std::vector<ALfloat> y;         /**< Y positions */
+      std::vector<ALfloat> z;         /**< Z positions */
+      std::vector<ALfloat> gain;      /**< Gains */
+      std::vector<ALfloat> reference; /**< Reference distances */
+      std::vector<ALfloat> rolloff;   /**< Rolloff factors */
+      std::vector<ALfloat> range;     /**< Max distances */
+      std::vector<ALfloat> dirX;      /**< Normalized cone X directions */
+      std::vector<ALfloat> dirY;      /**< Normalized cone Y directions */
+      std::vector<ALfloat> dirZ;      /**< Normalized cone Z directions */
+      std::vector<ALfloat> cosInner;  /**< Cosine of half inner angles */
+      /*! 1 / (cosInner - cosine of half outer angle), 0 if 
+       * non-directional */
+      std::vector<ALfloat> coneScale;
+      std::vector<ALfloat> outerGain; /**< Gains outside the cones */
+};
+
+}
+
+#endif
+
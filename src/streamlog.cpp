@@ -0,0 +1,146 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "streamlog.h"
+#include "alcheck.h"
+#include <kobold/log.h>
+
+#include <string.h>
+
+using namespace Kosound;
+
+/*************************************************************************
+ *                                  add                                  *
+ *************************************************************************/
+void StreamLog::add(Code code, unsigned int stream, const char* name,
+      int detail, const char* site, const char* lastSite)
+{
+   Record record;
+   size_t length = 0;
+
+   record.code = code;
+   record.detail = detail;
+   record.stream = stream;
+   record.site = site;
+   record.lastSite = lastSite;
+
+   /* Keep the tail of the name: more meaningful than its path */
+   if(name != NULL)
+   {
+      length = strlen(name);
+      if(length >= KOSOUND_STREAM_LOG_NAME_SIZE)
+      {
+         name += length - (KOSOUND_STREAM_LOG_NAME_SIZE - 1);
+         length = KOSOUND_STREAM_LOG_NAME_SIZE - 1;
+      }
+      memcpy(record.name, name, length);
+   }
+   record.name[length] = '\0';
+
+   if(!records.push(record))
+   {
+      dropped++;
+   }
+}
+
+/*************************************************************************
+ *                                 drain                                 *
+ *************************************************************************/
+void StreamLog::drain()
+{
+   Record r;
+   unsigned long drops;
+
+   while(records.pop(r))
+   {
+      switch(r.code)
+      {
+         case ERROR_MAP_BUFFER:
+            Kobold::Log::add(Kobold::LOG_LEVEL_ERROR,
+                  "SoundStream: couldn't map decoded data of '%s' (#%u)", 
+                  r.name, r.stream);
+         break;
+         case ERROR_GET_BUFFER:
+            Kobold::Log::add(Kobold::LOG_LEVEL_ERROR,
+                  "SoundStream: couldn't decode a buffer of '%s' (#%u)", 
+                  r.name, r.stream);
+         break;
+         case ERROR_DECODE:
+            Kobold::Log::add(Kobold::LOG_LEVEL_ERROR,
+                  "SoundStream: decoder error %d at '%s' (#%u)", 
+                  r.detail, r.name, r.stream);
+         break;
+         case ERROR_REWIND:
+            Kobold::Log::add(Kobold::LOG_LEVEL_ERROR,
+                  "SoundStream: couldn't rewind '%s' (#%u)", 
+                  r.name, r.stream);
+         break;
+         case ERROR_SEEK:
+            Kobold::Log::add(Kobold::LOG_LEVEL_ERROR,
+                  "SoundStream: couldn't seek '%s' (#%u) to %.3fs", 
+                  r.name, r.stream, r.detail / 1000.0);
+         break;
+         case ERROR_READ:
+            Kobold::Log::add(Kobold::LOG_LEVEL_ERROR,
+                  "SoundStream: unexpected end of '%s' (#%u) at block %d",
+                  r.name, r.stream, r.detail);
+         break;
+         case ERROR_AL:
+            if(r.site == NULL)
+            {
+               /* Not raised by a checked call */
+               Kobold::Log::add(Kobold::LOG_LEVEL_ERROR,
+                     "OpenAL error: %s (0x%x)", 
+                     ALCheck::getErrorString(r.detail), r.detail);
+            }
+            else if( (r.lastSite == NULL) || (r.lastSite == r.site) )
+            {
+               Kobold::Log::add(Kobold::LOG_LEVEL_ERROR,
+                     "OpenAL error: %s (0x%x) at %s", 
+                     ALCheck::getErrorString(r.detail), r.detail, r.site);
+            }
+            else
+            {
+               Kobold::Log::add(Kobold::LOG_LEVEL_ERROR,
+                     "OpenAL error: %s (0x%x) between %s and %s",
+                     ALCheck::getErrorString(r.detail), r.detail, 
+                     r.site, r.lastSite);
+            }
+         break;
+      }
+   }
+
+   drops = dropped;
+   if(drops != reportedDrops)
+   {
+      Kobold::Log::add(Kobold::LOG_LEVEL_ERROR,
+            "SoundStream: %lu errors not logged (full log ring)", 
+            drops - reportedDrops);
+      reportedDrops = drops;
+   }
+}
+
+/*************************************************************************
+ *                            static members                             *
+ *************************************************************************/
+MpscQueue<StreamLog::Record> StreamLog::records(KOSOUND_STREAM_LOG_SIZE);
+std::atomic<unsigned long> StreamLog::dropped(0);
+unsigned long StreamLog::reportedDrops = 0;
+
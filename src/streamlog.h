@@ -0,0 +1,103 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kosound_stream_log_h
+#define _kosound_stream_log_h
+
+#include "kosoundconfig.h"
+#include "mpscqueue.h"
+
+#include <atomic>
+
+namespace Kosound
+{
+
+/*! Records kept by the StreamLog (must be a power of two) */
+#define KOSOUND_STREAM_LOG_SIZE       256
+/*! Max characters of the file name kept at each record (its tail) */
+#define KOSOUND_STREAM_LOG_NAME_SIZE  48
+
+/*! Log of the errors raised while streaming (at any decode thread). 
+ * Adding a record is lock-free and allocation free: a fixed-size record
+ * (an error code, its detail and the stream identifier) is pushed to a 
+ * preallocated ring. Records are only formatted, and sent to 
+ * Kobold::Log, by drain(), called at each Sound::flush. */
+class StreamLog
+{
+   public:
+      /*! Error codes */
+      enum Code
+      {
+         /*! Couldn't map the decoded data */
+         ERROR_MAP_BUFFER=0,
+         /*! Couldn't decode a buffer */
+         ERROR_GET_BUFFER,
+         /*! The decoder failed (detail: decoder error code) */
+         ERROR_DECODE,
+         /*! Couldn't rewind the file */
+         ERROR_REWIND,
+         /*! Couldn't seek the file (detail: target, in milliseconds) */
+         ERROR_SEEK,
+         /*! Unexpected end of file (detail: block) */
+         ERROR_READ,
+         /*! OpenAL error (detail: AL error; with the call site) */
+         ERROR_AL
+      };
+
+      /*! Add a record. Could be called by any thread, never blocking nor
+       * allocating. When the ring is full, the record is dropped.
+       * \param code -> error code
+       * \param stream -> stream identifier (0 if none)
+       * \param name -> stream file name (or NULL)
+       * \param detail -> error detail (see Code)
+       * \param site -> call site, or first possible one (or NULL)
+       * \param lastSite -> last possible call site (or NULL) */
+      static void add(Code code, unsigned int stream, const char* name,
+            int detail=0, const char* site=NULL, const char* lastSite=NULL);
+
+      /*! Format and log, with Kobold::Log, all records added. Must be 
+       * called by a single thread at a time (the one calling flush). */
+      static void drain();
+
+      /*! \return total of records dropped for a full ring */
+      static unsigned long getDropped() { return dropped; };
+
+   private:
+      /*! A logged error */
+      class Record
+      {
+         public:
+            Code code;          /**< Error code */
+            int detail;         /**< Its detail */
+            unsigned int stream;/**< Stream identifier */
+            const char* site;   /**< Call site (string literal) */
+            const char* lastSite; /**< Last possible site (literal) */
+            char name[KOSOUND_STREAM_LOG_NAME_SIZE]; /**< File name tail */
+      };
+
+      static MpscQueue<Record> records; /**< The ring */
+      static std::atomic<unsigned long> dropped; /**< Dropped records */
+      static unsigned long reportedDrops;  /**< Dropped already logged */
+};
+
+}
+
+#endif
+
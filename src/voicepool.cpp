@@ -0,0 +1,404 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "voicepool.h"
+#include <kobold/log.h>
+
+#include <algorithm>
+
+using namespace Kosound;
+
+#define KOSOUND_VOICE_INDEX_MASK  (KOSOUND_MAX_VOICES - 1)
+#define KOSOUND_VOICE_SERIAL_MASK (0xFFFFFFFFu >> KOSOUND_VOICE_INDEX_BITS)
+
+/*************************************************************************
+ *                             Constructor                               *
+ *************************************************************************/
+VoicePool::VoicePool(int total)
+{
+   int i;
+
+   if(total > KOSOUND_MAX_VOICES)
+   {
+      total = KOSOUND_MAX_VOICES;
+   }
+
+   voices.reserve(total);
+   freeVoices.reserve(total);
+   active.reserve(total);
+   queued.reserve(total);
+
+   for(i = 0; i < total; i++)
+   {
+      Voice voice;
+      alGenSources(1, &voice.source);
+      if(alGetError() != AL_NO_ERROR)
+      {
+         /* Implementation limit reached: keep the ones we got */
+         Kobold::Log::add(Kobold::LOG_LEVEL_ERROR,
+               "VoicePool: could only create %d of %d voices", i, total);
+         break;
+      }
+      voice.serial = 0;
+      voice.asset = NULL;
+      voice.gain = 1.0f;
+      voice.bus = NULL;
+      voice.busVersion = 0;
+      voice.policy = NULL;
+      voice.order = 0;
+      voices.push_back(voice);
+   }
+
+   /* Free ones are taken from the back */
+   for(i = (int)voices.size() - 1; i >= 0; i--)
+   {
+      freeVoices.push_back(i);
+   }
+}
+
+/*************************************************************************
+ *                              Destructor                               *
+ *************************************************************************/
+VoicePool::~VoicePool()
+{
+   size_t i;
+
+   stopAll();
+   for(i = 0; i < voices.size(); i++)
+   {
+      alDeleteSources(1, &voices[i].source);
+   }
+}
+
+/*************************************************************************
+ *                                 play                                  *
+ *************************************************************************/
+OneShotHandle VoicePool::play(SoundAsset* asset, bool positional,
+      ALfloat x, ALfloat y, ALfloat z, ALfloat gain, SoundBus* bus)
+{
+   int index = acquire(asset, positional, x, y, z, gain, bus);
+
+   if(index < 0)
+   {
+      return ONE_SHOT_INVALID_HANDLE;
+   }
+   alSourcePlay(voices[index].source);
+
+   return getHandle(index);
+}
+
+/*************************************************************************
+ *                                 queue                                 *
+ *************************************************************************/
+OneShotHandle VoicePool::queue(SoundAsset* asset, bool positional,
+      ALfloat x, ALfloat y, ALfloat z, ALfloat gain, SoundBus* bus)
+{
+   int index;
+
+   if(queued.size() >= voices.size())
+   {
+      /* Would steal one still queued */
+      return ONE_SHOT_INVALID_HANDLE;
+   }
+
+   index = acquire(asset, positional, x, y, z, gain, bus);
+   if(index < 0)
+   {
+      return ONE_SHOT_INVALID_HANDLE;
+   }
+   /* Back to AL_INITIAL, so not taken as ended by reclaim */
+   alSourceRewind(voices[index].source);
+   queued.push_back(voices[index].source);
+
+   return getHandle(index);
+}
+
+/*************************************************************************
+ *                              playQueued                               *
+ *************************************************************************/
+void VoicePool::playQueued()
+{
+   if(!queued.empty())
+   {
+      alSourcePlayv((ALsizei)queued.size(), &queued[0]);
+      queued.clear();
+   }
+}
+
+/*************************************************************************
+ *                                acquire                                *
+ *************************************************************************/
+int VoicePool::acquire(SoundAsset* asset, bool positional,
+      ALfloat x, ALfloat y, ALfloat z, ALfloat gain, SoundBus* bus)
+{
+   int index;
+
+   if( (asset == NULL) || (voices.empty()) )
+   {
+      return -1;
+   }
+
+   if(freeVoices.empty())
+   {
+      reclaim();
+      if(freeVoices.empty())
+      {
+         /* Steal the oldest */
+         release(0);
+      }
+   }
+   index = freeVoices.back();
+   freeVoices.pop_back();
+   active.push_back(index);
+
+   Voice& voice = voices[index];
+   voice.asset = asset;
+   voice.gain = gain;
+   voice.bus = bus;
+   voice.busVersion = (bus != NULL) ? bus->getVersion() : 0;
+   voice.policy = asset->getPolicy();
+   if(voice.policy != NULL)
+   {
+      voice.order = voice.policy->addInstance();
+   }
+   voice.serial = (voice.serial + 1) & KOSOUND_VOICE_SERIAL_MASK;
+   if(voice.serial == 0)
+   {
+      voice.serial = 1;
+   }
+
+   alSourcei(voice.source, AL_BUFFER, asset->getBuffer());
+   if(positional)
+   {
+      alSourcei(voice.source, AL_SOURCE_RELATIVE, AL_FALSE);
+      alSource3f(voice.source, AL_POSITION, x, y, z);
+      alSourcef(voice.source, AL_REFERENCE_DISTANCE, 160);
+      alSourcef(voice.source, AL_ROLLOFF_FACTOR, 1.0);
+   }
+   else
+   {
+      alSourcei(voice.source, AL_SOURCE_RELATIVE, AL_TRUE);
+      alSource3f(voice.source, AL_POSITION, 0.0, 0.0, 0.0);
+      alSourcef(voice.source, AL_ROLLOFF_FACTOR, 0.0);
+   }
+   alSourcef(voice.source, AL_GAIN, 
+         gain * ((bus != NULL) ? bus->getEffectiveGain() : 1.0f));
+
+   return index;
+}
+
+/*************************************************************************
+ *                               getHandle                               *
+ *************************************************************************/
+OneShotHandle VoicePool::getHandle(int index)
+{
+   return (voices[index].serial << KOSOUND_VOICE_INDEX_BITS) | index;
+}
+
+/*************************************************************************
+ *                               getIndex                                *
+ *************************************************************************/
+int VoicePool::getIndex(OneShotHandle handle)
+{
+   int index = handle & KOSOUND_VOICE_INDEX_MASK;
+
+   if( (handle == ONE_SHOT_INVALID_HANDLE) ||
+       (index >= (int)voices.size()) ||
+       (voices[index].asset == NULL) ||
+       (voices[index].serial != (handle >> KOSOUND_VOICE_INDEX_BITS)) )
+   {
+      return -1;
+   }
+
+   return index;
+}
+
+/*************************************************************************
+ *                                release                                *
+ *************************************************************************/
+void VoicePool::release(size_t pos)
+{
+   Voice& voice = voices[active[pos]];
+   std::vector<ALuint>::iterator it;
+
+   if(!queued.empty())
+   {
+      /* Stopped before even started (as stolen by a policy) */
+      it = std::find(queued.begin(), queued.end(), voice.source);
+      if(it != queued.end())
+      {
+         queued.erase(it);
+      }
+   }
+
+   alSourceStop(voice.source);
+   alSourcei(voice.source, AL_BUFFER, 0);
+   voice.asset = NULL;
+   voice.bus = NULL;
+   if(voice.policy != NULL)
+   {
+      voice.policy->removeInstance();
+      voice.policy = NULL;
+   }
+
+   freeVoices.push_back(active[pos]);
+   active.erase(active.begin() + pos);
+}
+
+/*************************************************************************
+ *                                 stop                                  *
+ *************************************************************************/
+void VoicePool::stop(OneShotHandle handle)
+{
+   size_t i;
+   int index = getIndex(handle);
+
+   if(index < 0)
+   {
+      return;
+   }
+   for(i = 0; i < active.size(); i++)
+   {
+      if(active[i] == index)
+      {
+         release(i);
+         return;
+      }
+   }
+}
+
+/*************************************************************************
+ *                                stopAll                                *
+ *************************************************************************/
+void VoicePool::stopAll()
+{
+   while(!active.empty())
+   {
+      release(active.size() - 1);
+   }
+}
+
+/*************************************************************************
+ *                               isPlaying                               *
+ *************************************************************************/
+bool VoicePool::isPlaying(OneShotHandle handle)
+{
+   ALint state;
+   int index = getIndex(handle);
+
+   if(index < 0)
+   {
+      return false;
+   }
+   alGetSourcei(voices[index].source, AL_SOURCE_STATE, &state);
+   return (state == AL_PLAYING) || (state == AL_INITIAL);
+}
+
+/*************************************************************************
+ *                              setPosition                              *
+ *************************************************************************/
+void VoicePool::setPosition(OneShotHandle handle,
+      ALfloat x, ALfloat y, ALfloat z)
+{
+   int index = getIndex(handle);
+
+   if(index >= 0)
+   {
+      alSource3f(voices[index].source, AL_POSITION, x, y, z);
+   }
+}
+
+/*************************************************************************
+ *                             applyBusGains                             *
+ *************************************************************************/
+void VoicePool::applyBusGains()
+{
+   size_t i;
+
+   for(i = 0; i < active.size(); i++)
+   {
+      Voice& voice = voices[active[i]];
+      if( (voice.bus != NULL) && (voice.bus->getVersion() != voice.busVersion) )
+      {
+         voice.busVersion = voice.bus->getVersion();
+         alSourcef(voice.source, AL_GAIN, 
+               voice.gain * voice.bus->getEffectiveGain());
+      }
+   }
+}
+
+/*************************************************************************
+ *                                collect                                *
+ *************************************************************************/
+void VoicePool::collect(SoundPolicy* policy,
+      std::vector<PolicyInstance>& instances)
+{
+   PolicyInstance instance;
+   size_t i;
+
+   instance.sndFx = NULL;
+   for(i = 0; i < active.size(); i++)
+   {
+      Voice& voice = voices[active[i]];
+      if(voice.policy == policy)
+      {
+         instance.order = voice.order;
+         instance.source = voice.source;
+         instance.oneShot = getHandle(active[i]);
+         instances.push_back(instance);
+      }
+   }
+}
+
+/*************************************************************************
+ *                            collectSources                             *
+ *************************************************************************/
+void VoicePool::collectSources(std::vector<ALuint>& sources)
+{
+   size_t i;
+
+   for(i = 0; i < active.size(); i++)
+   {
+      sources.push_back(voices[active[i]].source);
+   }
+}
+
+/*************************************************************************
+ *                                reclaim                                *
+ *************************************************************************/
+void VoicePool::reclaim()
+{
+   ALint state;
+   size_t i = 0;
+
+   while(i < active.size())
+   {
+      alGetSourcei(voices[active[i]].source, AL_SOURCE_STATE, &state);
+      if(state == AL_STOPPED)
+      {
+         release(i);
+      }
+      else
+      {
+         i++;
+      }
+   }
+}
+
@@ -0,0 +1,170 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _kosound_voice_pool_h
+#define _kosound_voice_pool_h
+
+#include "kosoundconfig.h"
+#include "soundasset.h"
+#include "soundpolicy.h"
+#include "soundbus.h"
+
+#include <vector>
+
+namespace Kosound
+{
+
+/*! Handle to a playing one-shot. It's just its voice index and a serial
+ * number, so a handle to an ended (and maybe reused) voice is detected
+ * without any lookup. */
+typedef unsigned int OneShotHandle;
+
+#define ONE_SHOT_INVALID_HANDLE  0
+
+/*! Bits of a OneShotHandle used for the voice index */
+#define KOSOUND_VOICE_INDEX_BITS  10
+/*! Max voices of a VoicePool */
+#define KOSOUND_MAX_VOICES        (1 << KOSOUND_VOICE_INDEX_BITS)
+
+/*! A one-shot to play, as one of many played by a single call (see 
+ * Sound::playOneShots) */
+class OneShotDesc
+{
+   public:
+      SoundAssetId asset; /**< Registered asset to play */
+      bool positional;    /**< If positional or relative to the listener */
+      ALfloat x;          /**< X position, if positional */
+      ALfloat y;          /**< Y position, if positional */
+      ALfloat z;          /**< Z position, if positional */
+      ALfloat gain;       /**< Gain of this play [0, 1], relative to its bus */
+};
+
+/*! A fixed set of AL sources, all created at once, to play one-shots of
+ * registered SoundAssets. Playing one only binds the asset buffer to a
+ * free source: nothing is allocated, opened or decoded. When there's no
+ * free source, the oldest playing one-shot is stolen. */
+class VoicePool
+{
+   public:
+      /*! Constructor
+       * \param total -> number of voices (at most KOSOUND_MAX_VOICES) */
+      VoicePool(int total);
+      /*! Destructor: stop and delete all sources */
+      ~VoicePool();
+
+      /*! Play an asset
+       * \param asset -> asset to play
+       * \param positional -> if positional or relative to the listener
+       * \param x -> X position
+       * \param y -> Y position
+       * \param z -> Z position
+       * \param gain -> gain of this play [0, 1], relative to its bus
+       * \param bus -> bus to play at (could be NULL)
+       * \return handle to the play or ONE_SHOT_INVALID_HANDLE */
+      OneShotHandle play(SoundAsset* asset, bool positional,
+            ALfloat x, ALfloat y, ALfloat z, ALfloat gain, SoundBus* bus);
+
+      /*! Take a voice and define its state to play an asset, but without
+       * starting it: all queued ones are started together by playQueued.
+       * At most getTotal() one-shots are queued at once.
+       * \note parameters as play
+       * \return handle to the play or ONE_SHOT_INVALID_HANDLE */
+      OneShotHandle queue(SoundAsset* asset, bool positional,
+            ALfloat x, ALfloat y, ALfloat z, ALfloat gain, SoundBus* bus);
+
+      /*! Start, with a single alSourcePlayv, all queued one-shots */
+      void playQueued();
+
+      /*! Stop a one-shot, if still playing */
+      void stop(OneShotHandle handle);
+
+      /*! Stop all one-shots */
+      void stopAll();
+
+      /*! \return if the one-shot is still playing */
+      bool isPlaying(OneShotHandle handle);
+
+      /*! Redefine the position of a one-shot, if still playing */
+      void setPosition(OneShotHandle handle, ALfloat x, ALfloat y, ALfloat z);
+
+      /*! Apply the gain of the buses changed since the last call to its
+       * playing one-shots (and only to those). */
+      void applyBusGains();
+
+      /*! Add the one-shots playing under a policy to a vector
+       * \param policy -> policy of the asset
+       * \param instances -> where to add them */
+      void collect(SoundPolicy* policy, 
+            std::vector<PolicyInstance>& instances);
+
+      /*! Add the sources of all playing one-shots to a vector */
+      void collectSources(std::vector<ALuint>& sources);
+
+      /*! Get back the voices whose play ended */
+      void reclaim();
+
+      /*! \return total voices */
+      int getTotal() const { return (int)voices.size(); };
+
+      /*! \return voices now playing */
+      int getActive() const { return (int)active.size(); };
+
+   private:
+      /*! A single voice */
+      class Voice
+      {
+         public:
+            ALuint source;       /**< Its AL source */
+            unsigned int serial; /**< Incremented at each play */
+            SoundAsset* asset;   /**< Asset playing, or NULL if free */
+            ALfloat gain;        /**< Gain of the current play */
+            SoundBus* bus;       /**< Bus of the current play */
+            unsigned long busVersion; /**< Bus version applied */
+            SoundPolicy* policy; /**< Asset policy when played, if any */
+            unsigned long order; /**< Its order at the policy */
+      };
+
+      /*! \return voice index of a still valid handle, or -1 */
+      int getIndex(OneShotHandle handle);
+
+      /*! Take a voice (stealing one if needed) and define its state to
+       * play an asset (see play).
+       * \return its index, or -1 if none */
+      int acquire(SoundAsset* asset, bool positional,
+            ALfloat x, ALfloat y, ALfloat z, ALfloat gain, SoundBus* bus);
+
+      /*! \return handle to the current play of a voice */
+      OneShotHandle getHandle(int index);
+
+      /*! Stop a voice and give it back to the free ones
+       * \param pos -> its position at the active vector */
+      void release(size_t pos);
+
+      std::vector<Voice> voices;  /**< All voices */
+      std::vector<int> freeVoices; /**< Indexes of the free ones */
+      std::vector<int> active;     /**< Indexes of playing ones, oldest
+                                        first */
+      std::vector<ALuint> queued;  /**< Sources waiting for playQueued */
+};
+
+}
+
+#endif
+
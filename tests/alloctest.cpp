@@ -0,0 +1,383 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* alloctest: checks that, once warmed up, the zero-allocation paths of a
+ * registered asset do no heap allocation at all on the thread calling
+ * Sound: playing, changing (by every SndFx setter), flushing and removing
+ * its sound effects (see Sound::addSoundEffect(SoundAssetId, ...)), its
+ * one-shots, and the refills (and loop rewinds) of a playing stream.
+ * Every global operator new and delete is counted. Returns 77 (skipped)
+ * when no OpenAL device could be opened. */
+
+#include "sound.h"
+#include "kosndformat.h"
+#include <kobold/filereader.h>
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <thread>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KOSOUND_TEST_SKIP        77   /**< Return code of a skipped test */
+#define KOSOUND_TEST_WARM_UP      8   /**< Cycles to grow the containers */
+#define KOSOUND_TEST_CYCLES     256   /**< Cycles checked */
+#define KOSOUND_TEST_RATE     48000   /**< Sample rate of the test sound */
+#define KOSOUND_TEST_FRAMES   48000   /**< Frames of the test sound (1s) */
+#define KOSOUND_TEST_BLOCK     4096   /**< Frames per .kosnd block */
+#define KOSOUND_TEST_STREAM_MS 2500   /**< Streaming time (ms) checked */
+#define KOSOUND_TEST_FLUSH_MS    10   /**< Flush interval while streaming */
+
+using namespace Kosound;
+
+static std::atomic<unsigned long> allocations(0); /**< Counted news */
+static std::atomic<unsigned long> deallocations(0); /**< Counted deletes */
+/*! If news and deletes are counted at this thread (only at the one
+ * calling Sound: the OpenAL threads aren't ours to check) */
+static thread_local bool counting = false;
+
+/*************************************************************************
+ *                             operator new                              *
+ *************************************************************************/
+void* operator new(size_t size)
+{
+   void* ptr = malloc((size > 0) ? size : 1);
+   if(ptr == NULL)
+   {
+      throw std::bad_alloc();
+   }
+   if(counting)
+   {
+      allocations++;
+   }
+   return ptr;
+}
+
+/*************************************************************************
+ *                            operator new[]                             *
+ *************************************************************************/
+void* operator new[](size_t size)
+{
+   return operator new(size);
+}
+
+/*************************************************************************
+ *                             operator new                              *
+ *************************************************************************/
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+   void* ptr = malloc((size > 0) ? size : 1);
+   if( (ptr != NULL) && (counting) )
+   {
+      allocations++;
+   }
+   return ptr;
+}
+
+/*************************************************************************
+ *                            operator new[]                             *
+ *************************************************************************/
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept
+{
+   return operator new(size, tag);
+}
+
+/*************************************************************************
+ *                           operator delete                             *
+ *************************************************************************/
+void operator delete(void* ptr) noexcept
+{
+   if(ptr == NULL)
+   {
+      return;
+   }
+   if(counting)
+   {
+      deallocations++;
+   }
+   free(ptr);
+}
+
+/*************************************************************************
+ *                          operator delete[]                            *
+ *************************************************************************/
+void operator delete[](void* ptr) noexcept
+{
+   operator delete(ptr);
+}
+
+/*************************************************************************
+ *                           operator delete                             *
+ *************************************************************************/
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+   operator delete(ptr);
+}
+
+/*************************************************************************
+ *                          operator delete[]                            *
+ *************************************************************************/
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+   operator delete(ptr);
+}
+
+/*! A FileReader of a local file, through stdio */
+class TestReader: public Kobold::FileReader
+{
+   public:
+      TestReader() { file = NULL; };
+      ~TestReader() { close(); };
+
+      bool open(const Kobold::String& fileName)
+      {
+         close();
+         file = fopen(fileName.c_str(), "rb");
+         return file != NULL;
+      };
+      void close()
+      {
+         if(file != NULL)
+         {
+            fclose(file);
+            file = NULL;
+         }
+      };
+      bool eof() { return (file == NULL) || (feof(file)); };
+      size_t read(char* buffer, size_t size)
+      {
+         return (file != NULL) ? fread(buffer, 1, size, file) : 0;
+      };
+      void seek(size_t offset)
+      {
+         if(file != NULL)
+         {
+            fseek(file, (long)offset, SEEK_SET);
+         }
+      };
+      size_t tell() { return (file != NULL) ? (size_t)ftell(file) : 0; };
+
+   private:
+      FILE* file; /**< The opened file */
+};
+
+/*************************************************************************
+ *                            writeTestFile                              *
+ *************************************************************************/
+static bool writeTestFile(const char* fileName)
+{
+   unsigned char data[KOSND_HEADER_SIZE];
+   unsigned char entry[KOSND_SEEK_ENTRY_SIZE];
+   unsigned char padding[KOSND_ALIGNMENT];
+   KosndHeader header;
+   uint64_t offset;
+   int16_t sample;
+   uint32_t block, i, frame = 0;
+   FILE* f;
+
+   /* A mono 440 Hz tone, in many blocks */
+   header.channels = 1;
+   header.sampleRate = KOSOUND_TEST_RATE;
+   header.sourceRate = KOSOUND_TEST_RATE;
+   header.totalFrames = KOSOUND_TEST_FRAMES;
+   header.blockFrames = KOSOUND_TEST_BLOCK;
+   header.blockCount = (KOSOUND_TEST_FRAMES + KOSOUND_TEST_BLOCK - 1) / 
+      KOSOUND_TEST_BLOCK;
+   header.seekTableOffset = KOSND_HEADER_SIZE;
+   header.dataOffset = KosndHeader::align(KOSND_HEADER_SIZE + 
+         header.blockCount * KOSND_SEEK_ENTRY_SIZE);
+
+   f = fopen(fileName, "wb");
+   if(f == NULL)
+   {
+      return false;
+   }
+   memset(padding, 0, sizeof(padding));
+
+   /* Header and seek table */
+   header.serialize(data);
+   fwrite(data, KOSND_HEADER_SIZE, 1, f);
+   offset = header.dataOffset;
+   for(block = 0; block < header.blockCount; block++)
+   {
+      KosndHeader::writeU64(entry, offset);
+      fwrite(entry, KOSND_SEEK_ENTRY_SIZE, 1, f);
+      offset += header.getAlignedBlockSize(block);
+   }
+   fwrite(padding, header.dataOffset - KOSND_HEADER_SIZE - 
+         header.blockCount * KOSND_SEEK_ENTRY_SIZE, 1, f);
+
+   /* And each block, padded to the alignment */
+   for(block = 0; block < header.blockCount; block++)
+   {
+      for(i = 0; i < header.getBlockFrames(block); i++, frame++)
+      {
+         sample = (int16_t)(8000.0 * 
+               sin(2.0 * M_PI * 440.0 * frame / KOSOUND_TEST_RATE));
+         data[0] = (uint16_t)sample & 0xFF;
+         data[1] = ((uint16_t)sample >> 8) & 0xFF;
+         fwrite(data, 2, 1, f);
+      }
+      fwrite(padding, header.getAlignedBlockSize(block) - 
+            header.getBlockSize(block), 1, f);
+   }
+
+   return (!ferror(f)) && (fclose(f) == 0);
+}
+
+/*************************************************************************
+ *                                cycle                                  *
+ *************************************************************************/
+static bool cycle(SoundAssetId asset)
+{
+   OneShotHandle oneShot;
+   SndFx* snd = Sound::addSoundEffect(asset, 10.0f, 0.0f, 10.0f, 
+         SOUND_NO_LOOP);
+   if(snd == NULL)
+   {
+      return false;
+   }
+   Sound::flush();
+
+   /* Every setter */
+   snd->redefinePosition(5.0f, 0.0f, 5.0f);
+   snd->setVelocity(1.0f, 0.0f, 0.0f);
+   snd->setRelative(false);
+   snd->setDirectionCone(0.0f, 0.0f, -1.0f, 90.0f, 180.0f);
+   snd->changeVolume(64);
+   snd->setLoop(SOUND_AUTO_LOOP);
+   snd->seek(0.5);
+   snd->setLoop(SOUND_NO_LOOP);
+   Sound::flush();
+
+   /* A one-shot, stopped before its end */
+   oneShot = Sound::playOneShot(asset, -5.0f, 0.0f, 5.0f, 0.5f);
+   Sound::flush();
+   Sound::stopOneShot(oneShot);
+
+   Sound::removeSoundEffect(snd);
+   Sound::flush();
+
+   return oneShot != ONE_SHOT_INVALID_HANDLE;
+}
+
+/*************************************************************************
+ *                                stream                                 *
+ *************************************************************************/
+static bool stream(SoundAssetId asset)
+{
+   int elapsed;
+   SndFx* snd = Sound::addSoundEffect(asset, SOUND_AUTO_LOOP);
+   if(snd == NULL)
+   {
+      return false;
+   }
+
+   /* Longer than the sound: its buffers are refilled, and it's rewound
+    * to loop, by the flushes */
+   for(elapsed = 0; elapsed < KOSOUND_TEST_STREAM_MS; 
+       elapsed += KOSOUND_TEST_FLUSH_MS)
+   {
+      std::this_thread::sleep_for(
+            std::chrono::milliseconds(KOSOUND_TEST_FLUSH_MS));
+      Sound::flush();
+   }
+
+   Sound::removeSoundEffect(snd);
+   Sound::flush();
+
+   return true;
+}
+
+/*************************************************************************
+ *                                 main                                  *
+ *************************************************************************/
+int main(int argc, char* argv[])
+{
+   const char* fileName = "kosound_alloctest.kosnd";
+   unsigned long allocs, frees;
+   SoundAssetId asset;
+   bool ok = true;
+   int i;
+
+   if(!writeTestFile(fileName))
+   {
+      fprintf(stderr, "alloctest: couldn't write '%s'\n", fileName);
+      return 1;
+   }
+
+   Sound::init();
+   asset = Sound::registerAsset(fileName, new TestReader(), false, true);
+   if(asset == SOUND_INVALID_ASSET)
+   {
+      printf("alloctest: no OpenAL device (or couldn't load), skipped\n");
+      Sound::finish();
+      remove(fileName);
+      return KOSOUND_TEST_SKIP;
+   }
+
+   /* Warm up: grow every container to the load */
+   for(i = 0; i < KOSOUND_TEST_WARM_UP; i++)
+   {
+      ok &= cycle(asset);
+   }
+   ok &= stream(asset);
+
+   /* And count at the steady state */
+   allocs = allocations;
+   frees = deallocations;
+   counting = true;
+   for(i = 0; (ok) && (i < KOSOUND_TEST_CYCLES); i++)
+   {
+      ok &= cycle(asset);
+   }
+   if(ok)
+   {
+      ok &= stream(asset);
+   }
+   counting = false;
+   allocs = allocations - allocs;
+   frees = deallocations - frees;
+
+   Sound::finish();
+   remove(fileName);
+
+   if(!ok)
+   {
+      fprintf(stderr, "alloctest: couldn't play the test asset\n");
+      return 1;
+   }
+   if( (allocs != 0) || (frees != 0) )
+   {
+      fprintf(stderr, "alloctest: %lu allocations and %lu deallocations "
+            "at %d cycles and %d ms of streaming\n", allocs, frees, 
+            KOSOUND_TEST_CYCLES, KOSOUND_TEST_STREAM_MS);
+      return 1;
+   }
+
+   printf("alloctest: no allocation at %d cycles and %d ms of streaming\n",
+         KOSOUND_TEST_CYCLES, KOSOUND_TEST_STREAM_MS);
+   return 0;
+}
+
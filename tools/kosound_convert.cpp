@@ -0,0 +1,597 @@
+/*
+ Kosound - A simple sound library
+ Copyright (C) DNTeam <kosound@dnteam.org>
+
+ This file is part of Kosound.
+
+ Kosound is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Kosound is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with Kosound.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* kosound_convert: offline converter of .ogg files (or directories with
+ * them) to the pre-decoded .kosnd format (see src/kosndformat.h). */
+
+#include "kosndformat.h"
+#include "downmix.h"
+
+#include <vorbis/codec.h>
+#include <vorbis/vorbisfile.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+
+using namespace Kosound;
+
+/*! Conversion options */
+struct ConvertOptions
+{
+   std::string outputDir;  /**< Output directory (empty: input's one) */
+   uint32_t sampleRate;    /**< Target sample rate (0: keep original) */
+   bool downmix;           /**< If should downmix stereo to mono */
+   uint32_t blockFrames;   /**< Frames per block */
+};
+
+/*************************************************************************
+ *                                usage                                  *
+ *************************************************************************/
+static void usage(const char* program)
+{
+   printf("Usage: %s [options] <file.ogg | directory>...\n", program);
+   printf("Convert .ogg files to pre-decoded .kosnd files.\n"
+          "Directories are recursively searched for .ogg files.\n\n"
+          "Options:\n"
+          "  -o <dir>    output directory (default: same as input)\n"
+          "  -r <rate>   resample to rate Hz (default: keep original)\n"
+          "  -m          downmix stereo to mono\n"
+          "  -b <frames> frames per block (default: %d)\n",
+          KOSND_DEFAULT_BLOCK_FRAMES);
+}
+
+/*************************************************************************
+ *                            parsePositive                              *
+ *************************************************************************/
+static bool parsePositive(const char* str, uint32_t* value)
+{
+   char* end = NULL;
+   long result;
+
+   errno = 0;
+   result = strtol(str, &end, 10);
+   if( (errno != 0) || (end == str) || (*end != '\0') ||
+       (result <= 0) || ((unsigned long)result > UINT_MAX) )
+   {
+      return false;
+   }
+
+   *value = (uint32_t)result;
+   return true;
+}
+
+/*************************************************************************
+ *                           hasOggExtension                             *
+ *************************************************************************/
+static bool hasOggExtension(const std::string& name)
+{
+   return (name.size() > 4) &&
+          (strcasecmp(name.c_str() + name.size() - 4, ".ogg") == 0);
+}
+
+/*************************************************************************
+ *                            isDirectory                                *
+ *************************************************************************/
+static bool isDirectory(const std::string& path)
+{
+   struct stat st;
+   return (stat(path.c_str(), &st) == 0) && (S_ISDIR(st.st_mode));
+}
+
+/*************************************************************************
+ *                            makeDirectory                              *
+ *************************************************************************/
+static bool makeDirectory(const std::string& path)
+{
+   size_t pos = 0;
+
+   /* Create each path component, as mkdir -p */
+   while(pos != std::string::npos)
+   {
+      pos = path.find('/', pos + 1);
+      std::string partial = path.substr(0, pos);
+      if( (!partial.empty()) && (!isDirectory(partial)) )
+      {
+#ifdef _WIN32
+         if(mkdir(partial.c_str()) != 0)
+#else
+         if(mkdir(partial.c_str(), 0755) != 0)
+#endif
+         {
+            return false;
+         }
+      }
+   }
+
+   return true;
+}
+
+/*************************************************************************
+ *                               decode                                  *
+ *************************************************************************/
+static bool decode(const std::string& fileName, std::vector<int16_t>& pcm,
+      int* channels, uint32_t* rate)
+{
+   OggVorbis_File vf;
+   vorbis_info* info;
+   char buffer[4096];
+   int section;
+   long result;
+   const uint16_t endianTest = 1;
+   int bigEndian = (*((const char*)&endianTest) == 0) ? 1 : 0;
+
+   if(ov_fopen(fileName.c_str(), &vf) != 0)
+   {
+      fprintf(stderr, "Error: couldn't open '%s' as ogg vorbis\n",
+            fileName.c_str());
+      return false;
+   }
+
+   info = ov_info(&vf, -1);
+   *channels = info->channels;
+   *rate = info->rate;
+   if( (*channels < 1) || (*channels > 2) )
+   {
+      fprintf(stderr, "Error: '%s' has %d channels (only 1 or 2 allowed)\n",
+            fileName.c_str(), *channels);
+      ov_clear(&vf);
+      return false;
+   }
+
+   /* Decode to host order 16 bits samples */
+   pcm.clear();
+   while((result = ov_read(&vf, buffer, sizeof(buffer), bigEndian, 2, 1,
+                          &section)) != 0)
+   {
+      if(result < 0)
+      {
+         if(result == OV_HOLE)
+         {
+            /* Just a hole in the data: continue */
+            continue;
+         }
+         fprintf(stderr, "Error: decode failed for '%s' (%ld)\n",
+               fileName.c_str(), result);
+         ov_clear(&vf);
+         return false;
+      }
+
+      info = ov_info(&vf, section);
+      if( (info->channels != *channels) || ((uint32_t)info->rate != *rate) )
+      {
+         fprintf(stderr, "Error: '%s' changes its format on a chained "
+               "stream.\n", fileName.c_str());
+         ov_clear(&vf);
+         return false;
+      }
+
+      size_t prev = pcm.size();
+      pcm.resize(prev + result / 2);
+      memcpy(&pcm[prev], buffer, result);
+   }
+
+   ov_clear(&vf);
+   return true;
+}
+
+/*************************************************************************
+ *                               downmix                                 *
+ *************************************************************************/
+static void downmix(std::vector<int16_t>& pcm)
+{
+   size_t frames = pcm.size() / 2;
+
+   if(frames > 0)
+   {
+      Downmix::stereoToMono(&pcm[0], &pcm[0], frames);
+   }
+   pcm.resize(frames);
+}
+
+/*************************************************************************
+ *                               lowPass                                 *
+ *************************************************************************/
+static void lowPass(std::vector<int16_t>& pcm, int channels, double cutoff)
+{
+   size_t frames = pcm.size() / channels;
+   int half = (int)ceil(4.0 / cutoff);
+   int width = 2 * half;
+   std::vector<double> kernel(width + 1);
+   std::vector<int16_t> out(pcm.size());
+   double sum = 0.0;
+
+   /* Blackman windowed sinc, cutoff in cycles per source sample */
+   for(int k = -half; k <= half; k++)
+   {
+      double h = (k == 0) ? 2.0 * cutoff :
+                 sin(2.0 * M_PI * cutoff * k) / (M_PI * k);
+      double w = 0.42 - 0.5 * cos(2.0 * M_PI * (k + half) / width) +
+                 0.08 * cos(4.0 * M_PI * (k + half) / width);
+      kernel[k + half] = h * w;
+      sum += h * w;
+   }
+   /* Normalize to unity gain at DC */
+   for(int k = 0; k <= width; k++)
+   {
+      kernel[k] /= sum;
+   }
+
+   for(size_t f = 0; f < frames; f++)
+   {
+      for(int c = 0; c < channels; c++)
+      {
+         double v = 0.0;
+         for(int k = -half; k <= half; k++)
+         {
+            /* Clamp at the edges, repeating the first and last frames */
+            long s = (long)f + k;
+            if(s < 0)
+            {
+               s = 0;
+            }
+            else if((size_t)s >= frames)
+            {
+               s = (long)frames - 1;
+            }
+            v += kernel[k + half] * pcm[s * channels + c];
+         }
+         v = (v < 0) ? v - 0.5 : v + 0.5;
+         if(v > 32767.0)
+         {
+            v = 32767.0;
+         }
+         else if(v < -32768.0)
+         {
+            v = -32768.0;
+         }
+         out[f * channels + c] = (int16_t)v;
+      }
+   }
+
+   pcm.swap(out);
+}
+
+/*************************************************************************
+ *                               resample                                *
+ *************************************************************************/
+static void resample(std::vector<int16_t>& pcm, int channels,
+      uint32_t srcRate, uint32_t dstRate)
+{
+   size_t srcFrames = pcm.size() / channels;
+   size_t dstFrames;
+   std::vector<int16_t> out;
+
+   if( (srcRate == dstRate) || (srcFrames == 0) )
+   {
+      return;
+   }
+
+   if(dstRate < srcRate)
+   {
+      /* Downsampling: remove everything above the new Nyquist frequency
+       * before decimating, or it would alias back into the audible band. */
+      lowPass(pcm, channels, 0.5 * dstRate / srcRate);
+   }
+
+   dstFrames = (size_t)(((uint64_t)srcFrames * dstRate + srcRate - 1) /
+         srcRate);
+   out.resize(dstFrames * channels);
+
+   /* Linear interpolation between the two nearest source frames */
+   for(size_t i = 0; i < dstFrames; i++)
+   {
+      double pos = (double)i * srcRate / dstRate;
+      size_t f0 = (size_t)pos;
+      size_t f1 = (f0 + 1 < srcFrames) ? f0 + 1 : srcFrames - 1;
+      double t = pos - f0;
+      if(f0 >= srcFrames)
+      {
+         f0 = srcFrames - 1;
+      }
+      for(int c = 0; c < channels; c++)
+      {
+         double v = pcm[f0 * channels + c] * (1.0 - t) +
+                    pcm[f1 * channels + c] * t;
+         out[i * channels + c] = (int16_t)((v < 0) ? v - 0.5 : v + 0.5);
+      }
+   }
+
+   pcm.swap(out);
+}
+
+/*************************************************************************
+ *                                write                                  *
+ *************************************************************************/
+static bool write(const std::string& fileName, const std::vector<int16_t>& pcm,
+      KosndHeader& header)
+{
+   unsigned char data[KOSND_HEADER_SIZE];
+   unsigned char entry[KOSND_SEEK_ENTRY_SIZE];
+   unsigned char padding[KOSND_ALIGNMENT];
+   std::vector<unsigned char> block;
+   uint64_t offset;
+   uint32_t i;
+   FILE* f;
+
+   header.totalFrames = pcm.size() / header.channels;
+   header.blockCount = (uint32_t)((header.totalFrames + header.blockFrames - 1)
+         / header.blockFrames);
+   if(header.blockCount == 0)
+   {
+      fprintf(stderr, "Error: no audio data to write to '%s'\n",
+            fileName.c_str());
+      return false;
+   }
+   header.seekTableOffset = KOSND_HEADER_SIZE;
+   header.dataOffset = KosndHeader::align(header.seekTableOffset +
+         (uint64_t)header.blockCount * KOSND_SEEK_ENTRY_SIZE);
+
+   f = fopen(fileName.c_str(), "wb");
+   if(!f)
+   {
+      fprintf(stderr, "Error: couldn't create '%s': %s\n", fileName.c_str(),
+            strerror(errno));
+      return false;
+   }
+
+   /* Header */
+   header.serialize(data);
+   fwrite(data, KOSND_HEADER_SIZE, 1, f);
+
+   /* Seek table */
+   offset = header.dataOffset;
+   for(i = 0; i < header.blockCount; i++)
+   {
+      KosndHeader::writeU64(entry, offset);
+      fwrite(entry, KOSND_SEEK_ENTRY_SIZE, 1, f);
+      offset += header.getAlignedBlockSize(i);
+   }
+   memset(padding, 0, sizeof(padding));
+   fwrite(padding, header.dataOffset - (header.seekTableOffset +
+            (uint64_t)header.blockCount * KOSND_SEEK_ENTRY_SIZE), 1, f);
+
+   /* Blocks, little-endian and zero padded to the alignment */
+   for(i = 0; i < header.blockCount; i++)
+   {
+      size_t first = (size_t)i * header.blockFrames * header.channels;
+      size_t samples = header.getBlockFrames(i) * header.channels;
+      block.assign(header.getAlignedBlockSize(i), 0);
+      for(size_t s = 0; s < samples; s++)
+      {
+         uint16_t v = (uint16_t)pcm[first + s];
+         block[2 * s] = v & 0xFF;
+         block[2 * s + 1] = (v >> 8) & 0xFF;
+      }
+      fwrite(&block[0], block.size(), 1, f);
+   }
+
+   if( (ferror(f)) || (fclose(f) != 0) )
+   {
+      fprintf(stderr, "Error: failed writing '%s'\n", fileName.c_str());
+      return false;
+   }
+
+   return true;
+}
+
+/*************************************************************************
+ *                              convertFile                              *
+ *************************************************************************/
+static bool convertFile(const std::string& input, const std::string& output,
+      const ConvertOptions& opts)
+{
+   std::vector<int16_t> pcm;
+   KosndHeader header;
+   int channels;
+   uint32_t rate;
+
+   if(!decode(input, pcm, &channels, &rate))
+   {
+      return false;
+   }
+
+   header.sourceRate = rate;
+   header.blockFrames = opts.blockFrames;
+
+   if( (opts.downmix) && (channels == 2) )
+   {
+      downmix(pcm);
+      channels = 1;
+      header.flags |= KOSND_FLAG_DOWNMIXED;
+   }
+   if( (opts.sampleRate != 0) && (opts.sampleRate != rate) )
+   {
+      resample(pcm, channels, rate, opts.sampleRate);
+      rate = opts.sampleRate;
+      header.flags |= KOSND_FLAG_RESAMPLED;
+   }
+
+   header.channels = channels;
+   header.sampleRate = rate;
+
+   if(!write(output, pcm, header))
+   {
+      return false;
+   }
+
+   printf("%s -> %s (%d ch, %u Hz, %lu frames)\n", input.c_str(),
+         output.c_str(), channels, rate, (unsigned long)header.totalFrames);
+   return true;
+}
+
+/*************************************************************************
+ *                               convert                                 *
+ *************************************************************************/
+static int convert(const std::string& input, const std::string& outputDir,
+      const ConvertOptions& opts)
+{
+   int failures = 0;
+
+   if(isDirectory(input))
+   {
+      DIR* dir = opendir(input.c_str());
+      struct dirent* ent;
+      if(!dir)
+      {
+         fprintf(stderr, "Error: couldn't open directory '%s'\n",
+               input.c_str());
+         return 1;
+      }
+      while((ent = readdir(dir)) != NULL)
+      {
+         std::string name = ent->d_name;
+         if( (name == ".") || (name == "..") )
+         {
+            continue;
+         }
+         std::string path = input + "/" + name;
+         if(isDirectory(path))
+         {
+            /* Keep the directory structure at the output */
+            failures += convert(path, (outputDir.empty()) ? outputDir :
+                  outputDir + "/" + name, opts);
+         }
+         else if(hasOggExtension(name))
+         {
+            failures += convert(path, outputDir, opts);
+         }
+      }
+      closedir(dir);
+      return failures;
+   }
+
+   /* Define output name, replacing the .ogg extension */
+   std::string base = input;
+   size_t slash = base.rfind('/');
+   std::string dir = (slash != std::string::npos) ?
+      base.substr(0, slash) : std::string(".");
+   if(slash != std::string::npos)
+   {
+      base = base.substr(slash + 1);
+   }
+   if(hasOggExtension(base))
+   {
+      base = base.substr(0, base.size() - 4);
+   }
+   if(!outputDir.empty())
+   {
+      if(!makeDirectory(outputDir))
+      {
+         fprintf(stderr, "Error: couldn't create directory '%s'\n",
+               outputDir.c_str());
+         return 1;
+      }
+      dir = outputDir;
+   }
+
+   return convertFile(input, dir + "/" + base + ".kosnd", opts) ? 0 : 1;
+}
+
+/*************************************************************************
+ *                                 main                                  *
+ *************************************************************************/
+int main(int argc, char* argv[])
+{
+   ConvertOptions opts;
+   std::vector<std::string> inputs;
+   int failures = 0;
+   int i;
+
+   opts.sampleRate = 0;
+   opts.downmix = false;
+   opts.blockFrames = KOSND_DEFAULT_BLOCK_FRAMES;
+
+   for(i = 1; i < argc; i++)
+   {
+      std::string arg = argv[i];
+      if( (arg == "-o") && (i + 1 < argc) )
+      {
+         opts.outputDir = argv[++i];
+      }
+      else if( (arg == "-r") && (i + 1 < argc) )
+      {
+         if(!parsePositive(argv[++i], &opts.sampleRate))
+         {
+            fprintf(stderr, "Error: invalid sample rate '%s'\n", argv[i]);
+            usage(argv[0]);
+            return 1;
+         }
+      }
+      else if( (arg == "-b") && (i + 1 < argc) )
+      {
+         if(!parsePositive(argv[++i], &opts.blockFrames))
+         {
+            fprintf(stderr, "Error: invalid block frames '%s'\n", argv[i]);
+            usage(argv[0]);
+            return 1;
+         }
+      }
+      else if(arg == "-m")
+      {
+         opts.downmix = true;
+      }
+      else if( (arg == "-h") || (arg == "--help") )
+      {
+         usage(argv[0]);
+         return 0;
+      }
+      else if( (!arg.empty()) && (arg[0] == '-') )
+      {
+         fprintf(stderr, "Error: unknown or incomplete option '%s'\n",
+               arg.c_str());
+         usage(argv[0]);
+         return 1;
+      }
+      else
+      {
+         inputs.push_back(arg);
+      }
+   }
+
+   if(inputs.empty())
+   {
+      usage(argv[0]);
+      return 1;
+   }
+
+   for(size_t n = 0; n < inputs.size(); n++)
+   {
+      failures += convert(inputs[n], opts.outputDir, opts);
+   }
+
+   if(failures > 0)
+   {
+      fprintf(stderr, "%d file(s) failed to convert.\n", failures);
+      return 1;
+   }
+   return 0;
+}
+